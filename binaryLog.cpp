@@ -0,0 +1,293 @@
+
+#include "binaryLog.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+static const uint32_t BINARY_LOG_VERSION = 1;
+static const uint32_t BINARY_LOG_BYTE_ORDER = 0x01020304;
+
+BinaryLogWriter::BinaryLogWriter()
+ : file_ptr(NULL), block_records(DEFAULT_BLOCK_RECORDS), record_count(0),
+   index(NULL), index_size(0), block_count(0)
+{
+}
+
+BinaryLogWriter::~BinaryLogWriter()
+{
+    Close();
+}
+
+bool BinaryLogWriter::Open(FILE* filePtr, unsigned int blockRecords)
+{
+    Close();
+    BinaryLogHeader header;
+    memset(&header, 0, sizeof(header));
+    strcpy(header.magic, BINARY_LOG_MAGIC);
+    header.version = BINARY_LOG_VERSION;
+    header.record_size = sizeof(BinaryLogRecord);
+    header.block_records = blockRecords ? blockRecords : (unsigned int)DEFAULT_BLOCK_RECORDS;
+    header.byte_order = BINARY_LOG_BYTE_ORDER;
+    if (1 != fwrite(&header, sizeof(header), 1, filePtr))
+    {
+        perror("BinaryLogWriter::Open() fwrite() error");
+        return false;
+    }
+    file_ptr = filePtr;
+    block_records = header.block_records;
+    record_count = 0;
+    block_count = 0;
+    return true;
+}  // end BinaryLogWriter::Open()
+
+void BinaryLogWriter::MakeRecord(const GPSPosition& pos, BinaryLogRecord& record)
+{
+    memset(&record, 0, sizeof(record));
+    record.sys_usec = (int64_t)pos.sys_time.tv_sec*1000000 + pos.sys_time.tv_usec;
+    record.gps_usec = (int64_t)pos.gps_time.tv_sec*1000000 + pos.gps_time.tv_usec;
+    record.lat = pos.y;
+    record.lon = pos.x;
+    record.alt = pos.z;
+    if (pos.xyvalid) record.flags |= BINARY_LOG_XYVALID;
+    if (pos.zvalid) record.flags |= BINARY_LOG_ZVALID;
+    if (pos.tvalid) record.flags |= BINARY_LOG_TVALID;
+}  // end BinaryLogWriter::MakeRecord()
+
+bool BinaryLogWriter::Write(const BinaryLogRecord& record)
+{
+    if (!file_ptr) return false;
+    if (1 != fwrite(&record, sizeof(record), 1, file_ptr))
+    {
+        perror("BinaryLogWriter::Write() fwrite() error");
+        return false;
+    }
+    if (0 == (record_count % block_records))
+        current_block.first_usec = record.sys_usec;
+    current_block.last_usec = record.sys_usec;
+    record_count++;
+    if (0 == (record_count % block_records))
+        return AddIndexEntry(current_block);
+    return true;
+}  // end BinaryLogWriter::Write()
+
+bool BinaryLogWriter::AddIndexEntry(const BinaryLogIndexEntry& entry)
+{
+    if (block_count >= index_size)
+    {
+        unsigned int newSize = index_size ? (2*index_size) : 64;
+        BinaryLogIndexEntry* newIndex = new BinaryLogIndexEntry[newSize];
+        if (!newIndex)
+        {
+            fprintf(stderr, "BinaryLogWriter::AddIndexEntry() error: allocation failed\n");
+            return false;
+        }
+        if (index)
+        {
+            memcpy(newIndex, index, block_count*sizeof(BinaryLogIndexEntry));
+            delete[] index;
+        }
+        index = newIndex;
+        index_size = newSize;
+    }
+    index[block_count++] = entry;
+    return true;
+}  // end BinaryLogWriter::AddIndexEntry()
+
+bool BinaryLogWriter::Close()
+{
+    if (!file_ptr) return true;
+    bool result = true;
+    if (0 != (record_count % block_records))
+        result = AddIndexEntry(current_block);  // (partial last block)
+    BinaryLogFooter footer;
+    memset(&footer, 0, sizeof(footer));
+    strcpy(footer.magic, BINARY_LOG_INDEX_MAGIC);
+    footer.index_offset = sizeof(BinaryLogHeader) + record_count*sizeof(BinaryLogRecord);
+    footer.record_count = record_count;
+    footer.block_count = block_count;
+    if (result &&
+        ((block_count && (block_count != fwrite(index, sizeof(BinaryLogIndexEntry), block_count, file_ptr))) ||
+         (1 != fwrite(&footer, sizeof(footer), 1, file_ptr))))
+    {
+        perror("BinaryLogWriter::Close() fwrite() error");
+        result = false;
+    }
+    fflush(file_ptr);
+    delete[] index;
+    index = NULL;
+    index_size = block_count = 0;
+    file_ptr = NULL;
+    return result;
+}  // end BinaryLogWriter::Close()
+
+
+BinaryLogReader::BinaryLogReader()
+ : file_fd(-1), record_count(0), index(NULL), block_count(0),
+   index_rebuilt(false), next_record(0)
+{
+}
+
+BinaryLogReader::~BinaryLogReader()
+{
+    Close();
+}
+
+bool BinaryLogReader::Open(const char* path)
+{
+    Close();
+    if ((file_fd = open(path, O_RDONLY)) < 0)
+    {
+        perror("BinaryLogReader::Open() open() error");
+        return false;
+    }
+    struct stat info;
+    if (fstat(file_fd, &info) ||
+        (sizeof(header) != pread(file_fd, &header, sizeof(header), 0)) ||
+        strncmp(header.magic, BINARY_LOG_MAGIC, 8) ||
+        (BINARY_LOG_VERSION != header.version) ||
+        (BINARY_LOG_BYTE_ORDER != header.byte_order) ||
+        (sizeof(BinaryLogRecord) != header.record_size) ||
+        (0 == header.block_records))
+    {
+        fprintf(stderr, "BinaryLogReader::Open() error: %s is not a "
+                        "compatible gpsLogger binary log\n", path);
+        Close();
+        return false;
+    }
+
+    // Use the footer index if present, else rebuild the index
+    uint64_t fileSize = info.st_size;
+    BinaryLogFooter footer;
+    if ((fileSize >= (sizeof(header) + sizeof(footer))) &&
+        (sizeof(footer) == pread(file_fd, &footer, sizeof(footer), fileSize - sizeof(footer))) &&
+        !strncmp(footer.magic, BINARY_LOG_INDEX_MAGIC, 8) &&
+        (footer.index_offset == (sizeof(header) + footer.record_count*sizeof(BinaryLogRecord))) &&
+        ((footer.index_offset + footer.block_count*sizeof(BinaryLogIndexEntry) + sizeof(footer)) == fileSize))
+    {
+        record_count = footer.record_count;
+        block_count = footer.block_count;
+        if (!(index = new BinaryLogIndexEntry[block_count + 1]))
+        {
+            Close();
+            return false;
+        }
+        ssize_t indexBytes = block_count*sizeof(BinaryLogIndexEntry);
+        if (indexBytes != pread(file_fd, index, indexBytes, footer.index_offset))
+        {
+            perror("BinaryLogReader::Open() pread() error");
+            Close();
+            return false;
+        }
+        index_rebuilt = false;
+    }
+    else
+    {
+        record_count = (fileSize - sizeof(header)) / sizeof(BinaryLogRecord);
+        block_count = (unsigned int)((record_count + header.block_records - 1) / header.block_records);
+        if (!(index = new BinaryLogIndexEntry[block_count + 1]))
+        {
+            Close();
+            return false;
+        }
+        for (unsigned int i = 0; i < block_count; i++)
+        {
+            uint64_t first = (uint64_t)i*header.block_records;
+            uint64_t last = first + header.block_records - 1;
+            if (last >= record_count) last = record_count - 1;
+            BinaryLogRecord record;
+            if (!ReadRecord(first, record))
+            {
+                Close();
+                return false;
+            }
+            index[i].first_usec = record.sys_usec;
+            if (!ReadRecord(last, record))
+            {
+                Close();
+                return false;
+            }
+            index[i].last_usec = record.sys_usec;
+        }
+        index_rebuilt = true;
+    }
+    next_record = 0;
+    return true;
+}  // end BinaryLogReader::Open()
+
+void BinaryLogReader::Close()
+{
+    if (file_fd >= 0)
+    {
+        close(file_fd);
+        file_fd = -1;
+    }
+    delete[] index;
+    index = NULL;
+    record_count = 0;
+    block_count = 0;
+    next_record = 0;
+}  // end BinaryLogReader::Close()
+
+bool BinaryLogReader::ReadRecord(uint64_t recordIndex, BinaryLogRecord& record)
+{
+    off_t offset = sizeof(BinaryLogHeader) + recordIndex*sizeof(BinaryLogRecord);
+    if (sizeof(record) != pread(file_fd, &record, sizeof(record), offset))
+    {
+        perror("BinaryLogReader::ReadRecord() pread() error");
+        return false;
+    }
+    return true;
+}  // end BinaryLogReader::ReadRecord()
+
+bool BinaryLogReader::SeekRecord(uint64_t recordIndex)
+{
+    if (recordIndex > record_count) return false;
+    next_record = recordIndex;
+    return true;
+}  // end BinaryLogReader::SeekRecord()
+
+bool BinaryLogReader::Seek(int64_t usec)
+{
+    // 1) Binary search the index for the first block ending at/after "usec"
+    unsigned int lo = 0;
+    unsigned int hi = block_count;
+    while (lo < hi)
+    {
+        unsigned int mid = lo + (hi - lo)/2;
+        if (index[mid].last_usec < usec)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo >= block_count)
+    {
+        next_record = record_count;  // (all records are earlier)
+        return true;
+    }
+    // 2) Binary search that block's records
+    uint64_t first = (uint64_t)lo*header.block_records;
+    uint64_t last = first + header.block_records;
+    if (last > record_count) last = record_count;
+    while (first < last)
+    {
+        uint64_t mid = first + (last - first)/2;
+        BinaryLogRecord record;
+        if (!ReadRecord(mid, record)) return false;
+        if (record.sys_usec < usec)
+            first = mid + 1;
+        else
+            last = mid;
+    }
+    next_record = first;
+    return true;
+}  // end BinaryLogReader::Seek()
+
+bool BinaryLogReader::Read(BinaryLogRecord& record)
+{
+    if (next_record >= record_count) return false;
+    if (!ReadRecord(next_record, record)) return false;
+    next_record++;
+    return true;
+}  // end BinaryLogReader::Read()
@@ -0,0 +1,131 @@
+#ifndef _BINARY_LOG
+#define _BINARY_LOG
+
+#include "gpsPub.h"  // for GPSPosition
+
+#include <stdio.h>
+#include <stdint.h>
+
+// gpsLogger binary log format:
+//
+//   BinaryLogHeader
+//   BinaryLogRecord[recordCount]    (fixed-size records, in blocks of
+//                                    "block_records" consecutive records)
+//   BinaryLogIndexEntry[blockCount] (first/last time of each block)
+//   BinaryLogFooter                 (locates the index)
+//
+// Values are in host byte order (the header "byte_order" field tells).
+// The index and footer are appended when the log is closed.  If they
+// are missing (e.g. gpsLogger was killed) the reader rebuilds the index
+// from the first and last record of each block.  Either way a time
+// range query is a binary search rather than a scan of the whole log.
+
+#define BINARY_LOG_MAGIC        "GPSLOGB"
+#define BINARY_LOG_INDEX_MAGIC  "GPSLOGX"
+
+typedef struct BinaryLogHeader
+{
+    char        magic[8];       // BINARY_LOG_MAGIC
+    uint32_t    version;        // 1
+    uint32_t    record_size;    // sizeof(BinaryLogRecord)
+    uint32_t    block_records;  // records per index block
+    uint32_t    byte_order;     // 0x01020304 in host byte order
+    uint32_t    reserved[2];
+} BinaryLogHeader;
+
+typedef struct BinaryLogRecord
+{
+    int64_t     sys_usec;       // system time of fix (usec since 1970, UTC)
+    int64_t     gps_usec;       // GPS time of fix (if BINARY_LOG_TVALID)
+    double      lat;            // degrees
+    double      lon;            // degrees
+    double      alt;            // meters
+    uint32_t    flags;
+    uint32_t    device;         // receiver (slot) number + 1, 0 if untagged
+} BinaryLogRecord;
+
+enum
+{
+    BINARY_LOG_XYVALID  = 0x01,
+    BINARY_LOG_ZVALID   = 0x02,
+    BINARY_LOG_TVALID   = 0x04
+};
+
+typedef struct BinaryLogIndexEntry
+{
+    int64_t     first_usec;     // "sys_usec" of block's first record
+    int64_t     last_usec;      // "sys_usec" of block's last record
+} BinaryLogIndexEntry;
+
+typedef struct BinaryLogFooter
+{
+    char        magic[8];       // BINARY_LOG_INDEX_MAGIC
+    uint64_t    index_offset;   // file offset of first BinaryLogIndexEntry
+    uint64_t    record_count;
+    uint32_t    block_count;
+    uint32_t    reserved;
+} BinaryLogFooter;
+
+class BinaryLogWriter
+{
+    public:
+        enum {DEFAULT_BLOCK_RECORDS = 1024};
+
+        BinaryLogWriter();
+        ~BinaryLogWriter();
+
+        // Writes the log header to (already open) "filePtr"
+        bool Open(FILE* filePtr, unsigned int blockRecords = DEFAULT_BLOCK_RECORDS);
+        bool Write(const BinaryLogRecord& record);
+        // Appends the index and footer (the FILE is left open)
+        bool Close();
+
+        static void MakeRecord(const GPSPosition& pos, BinaryLogRecord& record);
+
+    private:
+        bool AddIndexEntry(const BinaryLogIndexEntry& entry);
+
+        FILE*                   file_ptr;
+        unsigned int            block_records;
+        uint64_t                record_count;
+        BinaryLogIndexEntry*    index;
+        unsigned int            index_size;
+        unsigned int            block_count;
+        BinaryLogIndexEntry     current_block;
+};  // end class BinaryLogWriter
+
+class BinaryLogReader
+{
+    public:
+        BinaryLogReader();
+        ~BinaryLogReader();
+
+        bool Open(const char* path);
+        void Close();
+
+        uint64_t GetRecordCount() const
+            {return record_count;}
+        bool IndexWasRebuilt() const
+            {return index_rebuilt;}
+
+        // Positions the reader at the first record with "sys_usec" >= "usec"
+        // (assuming time is non-decreasing through the log)
+        bool Seek(int64_t usec);
+        // Positions the reader at record number "recordIndex"
+        bool SeekRecord(uint64_t recordIndex);
+        // Reads the next record (returns false at end of log)
+        bool Read(BinaryLogRecord& record);
+
+    private:
+        bool ReadRecord(uint64_t recordIndex, BinaryLogRecord& record);
+
+        int                     file_fd;
+        BinaryLogHeader         header;
+        uint64_t                record_count;
+        BinaryLogIndexEntry*    index;
+        unsigned int            block_count;
+        bool                    index_rebuilt;
+        uint64_t                next_record;
+};  // end class BinaryLogReader
+
+#endif // _BINARY_LOG
@@ -0,0 +1,265 @@
+
+#include "clockDiscipline.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <sys/time.h>
+
+#ifdef LINUX
+#include <sys/timex.h>
+#endif // LINUX
+
+static const double MAX_FREQUENCY = 500.0;      // ppm (kernel limit)
+static const double MAX_SLEW_RATE = 500.0e-06;  // (adjtime() slew rate)
+static const double STEP_THRESHOLD = 0.128;     // sec
+static const double MAX_INTERVAL = 64.0;        // sec
+
+static inline double ClampFrequency(double ppm)
+{
+    if (ppm > MAX_FREQUENCY) return MAX_FREQUENCY;
+    if (ppm < -MAX_FREQUENCY) return -MAX_FREQUENCY;
+    return ppm;
+}  // end ClampFrequency()
+
+SystemClock::SystemClock()
+ : use_frequency(false), frequency(0.0)
+{
+}
+
+bool SystemClock::Init(bool useFrequency)
+{
+    use_frequency = false;
+    frequency = 0.0;
+    if (!useFrequency) return true;
+#ifdef LINUX
+    struct timex tx;
+    memset(&tx, 0, sizeof(tx));
+    if (adjtimex(&tx) < 0)
+    {
+        perror("SystemClock::Init() adjtimex() error");
+        return false;
+    }
+    if (0 != (tx.status & STA_PLL))
+        fprintf(stderr, "SystemClock::Init() warning: kernel PLL is enabled (is ntpd running?)\n");
+    // Writing back the current frequency checks we are permitted to set it
+    long freq = tx.freq;
+    memset(&tx, 0, sizeof(tx));
+    tx.modes = ADJ_FREQUENCY;
+    tx.freq = freq;
+    if (adjtimex(&tx) < 0)
+    {
+        perror("SystemClock::Init() adjtimex() error (using adjtime() only)");
+        return false;
+    }
+    use_frequency = true;
+    frequency = freq / 65536.0;  // (kernel units are 2^-16 ppm)
+    return true;
+#else
+    fprintf(stderr, "SystemClock::Init() warning: no frequency adjustment (using adjtime() only)\n");
+    return false;
+#endif // if/else LINUX
+}  // end SystemClock::Init()
+
+bool SystemClock::SlewPhase(double offset)
+{
+    double secs = floor(offset);
+    struct timeval delta;
+    delta.tv_sec = (long)secs;
+    delta.tv_usec = (long)((offset - secs) * 1.0e06 + 0.5);
+    if (delta.tv_usec > 999999)
+    {
+        delta.tv_sec++;
+        delta.tv_usec -= 1000000;
+    }
+    if (-1 == adjtime(&delta, NULL))
+    {
+        perror("SystemClock::SlewPhase() adjtime() error");
+        return false;
+    }
+    return true;
+}  // end SystemClock::SlewPhase()
+
+bool SystemClock::SetFrequency(double ppm)
+{
+    if (!use_frequency) return false;
+    ppm = ClampFrequency(ppm);
+#ifdef LINUX
+    struct timex tx;
+    memset(&tx, 0, sizeof(tx));
+    tx.modes = ADJ_FREQUENCY;
+    tx.freq = (long)(ppm * 65536.0);
+    if (adjtimex(&tx) < 0)
+    {
+        perror("SystemClock::SetFrequency() adjtimex() error (using adjtime() only)");
+        use_frequency = false;
+        return false;
+    }
+#endif // LINUX
+    frequency = ppm;
+    return true;
+}  // end SystemClock::SetFrequency()
+
+
+SimulatedClock::SimulatedClock(double oscillatorPpm, double jitterUsec, unsigned int seed)
+ : oscillator_ppm(oscillatorPpm), jitter(jitterUsec * 1.0e-06),
+   random_state(seed ? seed : 1), has_frequency(true), frequency(0.0),
+   true_time(0.0), clock_offset(0.0), pending_slew(0.0)
+{
+}
+
+void SimulatedClock::Advance(double seconds)
+{
+    // The slew proceeds at MAX_SLEW_RATE until "pending_slew" is used up
+    double slew = MAX_SLEW_RATE * seconds;
+    if (fabs(pending_slew) <= slew)
+        slew = pending_slew;
+    else if (pending_slew < 0.0)
+        slew = -slew;
+    pending_slew -= slew;
+    clock_offset -= (oscillator_ppm + frequency) * 1.0e-06 * seconds + slew;
+    true_time += seconds;
+}  // end SimulatedClock::Advance()
+
+double SimulatedClock::MeasureOffset()
+{
+    if (0.0 == jitter) return clock_offset;
+    // Gaussian jitter (Box-Muller) from a deterministic xorshift generator
+    double u[2];
+    for (int i = 0; i < 2; i++)
+    {
+        random_state ^= random_state << 13;
+        random_state ^= random_state >> 17;
+        random_state ^= random_state << 5;
+        u[i] = (random_state + 1.0) / 4294967297.0;  // (0, 1)
+    }
+    return clock_offset + jitter * sqrt(-2.0 * log(u[0])) * cos(2.0 * M_PI * u[1]);
+}  // end SimulatedClock::MeasureOffset()
+
+bool SimulatedClock::SlewPhase(double offset)
+{
+    pending_slew = offset;  // (replaces any slew in progress, as adjtime() does)
+    return true;
+}  // end SimulatedClock::SlewPhase()
+
+bool SimulatedClock::SetFrequency(double ppm)
+{
+    if (!has_frequency) return false;
+    frequency = ClampFrequency(ppm);
+    return true;
+}  // end SimulatedClock::SetFrequency()
+
+
+ClockDiscipline::ClockDiscipline()
+ : backend(NULL), time_constant(DEFAULT_TIME_CONSTANT), frequency(0.0),
+   offset_var(0.0), update_count(0)
+{
+    Reset();
+}
+
+void ClockDiscipline::Init(ClockBackend* theBackend, double timeConstant)
+{
+    backend = theBackend;
+    time_constant = (timeConstant >= 1.0) ? timeConstant : 1.0;
+    frequency = backend->GetFrequency() * 1.0e-06;
+    offset_var = 0.0;
+    update_count = 0;
+    Reset();
+}  // end ClockDiscipline::Init()
+
+void ClockDiscipline::Reset()
+{
+    fll_count = 0;
+    fll_start = 0.0;
+    fll_sum_t = fll_sum_x = fll_sum_tt = fll_sum_tx = 0.0;
+    have_last = false;
+    last_ref_time = last_offset = 0.0;
+}  // end ClockDiscipline::Reset()
+
+double ClockDiscipline::GetJitter() const
+{
+    return sqrt(offset_var);
+}  // end ClockDiscipline::GetJitter()
+
+bool ClockDiscipline::Update(double offset, double refTime)
+{
+    if (!backend) return false;
+    update_count++;
+    if (1 == update_count)
+        offset_var = offset * offset;
+    else
+        offset_var += (offset * offset - offset_var) / 16.0;
+    double interval = refTime - last_ref_time;
+    bool gap = !have_last || (interval <= 0.0) || (interval > MAX_INTERVAL);
+    have_last = true;
+    last_ref_time = refTime;
+    last_offset = offset;
+
+    if (fabs(offset) > STEP_THRESHOLD)
+    {
+        // Too large for the loop, so just slew (and acquire again after)
+        fll_count = 0;
+        return backend->SlewPhase(offset);
+    }
+
+    double slew = 0.0;
+    if (fll_count < FLL_SAMPLES)
+    {
+        // Frequency acquisition: the phase is left alone while the
+        // offset trend (i.e. the frequency error) is fitted
+        if (gap && (0 != fll_count))
+        {
+            fll_count = 0;  // (missed pulses, start over)
+        }
+        if (0 == fll_count)
+        {
+            fll_start = refTime;
+            fll_sum_t = fll_sum_x = fll_sum_tt = fll_sum_tx = 0.0;
+        }
+        double t = refTime - fll_start;
+        fll_sum_t += t;
+        fll_sum_x += offset;
+        fll_sum_tt += t * t;
+        fll_sum_tx += t * offset;
+        if (FLL_SAMPLES == ++fll_count)
+        {
+            double n = FLL_SAMPLES;
+            double denom = n * fll_sum_tt - fll_sum_t * fll_sum_t;
+            if (denom > 0.0)
+                frequency += (n * fll_sum_tx - fll_sum_t * fll_sum_x) / denom;
+            frequency = ClampFrequency(frequency * 1.0e06) * 1.0e-06;
+            backend->SetFrequency(frequency * 1.0e06);
+            slew = offset;  // (and now take out the phase error)
+        }
+        else if (!backend->HasFrequency() && (0.0 != frequency))
+        {
+            // (adjtime() only: keep compensating any known frequency error)
+            slew = frequency * (gap ? 1.0 : interval);
+        }
+        else
+        {
+            return true;
+        }
+    }
+    else
+    {
+        // Phase-locked loop (critically damped, time constant "T"):
+        // slew (tau/T) of the offset each update and integrate
+        // offset*tau/(4*T^2) into the frequency correction
+        double tau = gap ? 1.0 : interval;
+        double gain = tau / time_constant;
+        if (gain > 1.0) gain = 1.0;
+        slew = offset * gain;
+        if (!gap)
+        {
+            frequency += offset * tau / (4.0 * time_constant * time_constant);
+            frequency = ClampFrequency(frequency * 1.0e06) * 1.0e-06;
+            backend->SetFrequency(frequency * 1.0e06);
+        }
+        // With adjtime() only, the frequency correction is applied by
+        // slewing the drift expected over the next interval as well
+        if (!backend->HasFrequency()) slew += frequency * tau;
+    }
+    return backend->SlewPhase(slew);
+}  // end ClockDiscipline::Update()
@@ -0,0 +1,155 @@
+#ifndef _CLOCK_DISCIPLINE
+#define _CLOCK_DISCIPLINE
+
+// The ClockDiscipline steers the system clock to GPS (PPS) time with
+// a phase/frequency-locked loop instead of correcting only the phase
+// of each pulse.  Slewing out just the phase error leaves the local
+// oscillator frequency error in place, so the offset saw-tooths back
+// every second.  Here the frequency error is first estimated from the
+// trend of successive (PPS) offsets (frequency lock) and then tracked by
+// a second order (proportional-integral) phase-locked loop.  The
+// frequency correction is programmed into the kernel with adjtimex()
+// and the phase correction is slewed with adjtime().
+//
+// The clock is accessed through a ClockBackend so the loop can be run
+// against a SimulatedClock, faster than real time and without a GPS.
+
+class ClockBackend
+{
+    public:
+        virtual ~ClockBackend() {}
+
+        // Slews the clock by "offset" seconds (positive advances it)
+        virtual bool SlewPhase(double offset) = 0;
+        // Sets the clock frequency correction (positive speeds it up)
+        // Returns false if the backend can't adjust frequency (the
+        // ClockDiscipline then folds its frequency correction into the
+        // phase slew each update)
+        virtual bool SetFrequency(double ppm) = 0;
+        virtual bool HasFrequency() const = 0;
+        // Current frequency correction
+        virtual double GetFrequency() const = 0;
+};  // end class ClockBackend
+
+// The system clock, via adjtimex() (LINUX) and adjtime()
+class SystemClock : public ClockBackend
+{
+    public:
+        SystemClock();
+
+        // Reads the current kernel frequency correction (so a restart
+        // keeps the frequency learned earlier).  If adjtimex() is not
+        // available or not permitted (or "useFrequency" is false) the
+        // clock falls back to phase-only adjtime() operation.
+        bool Init(bool useFrequency = true);
+
+        bool SlewPhase(double offset);
+        bool SetFrequency(double ppm);
+        bool HasFrequency() const
+            {return use_frequency;}
+        double GetFrequency() const
+            {return frequency;}
+
+    private:
+        bool    use_frequency;
+        double  frequency;  // ppm
+};  // end class SystemClock
+
+// A simulated clock driven by an oscillator with a given frequency
+// error (plus optional timestamp jitter) that slews like the kernel
+// adjtime() does (at most 500 ppm).  "Advance()" moves (true) time
+// forward, "MeasureOffset()" returns what a PPS measurement of the
+// clock's offset from true time would be.
+class SimulatedClock : public ClockBackend
+{
+    public:
+        SimulatedClock(double oscillatorPpm = 0.0, double jitterUsec = 0.0,
+                       unsigned int seed = 1);
+
+        void SetOscillator(double ppm)
+            {oscillator_ppm = ppm;}
+        // Steps the clock (like settimeofday()) to "offset" from true time
+        void SetOffset(double offset)
+            {clock_offset = offset; pending_slew = 0.0;}
+
+        void Advance(double seconds);
+        double GetTrueTime() const
+            {return true_time;}
+        double GetLocalTime() const
+            {return true_time - clock_offset;}
+        // Returns (true time - local time) plus measurement jitter
+        double MeasureOffset();
+        double GetTrueOffset() const
+            {return clock_offset;}
+
+        bool SlewPhase(double offset);
+        bool SetFrequency(double ppm);
+        bool HasFrequency() const
+            {return has_frequency;}
+        double GetFrequency() const
+            {return frequency;}
+        // Simulates a kernel without frequency adjustment
+        void DisableFrequency()
+            {has_frequency = false; frequency = 0.0;}
+
+    private:
+        double          oscillator_ppm;  // oscillator error (positive runs fast)
+        double          jitter;          // measurement jitter std deviation (sec)
+        unsigned int    random_state;
+        bool            has_frequency;
+        double          frequency;       // frequency correction (ppm)
+        double          true_time;       // sec
+        double          clock_offset;    // true - local (sec)
+        double          pending_slew;    // remaining adjtime() slew (sec)
+};  // end class SimulatedClock
+
+class ClockDiscipline
+{
+    public:
+        enum {DEFAULT_TIME_CONSTANT = 16};  // seconds
+
+        ClockDiscipline();
+
+        // "timeConstant" sets the phase-locked loop bandwidth (longer
+        // filters more timestamp jitter but tracks oscillator wander
+        // more slowly)
+        void Init(ClockBackend* backend, double timeConstant = DEFAULT_TIME_CONSTANT);
+        // Restarts frequency acquisition (e.g. after a clock step)
+        // (the frequency correction is kept)
+        void Reset();
+
+        // Given the measured "offset" (GPS - system time, seconds) at
+        // system time "refTime" (seconds), adjusts the clock
+        bool Update(double offset, double refTime);
+
+        bool IsLocked() const
+            {return (fll_count >= FLL_SAMPLES);}
+        double GetFrequency() const  // ppm
+            {return (frequency * 1.0e06);}
+        double GetOffset() const
+            {return last_offset;}
+        // Exponentially weighted RMS offset (seconds)
+        double GetJitter() const;
+        unsigned long GetUpdateCount() const
+            {return update_count;}
+
+    private:
+        enum {FLL_SAMPLES = 16};
+
+        ClockBackend*   backend;
+        double          time_constant;
+        double          frequency;       // fractional frequency correction
+        unsigned int    fll_count;       // frequency acquisition samples
+        double          fll_start;       // "refTime" of first sample
+        double          fll_sum_t;       // (linear regression sums)
+        double          fll_sum_x;
+        double          fll_sum_tt;
+        double          fll_sum_tx;
+        bool            have_last;
+        double          last_ref_time;
+        double          last_offset;
+        double          offset_var;      // (for GetJitter())
+        unsigned long   update_count;
+};  // end class ClockDiscipline
+
+#endif // _CLOCK_DISCIPLINE
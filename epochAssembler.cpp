@@ -0,0 +1,126 @@
+
+#include "epochAssembler.h"
+
+#include <string.h>
+
+EpochAssembler::EpochAssembler()
+ : timeout_usec(100000), epoch_count(0), sentence_count(0)
+{
+    Reset();
+}
+
+unsigned int EpochAssembler::DefaultTimeout(unsigned int baud)
+{
+    // (two maximum length sentences, "$...*hh\r\n", at 10 bits per character)
+    unsigned int msec = baud ? (2 * (NMEAParser::MAX_SENTENCE_LENGTH + 6) * 10000 / baud) : 0;
+    return (msec < 100) ? 100 : msec;
+}  // end EpochAssembler::DefaultTimeout()
+
+void EpochAssembler::Reset()
+{
+    pending = false;
+    memset(&epoch_fix, 0, sizeof(GPSPositionV2));
+    epoch_time = last_time = -1;
+    epoch_mask = expected_mask = 0;
+    last_sentence_time.tv_sec = last_sentence_time.tv_usec = 0;
+    ready_index = ready_count = 0;
+}  // end EpochAssembler::Reset()
+
+bool EpochAssembler::Add(const GPSPositionV2& fix, const NMEAParser::SentenceInfo& info)
+{
+    bool completed = false;
+    sentence_count++;
+    if (pending && (info.time_of_day >= 0) && (epoch_time >= 0) &&
+        (info.time_of_day != epoch_time))
+    {
+        Complete();  // (the next epoch has begun)
+        completed = true;
+    }
+    if (!pending)
+    {
+        epoch_fix = fix;
+        epoch_time = info.time_of_day;
+        epoch_mask = 0;
+        pending = true;
+    }
+    else
+    {
+        // (the epoch's "sys_time" is that of its first sentence)
+        unsigned int added = fix.valid & ~epoch_fix.valid;
+        if (0 != (added & GPS_VALID_TIME)) epoch_fix.gps_time = fix.gps_time;
+        if (0 != (added & GPS_VALID_XY))
+        {
+            epoch_fix.x = fix.x;
+            epoch_fix.y = fix.y;
+        }
+        if (0 != (added & GPS_VALID_Z)) epoch_fix.z = fix.z;
+        if (0 != (added & GPS_VALID_SPEED)) epoch_fix.speed = fix.speed;
+        if (0 != (added & GPS_VALID_HEADING)) epoch_fix.heading = fix.heading;
+        if (0 != (added & GPS_VALID_HDOP)) epoch_fix.hdop = fix.hdop;
+        if (0 != (added & GPS_VALID_SATELLITES)) epoch_fix.satellites = fix.satellites;
+        if (0 != (added & GPS_VALID_QUALITY)) epoch_fix.quality = fix.quality;
+        epoch_fix.valid |= added;
+        if (epoch_time < 0) epoch_time = info.time_of_day;
+    }
+    epoch_mask |= (1 << info.type);
+    last_sentence_time = fix.sys_time;
+    if ((0 != expected_mask) && (expected_mask == (epoch_mask & expected_mask)))
+    {
+        Complete();
+        completed = true;
+    }
+    return completed;
+}  // end EpochAssembler::Add()
+
+void EpochAssembler::Complete()
+{
+    // A sentence arriving after its epoch was completed (e.g. one the
+    // receiver has just started sending) is added to those expected.
+    // Otherwise, expect what this epoch had (i.e. a receiver that stops
+    // sending a sentence costs one timeout).
+    if ((epoch_time >= 0) && (epoch_time == last_time))
+        expected_mask |= epoch_mask;
+    else
+        expected_mask = epoch_mask;
+    last_time = epoch_time;
+    epoch_fix.stale = false;
+    if (READY_MAX == ready_count)
+    {
+        ready_index = (ready_index + 1) % READY_MAX;  // (drop oldest)
+        ready_count--;
+    }
+    ready[(ready_index + ready_count) % READY_MAX] = epoch_fix;
+    ready_count++;
+    pending = false;
+    epoch_count++;
+}  // end EpochAssembler::Complete()
+
+static inline long long TimeDiffUsec(const struct timeval& a, const struct timeval& b)
+{
+    return ((long long)(a.tv_sec - b.tv_sec) * 1000000 + (a.tv_usec - b.tv_usec));
+}  // end TimeDiffUsec()
+
+bool EpochAssembler::CheckTimeout(const struct timeval& currentTime)
+{
+    if (!pending || (TimeDiffUsec(currentTime, last_sentence_time) < timeout_usec))
+        return false;
+    Complete();
+    return true;
+}  // end EpochAssembler::CheckTimeout()
+
+int EpochAssembler::GetTimeout(const struct timeval& currentTime) const
+{
+    if (!pending) return -1;
+    long long remaining = timeout_usec - TimeDiffUsec(currentTime, last_sentence_time);
+    if (remaining <= 0) return 0;
+    return (int)((remaining + 999) / 1000);
+}  // end EpochAssembler::GetTimeout()
+
+bool EpochAssembler::GetFix(GPSPositionV2& fix)
+{
+    if (0 == ready_count) return false;
+    fix = ready[ready_index];
+    ready_index = (ready_index + 1) % READY_MAX;
+    ready_count--;
+    return true;
+}  // end EpochAssembler::GetFix()
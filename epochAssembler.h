@@ -0,0 +1,75 @@
+#ifndef _EPOCH_ASSEMBLER
+#define _EPOCH_ASSEMBLER
+
+#include "gpsPub.h"
+#include "nmeaParse.h"
+
+#include <sys/time.h>
+
+// A GPS receiver reports each fix ("epoch") in several sentences (e.g.
+// GPRMC with the date and speed, GPGGA with the altitude and HDOP), all
+// with the same UTC
+// time of day.  The EpochAssembler combines the sentences of an epoch
+// into one fix, which is completed (for publishing once per epoch) when:
+//
+//   1) every sentence type seen in the previous epoch has arrived, or
+//   2) a sentence for a different time of day arrives, or
+//   3) no sentence arrives for the timeout (see GetTimeout())
+//
+// The sentence types expected are learned from the sentences received,
+// so receivers sending only GPRMC (or adding sentences later) work too.
+
+class EpochAssembler
+{
+    public:
+        EpochAssembler();
+
+        // Timeout (after an epoch's latest sentence) to complete an epoch
+        // that is still missing expected sentences
+        void SetTimeout(unsigned int msec)
+            {timeout_usec = msec * 1000;}
+        // Suggested timeout for "baud" (long enough for the gap while a
+        // maximum length sentence is received, and at least 100 msec)
+        static unsigned int DefaultTimeout(unsigned int baud);
+        void Reset();
+
+        // Adds the fix parsed from one sentence ("fix.sys_time" is the
+        // sentence's system time).  Returns true if an epoch was completed
+        // (see GetFix()).
+        bool Add(const GPSPositionV2& fix, const NMEAParser::SentenceInfo& info);
+        // Completes the pending epoch if it has timed out at "currentTime"
+        bool CheckTimeout(const struct timeval& currentTime);
+        bool IsPending() const
+            {return pending;}
+        // Msec until the pending epoch times out (or -1 if none is pending)
+        int GetTimeout(const struct timeval& currentTime) const;
+
+        // Gets the next completed (non-stale) fix, oldest first
+        bool GetFix(GPSPositionV2& fix);
+
+        unsigned long GetEpochCount() const
+            {return epoch_count;}
+        unsigned long GetSentenceCount() const
+            {return sentence_count;}
+
+    private:
+        void Complete();
+
+        enum {READY_MAX = 4};  // (Add() completes at most two epochs)
+
+        unsigned int    timeout_usec;
+        bool            pending;
+        GPSPositionV2   epoch_fix;
+        long long       epoch_time;         // UTC time of day (usec, -1 if none)
+        unsigned int    epoch_mask;         // sentence types in epoch
+        unsigned int    expected_mask;      // (learned from previous epochs)
+        long long       last_time;          // time of day of last completed epoch
+        struct timeval  last_sentence_time;
+        GPSPositionV2   ready[READY_MAX];
+        unsigned int    ready_index;
+        unsigned int    ready_count;
+        unsigned long   epoch_count;
+        unsigned long   sentence_count;
+};  // end class EpochAssembler
+
+#endif // _EPOCH_ASSEMBLER
@@ -0,0 +1,209 @@
+
+#include "eventSource.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+
+#ifdef LINUX
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#endif // LINUX
+
+#ifndef LINUX
+int SignalEvent::pipe_fd = -1;
+#endif // !LINUX
+
+SignalEvent::SignalEvent()
+ : read_fd(-1)
+#ifndef LINUX
+   , write_fd(-1)
+#endif // !LINUX
+{
+}
+
+SignalEvent::~SignalEvent()
+{
+    Close();
+}
+
+bool SignalEvent::Open()
+{
+    Close();
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+#ifdef LINUX
+    if (sigprocmask(SIG_BLOCK, &signals, NULL))
+    {
+        perror("SignalEvent::Open() sigprocmask() error");
+        return false;
+    }
+    if ((read_fd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC)) < 0)
+    {
+        perror("SignalEvent::Open() signalfd() error");
+        return false;
+    }
+#else
+    // (the handler only does an async-signal-safe write())
+    int fds[2];
+    if (pipe(fds))
+    {
+        perror("SignalEvent::Open() pipe() error");
+        return false;
+    }
+    read_fd = fds[0];
+    write_fd = pipe_fd = fds[1];
+    fcntl(read_fd, F_SETFL, fcntl(read_fd, F_GETFL) | O_NONBLOCK);
+    fcntl(write_fd, F_SETFL, fcntl(write_fd, F_GETFL) | O_NONBLOCK);
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = Handler;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    if (sigaction(SIGINT, &action, NULL) || sigaction(SIGTERM, &action, NULL))
+    {
+        perror("SignalEvent::Open() sigaction() error");
+        Close();
+        return false;
+    }
+#endif // if/else LINUX
+    return true;
+}  // end SignalEvent::Open()
+
+void SignalEvent::Close()
+{
+    if (read_fd >= 0)
+    {
+        close(read_fd);
+        read_fd = -1;
+    }
+#ifndef LINUX
+    if (write_fd >= 0)
+    {
+        signal(SIGINT, SIG_DFL);
+        signal(SIGTERM, SIG_DFL);
+        pipe_fd = -1;
+        close(write_fd);
+        write_fd = -1;
+    }
+#endif // !LINUX
+}  // end SignalEvent::Close()
+
+#ifndef LINUX
+void SignalEvent::Handler(int sigNum)
+{
+    int savedErrno = errno;
+    unsigned char value = (unsigned char)sigNum;
+    if ((pipe_fd >= 0) && (write(pipe_fd, &value, 1) < 0)) {}  // (full is fine)
+    errno = savedErrno;
+}  // end SignalEvent::Handler()
+#endif // !LINUX
+
+int SignalEvent::Read()
+{
+#ifdef LINUX
+    struct signalfd_siginfo info;
+    if (read(read_fd, &info, sizeof(info)) != (ssize_t)sizeof(info)) return 0;
+    return (int)info.ssi_signo;
+#else
+    unsigned char value;
+    if (read(read_fd, &value, 1) != 1) return 0;
+    return (int)value;
+#endif // if/else LINUX
+}  // end SignalEvent::Read()
+
+
+static inline long long TimeDiffUsec(const struct timeval& a, const struct timeval& b)
+{
+    return ((long long)(a.tv_sec - b.tv_sec) * 1000000 + (a.tv_usec - b.tv_usec));
+}  // end TimeDiffUsec()
+
+static inline void AddMsec(struct timeval& time, unsigned int msec)
+{
+    time.tv_sec += msec / 1000;
+    time.tv_usec += (msec % 1000) * 1000;
+    if (time.tv_usec >= 1000000)
+    {
+        time.tv_sec++;
+        time.tv_usec -= 1000000;
+    }
+}  // end AddMsec()
+
+TickTimer::TickTimer()
+ : timer_fd(-1), interval(0)
+{
+    next_tick.tv_sec = next_tick.tv_usec = 0;
+}
+
+TickTimer::~TickTimer()
+{
+    Close();
+}
+
+bool TickTimer::Open(unsigned int msec)
+{
+    Close();
+    interval = msec;
+    gettimeofday(&next_tick, NULL);
+    AddMsec(next_tick, interval);
+#ifdef LINUX
+    if ((timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)) < 0)
+    {
+        perror("TickTimer::Open() timerfd_create() error");
+        return false;
+    }
+    struct itimerspec spec;
+    spec.it_interval.tv_sec = msec / 1000;
+    spec.it_interval.tv_nsec = (msec % 1000) * 1000000;
+    spec.it_value = spec.it_interval;
+    if (timerfd_settime(timer_fd, 0, &spec, NULL))
+    {
+        perror("TickTimer::Open() timerfd_settime() error");
+        Close();
+        return false;
+    }
+#endif // LINUX
+    return true;
+}  // end TickTimer::Open()
+
+void TickTimer::Close()
+{
+    if (timer_fd >= 0)
+    {
+        close(timer_fd);
+        timer_fd = -1;
+    }
+}  // end TickTimer::Close()
+
+unsigned long TickTimer::Read()
+{
+    if (timer_fd >= 0)
+    {
+#ifdef LINUX
+        unsigned long long expirations;
+        if (read(timer_fd, &expirations, sizeof(expirations)) != (ssize_t)sizeof(expirations))
+            return 0;
+        return (unsigned long)expirations;
+#endif // LINUX
+    }
+    struct timeval currentTime;
+    gettimeofday(&currentTime, NULL);
+    if (TimeDiffUsec(currentTime, next_tick) < 0) return 0;
+    next_tick = currentTime;
+    AddMsec(next_tick, interval);
+    return 1;
+}  // end TickTimer::Read()
+
+int TickTimer::GetTimeout() const
+{
+    if (timer_fd >= 0) return -1;
+    struct timeval currentTime;
+    gettimeofday(&currentTime, NULL);
+    long long remaining = TimeDiffUsec(next_tick, currentTime);
+    return (remaining <= 0) ? 0 : (int)((remaining + 999) / 1000);
+}  // end TickTimer::GetTimeout()
@@ -0,0 +1,67 @@
+#ifndef _EVENT_SOURCE
+#define _EVENT_SOURCE
+
+// Event sources gpsLogger's loops wait on with the input device (with
+// poll() or epoll()), instead of asynchronous signal handlers and timers:
+//   SignalEvent - shutdown signals (SIGINT, SIGTERM) made readable, via
+//                 signalfd() on Linux (a self-pipe written by the handler
+//                 elsewhere)
+//   TickTimer   - a periodic timer made readable, via timerfd on Linux
+//                 (elsewhere, the loop waits no longer than GetTimeout())
+// So shutdown happens between events, in the loop's own context (no
+// stdio, gmtime() or exit() from signal handlers), and periodic checks
+// (heartbeat, stale position, read timeout) are made once per tick
+// rather than once per byte.
+
+#include <sys/time.h>
+
+class SignalEvent
+{
+    public:
+        SignalEvent();
+        ~SignalEvent();
+
+        // Blocks SIGINT and SIGTERM (so call before starting any
+        // threads, which inherit the mask) and makes them readable
+        bool Open();
+        void Close();
+        int GetDescriptor() const
+            {return read_fd;}
+
+        // Returns the signal number received (when readable), or 0
+        int Read();
+
+    private:
+        int     read_fd;
+#ifndef LINUX
+        int     write_fd;
+        static int pipe_fd;  // (for the handler)
+        static void Handler(int sigNum);
+#endif // !LINUX
+};  // end class SignalEvent
+
+class TickTimer
+{
+    public:
+        TickTimer();
+        ~TickTimer();
+
+        // Starts ticking every "msec"
+        bool Open(unsigned int msec);
+        void Close();
+        // (-1 if the timer is not a descriptor, see GetTimeout())
+        int GetDescriptor() const
+            {return timer_fd;}
+
+        // Returns the number of ticks since the last call (0 if none)
+        unsigned long Read();
+        // Msec until the next tick (-1 if the descriptor tells)
+        int GetTimeout() const;
+
+    private:
+        int             timer_fd;
+        unsigned int    interval;
+        struct timeval  next_tick;
+};  // end class TickTimer
+
+#endif // _EVENT_SOURCE
@@ -0,0 +1,2318 @@
+// gpsBench - gpsLogger performance benchmarks
+//
+// Each benchmark is self-contained (pseudo-terminals stand in for
+// the GPS serial device) and reports one "<bench> <metric> <value> <units>"
+// line per measurement to <stdout>, or with the "json" option, a single
+// JSON document of all the measurements (to track regressions between
+// versions, see "make bench").
+
+#include "serialInput.h"
+#include "nmeaParse.h"
+#include "nmeaStream.h"
+#include "gpsPub.h"
+#include "clockDiscipline.h"
+#include "ppsCapture.h"
+#include "gpsReceiver.h"
+#include "gpsPipeline.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <termios.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/ioctl.h>
+#include <sys/utsname.h>
+#include <pthread.h>
+
+static const char* SAMPLE_SENTENCES[] =
+{
+    "$GPRMC,170834.000,A,4124.89630,N,08151.68380,W,0.02,31.66,280511,,,A*45\r\n",
+    "$GPGGA,170834.000,4124.89630,N,08151.68380,W,1,08,0.9,280.2,M,-34.0,M,,*6B\r\n",
+    "$GPGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1*39\r\n",
+    "$GPGSV,2,1,08,01,40,083,46,02,17,308,41,12,07,344,39,14,22,228,45*75\r\n",
+    NULL
+};
+
+// Sentences of each type known to the parser (any talker ID) with the
+// GPS_VALID_* fields each should give (0 if not parsed by default)
+typedef struct SentenceCase
+{
+    const char*     sentence;
+    unsigned int    valid;
+} SentenceCase;
+static const SentenceCase SENTENCE_CASES[] =
+{
+    {"$GNRMC,170834.000,A,4124.89630,N,08151.68380,W,0.02,31.66,280511,,,A*5B\r\n",
+        GPS_VALID_XY | GPS_VALID_TIME | GPS_VALID_SPEED | GPS_VALID_HEADING},
+    {"$GNGGA,170834.000,4124.89630,N,08151.68380,W,2,14,0.8,280.2,M,-34.0,M,,*7A\r\n",
+        GPS_VALID_XY | GPS_VALID_Z | GPS_VALID_HDOP | GPS_VALID_SATELLITES | GPS_VALID_QUALITY},
+    {"$GNGGA,170834.000,4124.89630,N,08151.68380,,2,14,0.8,280.2,M,-34.0,M,,*2D\r\n",
+        GPS_VALID_Z | GPS_VALID_HDOP | GPS_VALID_SATELLITES | GPS_VALID_QUALITY},  // (no E/W)
+    {"$GNGNS,170834.000,4124.89630,N,08151.68380,W,DAN,14,0.8,280.2,-34.0,,*18\r\n",
+        GPS_VALID_XY | GPS_VALID_Z | GPS_VALID_HDOP | GPS_VALID_SATELLITES | GPS_VALID_QUALITY},
+    {"$GNGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1*27\r\n", GPS_VALID_HDOP},
+    {"$GPVTG,31.66,T,,M,0.02,N,0.04,K,A*09\r\n", GPS_VALID_SPEED | GPS_VALID_HEADING},
+    {"$GPZDA,170834.000,28,05,2011,00,00*52\r\n", GPS_VALID_TIME},
+    {"$GPGST,170834.000,2.1,1.5,1.0,45.0,1.2,1.3,2.5*5F\r\n", 0},
+    {"$GPGSV,2,1,08,01,40,083,46,02,17,308,41,12,07,344,39,14,22,228,45*75\r\n", 0},
+    {"$GPGLL,4124.89630,N,08151.68380,W,170834.000,A,A*4D\r\n", 0},
+    {"$PGRME,15.0,M,45.0,M,25.0,M*1C\r\n", 0},
+    {NULL, 0}
+};
+
+#if defined(LINUX) && !defined(__SANITIZE_ADDRESS__)
+// Heap allocations are counted by interposing on the glibc allocator
+// so the parse path can be shown to be allocation-free (except in the
+// AddressSanitizer "make fuzz" build, which has its own allocator)
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* ptr, size_t size);
+static unsigned long alloc_count = 0;
+extern "C" void* malloc(size_t size)
+{
+    alloc_count++;
+    return __libc_malloc(size);
+}
+extern "C" void* calloc(size_t count, size_t size)
+{
+    alloc_count++;
+    return __libc_calloc(count, size);
+}
+extern "C" void* realloc(void* ptr, size_t size)
+{
+    alloc_count++;
+    return __libc_realloc(ptr, size);
+}
+#define HAVE_ALLOC_COUNT
+#endif // LINUX && !__SANITIZE_ADDRESS__
+
+static bool json_output = false;
+static unsigned int report_count = 0;
+
+static void Report(const char* bench, const char* metric, double value, const char* units)
+{
+    if (json_output)
+    {
+        // (bench, metric and units names need no JSON escaping)
+        fprintf(stdout, "%s\n    {\"bench\": \"%s\", \"metric\": \"%s\", \"value\": ",
+                        report_count ? "," : "", bench, metric);
+        if (isfinite(value))
+            fprintf(stdout, "%.3f", value);
+        else
+            fprintf(stdout, "null");
+        fprintf(stdout, ", \"units\": \"%s\"}", units);
+    }
+    else
+    {
+        fprintf(stdout, "%s %s %.3f %s\n", bench, metric, value, units);
+    }
+    report_count++;
+}  // end Report()
+
+// The JSON document's header and trailer, identifying the run
+static void ReportBegin(const char* bench)
+{
+    if (!json_output) return;
+    struct utsname host;
+    if (uname(&host)) strcpy(host.nodename, "unknown");
+    fprintf(stdout, "{\n  \"benchmark\": \"%s\",\n  \"host\": \"%s\",\n"
+                    "  \"time\": %ld,\n  \"results\": [", 
+                    bench, host.nodename, (long)time(NULL));
+    fflush(stdout);  // (before any fork())
+}  // end ReportBegin()
+
+static void ReportEnd(bool result)
+{
+    if (!json_output) return;
+    fprintf(stdout, "\n  ],\n  \"passed\": %s\n}\n", result ? "true" : "false");
+}  // end ReportEnd()
+
+static double CpuUsec()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return ((double)usage.ru_utime.tv_sec + (double)usage.ru_stime.tv_sec)*1.0e06 +
+           (double)usage.ru_utime.tv_usec + (double)usage.ru_stime.tv_usec;
+}  // end CpuUsec()
+
+static double MonotonicNsec()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec*1.0e09 + (double)now.tv_nsec;
+}  // end MonotonicNsec()
+
+// Opens a pseudo-terminal pair, with the slave side configured like
+// gpsLogger configures a serial port (raw, VMIN=0, VTIME timeout)
+static bool OpenPty(int& masterFd, int& slaveFd)
+{
+    if ((masterFd = posix_openpt(O_RDWR | O_NOCTTY)) < 0)
+    {
+        perror("gpsBench: posix_openpt() error");
+        return false;
+    }
+    if (grantpt(masterFd) || unlockpt(masterFd))
+    {
+        perror("gpsBench: grantpt()/unlockpt() error");
+        close(masterFd);
+        return false;
+    }
+    if ((slaveFd = open(ptsname(masterFd), O_RDWR | O_NOCTTY)) < 0)
+    {
+        perror("gpsBench: pty slave open() error");
+        close(masterFd);
+        return false;
+    }
+    struct termios attr;
+    tcgetattr(slaveFd, &attr);
+    cfmakeraw(&attr);
+    attr.c_cc[VTIME] = 10;  // 1 second timeout
+    attr.c_cc[VMIN] = 0;
+    tcsetattr(slaveFd, TCSANOW, &attr);
+    return true;
+}  // end OpenPty()
+
+// Writes "count" sample sentences to "fd", in "burst" byte pieces
+// paced at the given "baud" rate (like a UART FIFO would deliver them)
+static void FeedSentences(int fd, unsigned int count, unsigned int baud, unsigned int burst)
+{
+    unsigned int byteNsec = 10000000 / baud * 1000;
+    unsigned int k = 0;
+    for (unsigned int i = 0; i < count; i++)
+    {
+        const char* sentence = SAMPLE_SENTENCES[k++];
+        if (!SAMPLE_SENTENCES[k]) k = 0;
+        unsigned int len = strlen(sentence);
+        unsigned int put = 0;
+        while (put < len)
+        {
+            unsigned int n = ((len - put) < burst) ? (len - put) : burst;
+            int result = write(fd, sentence + put, n);
+            if (result < 0)
+            {
+                if (EINTR == errno) continue;
+                perror("gpsBench: write() error");
+                return;
+            }
+            put += result;
+            struct timespec delay;
+            delay.tv_sec = 0;
+            delay.tv_nsec = (long)result * byteNsec;
+            nanosleep(&delay, NULL);
+        }
+    }
+}  // end FeedSentences()
+
+// Compares the original one read() plus gettimeofday() per byte
+// serial loop against chunked SerialInput reads
+static bool BenchSerial(unsigned int count, unsigned int baud, unsigned int burst)
+{
+    for (int mode = 0; mode < 2; mode++)
+    {
+        const char* bench = (0 == mode) ? "serial.per_byte" : "serial.chunked";
+        int masterFd, slaveFd;
+        if (!OpenPty(masterFd, slaveFd)) return false;
+        pid_t pid = fork();
+        if (pid < 0)
+        {
+            perror("gpsBench: fork() error");
+            return false;
+        }
+        else if (0 == pid)
+        {
+            close(slaveFd);
+            FeedSentences(masterFd, count, baud, burst);
+            sleep(1);  // let reader drain before hangup
+            _exit(0);
+        }
+        close(masterFd);
+
+        unsigned int sentences = 0;
+        unsigned long reads = 0;
+        unsigned long clockCalls = 0;
+        double startCpu = CpuUsec();
+        if (0 == mode)
+        {
+            while (sentences < count)
+            {
+                char character;
+                int result = read(slaveFd, &character, 1);
+                struct timeval currentTime;
+                gettimeofday(&currentTime, NULL);
+                reads++;
+                clockCalls++;
+                if (result <= 0) break;
+                if ('\n' == character) sentences++;
+            }
+        }
+        else
+        {
+            SerialInput serialInput;
+            serialInput.SetDescriptor(slaveFd);
+            serialInput.SetBaud(baud);
+            while (sentences < count)
+            {
+                char character;
+                struct timeval arrivalTime;
+                if (serialInput.GetByte(character, arrivalTime) <= 0) break;
+                if ('\n' == character) sentences++;
+            }
+            reads = clockCalls = serialInput.GetReadCount();
+        }
+        double cpu = CpuUsec() - startCpu;
+        close(slaveFd);
+        kill(pid, SIGTERM);
+        waitpid(pid, NULL, 0);
+        if (0 == sentences)
+        {
+            fprintf(stderr, "gpsBench: %s received no sentences!\n", bench);
+            return false;
+        }
+        Report(bench, "sentences", sentences, "count");
+        Report(bench, "read_calls_per_sentence", (double)reads / sentences, "calls");
+        Report(bench, "clock_calls_per_sentence", (double)clockCalls / sentences, "calls");
+        Report(bench, "cpu_per_sentence", cpu / sentences, "usec");
+    }
+    return true;
+}  // end BenchSerial()
+
+// Times NMEAParser::GetTimeAndPosition() over the sample sentences
+// (as framed by gpsLogger, i.e. without the '$' and "*hh" checksum)
+// and verifies that the parse path never allocates
+static bool BenchParse(unsigned int count)
+{
+    char corpus[16][NMEAParser::MAX_SENTENCE_LENGTH + 1];
+    unsigned int corpusLength[16];
+    unsigned int corpusCount = 0;
+    for (const char** s = SAMPLE_SENTENCES; *s; s++)
+    {
+        const char* end = strchr(*s, '*');
+        unsigned int len = end - (*s + 1);
+        memcpy(corpus[corpusCount], *s + 1, len);
+        corpus[corpusCount][len] = '\0';
+        corpusLength[corpusCount++] = len;
+    }
+    
+    GPSPosition pos;
+    memset(&pos, 0, sizeof(pos));
+    for (unsigned int k = 0; k < corpusCount; k++)  // warm-up
+        NMEAParser::GetTimeAndPosition(corpus[k], corpusLength[k], &pos);
+#ifdef HAVE_ALLOC_COUNT
+    unsigned long allocStart = alloc_count;
+#endif // HAVE_ALLOC_COUNT
+    unsigned int fixes = 0;
+    double start = MonotonicNsec();
+    for (unsigned int i = 0; i < count; i++)
+    {
+        unsigned int k = i % corpusCount;
+        if (NMEAParser::GetTimeAndPosition(corpus[k], corpusLength[k], &pos))
+            fixes++;
+    }
+    double elapsed = MonotonicNsec() - start;
+    
+    // Unwanted sentences (e.g. a flood of GSV) are rejected by dispatch
+    const char* gsv = corpus[corpusCount - 1];
+    unsigned int gsvLength = corpusLength[corpusCount - 1];
+    unsigned int rejected = 0;
+    double rejectStart = MonotonicNsec();
+    for (unsigned int i = 0; i < count; i++)
+    {
+        if (!NMEAParser::GetTimeAndPosition(gsv, gsvLength, &pos))
+            rejected++;
+    }
+    double rejectElapsed = MonotonicNsec() - rejectStart;
+#ifdef HAVE_ALLOC_COUNT
+    unsigned long allocs = alloc_count - allocStart;
+#endif // HAVE_ALLOC_COUNT
+    Report("parse", "sentences", count, "count");
+    Report("parse", "fixes", fixes, "count");
+    Report("parse", "time_per_sentence", elapsed / count, "nsec");
+    Report("parse", "rejected", rejected, "count");
+    Report("parse", "time_per_rejected_sentence", rejectElapsed / count, "nsec");
+#ifdef HAVE_ALLOC_COUNT
+    Report("parse", "allocations", allocs, "count");
+    if (0 != allocs)
+    {
+        fprintf(stderr, "gpsBench: parse path performed heap allocations!\n");
+        return false;
+    }
+#endif // HAVE_ALLOC_COUNT
+    return true;
+}  // end BenchParse()
+
+// Former sentence handling:  frame the sentence into a buffer, then
+// checksum it, then parse (tokenize and convert) it
+class BufferedNMEA
+{
+    public:
+        BufferedNMEA() : state(SEEKING), length(0), checksum_length(0) {}
+        // Returns true when a sentence gives a fix
+        bool PutByte(char c, GPSPositionV2& fix)
+        {
+            if ('$' == c)
+            {
+                state = READING;
+                length = 0;
+            }
+            else if (READING == state)
+            {
+                if ('*' == c)
+                {
+                    state = CHECKSUM;
+                    checksum_length = 0;
+                }
+                else if (length < NMEAParser::MAX_SENTENCE_LENGTH)
+                {
+                    buffer[length++] = c;
+                }
+            }
+            else if (CHECKSUM == state)
+            {
+                checksum_buffer[checksum_length++] = c;
+                if (checksum_length > 2)
+                {
+                    state = SEEKING;
+                    checksum_buffer[checksum_length] = '\0';
+                    int inputChecksum;
+                    if (1 != sscanf(checksum_buffer, "%x", &inputChecksum)) return false;
+                    unsigned char calculatedChecksum = 0;
+                    for (unsigned int i = 0; i < length; i++)
+                        calculatedChecksum ^= (unsigned char)buffer[i];
+                    if (inputChecksum != calculatedChecksum) return false;
+                    NMEAParser::SentenceInfo info;
+                    return NMEAParser::GetTimeAndPosition(buffer, length, &fix, &info);
+                }
+            }
+            return false;
+        }
+    private:
+        enum {SEEKING, READING, CHECKSUM} state;
+        char            buffer[NMEAParser::MAX_SENTENCE_LENGTH + 1];
+        unsigned int    length;
+        char            checksum_buffer[8];
+        unsigned int    checksum_length;
+};  // end class BufferedNMEA
+
+// Compares the former buffer, checksum, then parse sentence handling with
+// the single pass NMEAStream, in total time per sentence and in the time
+// from a sentence's last byte (its CR) until its fix is ready
+static bool BenchStream(unsigned int count)
+{
+    // (the sample sentences repeated, as one input stream)
+    char input[1024];
+    unsigned int inputLength = 0;
+    unsigned int sentences = 0;
+    for (const char** s = SAMPLE_SENTENCES; *s; s++)
+    {
+        unsigned int len = strlen(*s);
+        memcpy(input + inputLength, *s, len);
+        inputLength += len;
+        sentences++;
+    }
+    struct timeval arrivalTime = {0, 0};
+    
+    BufferedNMEA buffered;
+    NMEAStream stream;
+    GPSPositionV2 fix;
+    unsigned int bufferedFixes = 0;
+    unsigned int streamFixes = 0;
+    double bufferedLast = 0.0;
+    double streamLast = 0.0;
+    
+    // 1) Total time
+    unsigned int rounds = (count + sentences - 1) / sentences;
+    double start = MonotonicNsec();
+    for (unsigned int r = 0; r < rounds; r++)
+    {
+        for (unsigned int i = 0; i < inputLength; i++)
+            if (buffered.PutByte(input[i], fix)) bufferedFixes++;
+    }
+    double bufferedElapsed = MonotonicNsec() - start;
+    start = MonotonicNsec();
+    for (unsigned int r = 0; r < rounds; r++)
+    {
+        for (unsigned int i = 0; i < inputLength; i++)
+            if (NMEAStream::FIX == stream.PutByte(input[i], arrivalTime)) streamFixes++;
+    }
+    double streamElapsed = MonotonicNsec() - start;
+    
+    // 2) Last byte until fix (i.e. the handling of each sentence's final byte)
+    unsigned int lastCount = 0;
+    for (unsigned int r = 0; r < rounds; r++)
+    {
+        for (unsigned int i = 0; i < inputLength; i++)
+        {
+            if ('\r' == input[i])
+            {
+                // (the former framing completes at the checksum's 3rd character, the CR)
+                double t = MonotonicNsec();
+                buffered.PutByte(input[i], fix);
+                bufferedLast += MonotonicNsec() - t;
+                t = MonotonicNsec();
+                stream.PutByte(input[i], arrivalTime);
+                streamLast += MonotonicNsec() - t;
+                lastCount++;
+            }
+            else
+            {
+                buffered.PutByte(input[i], fix);
+                stream.PutByte(input[i], arrivalTime);
+            }
+        }
+    }
+    unsigned int total = rounds * sentences;
+    Report("stream", "sentences", total, "count");
+    Report("stream", "buffered_fixes", bufferedFixes, "count");
+    Report("stream", "stream_fixes", streamFixes, "count");
+    Report("stream", "buffered_time_per_sentence", bufferedElapsed / total, "nsec");
+    Report("stream", "stream_time_per_sentence", streamElapsed / total, "nsec");
+    Report("stream", "buffered_last_byte_to_fix", bufferedLast / lastCount, "nsec");
+    Report("stream", "stream_last_byte_to_fix", streamLast / lastCount, "nsec");
+    if (bufferedFixes != streamFixes)
+    {
+        fprintf(stderr, "gpsBench: stream and buffered parsing fix counts differ!\n");
+        return false;
+    }
+    return true;
+}  // end BenchStream()
+
+// Checks the NMEA angle/time/altitude conversions against known values
+// (expected angles are correctly rounded, so results must match exactly)
+// and reports the error the former "float" minutes conversion had
+static bool BenchPrecision()
+{
+    struct AngleCase
+    {
+        const char*     text;
+        unsigned int    degDigits;
+        double          expected;
+    };
+    static const AngleCase ANGLES[] =
+    {
+        {"4124.89630",      2, 41.414938333333333333333},
+        {"08151.68380",     3, 81.861396666666666666667},
+        {"3854.9271234",    2, 38.915452056666666666667},
+        {"17959.9999999",   3, 179.99999999833333333333},
+        {"0000.00001",      2, 1.6666666666666666666667e-7},
+        {"8959.99999",      2, 89.999999833333333333333},
+        {"07702.123456789", 3, 77.035390946483333333333},
+        {NULL,              0, 0.0}
+    };
+    const double METERS_PER_DEGREE = 111319.49;  // (at the equator)
+    bool result = true;
+    double maxLegacyError = 0.0;
+    for (const AngleCase* c = ANGLES; c->text; c++)
+    {
+        double degrees;
+        if (!NMEAParser::ParseAngle(c->text, strlen(c->text), c->degDigits, degrees) ||
+            (degrees != c->expected))
+        {
+            fprintf(stderr, "gpsBench: angle \"%s\" parsed as %.15f (expected %.15f)\n",
+                            c->text, degrees, c->expected);
+            result = false;
+        }
+        char temp[4];
+        memcpy(temp, c->text, c->degDigits);
+        temp[c->degDigits] = '\0';
+        float min;
+        sscanf(c->text + c->degDigits, "%f", &min);
+        double legacy = (double)atoi(temp) + (min/60.0);
+        double error = (legacy > c->expected) ? (legacy - c->expected) : (c->expected - legacy);
+        if (error > maxLegacyError) maxLegacyError = error;
+    }
+    Report("precision", "angle_cases", (double)(sizeof(ANGLES)/sizeof(AngleCase) - 1), "count");
+    Report("precision", "legacy_float_max_error", maxLegacyError*METERS_PER_DEGREE*1000.0, "mm");
+    
+    unsigned int hour, minute, second;
+    unsigned long usec;
+    if (!NMEAParser::ParseTimeOfDay("235959.999999", 13, hour, minute, second, usec) ||
+        (23 != hour) || (59 != minute) || (59 != second) || (999999 != usec) ||
+        !NMEAParser::ParseTimeOfDay("170834.12", 9, hour, minute, second, usec) ||
+        (120000 != usec) || NMEAParser::ParseTimeOfDay("176034.000", 10, hour, minute, second, usec))
+    {
+        fprintf(stderr, "gpsBench: time of day conversion mismatch!\n");
+        result = false;
+    }
+    
+    NMEAParser::Decimal alt;
+    if (!NMEAParser::ParseDecimal("-34.0", 5, alt) || (-34.0 != NMEAParser::DecimalToDouble(alt)) ||
+        !NMEAParser::ParseDecimal("280.2", 5, alt) || (280.2 != NMEAParser::DecimalToDouble(alt)) ||
+        NMEAParser::ParseDecimal("28a.2", 5, alt) || NMEAParser::ParseDecimal("2.8.2", 5, alt))
+    {
+        fprintf(stderr, "gpsBench: decimal conversion mismatch!\n");
+        result = false;
+    }
+    
+    // Each sentence type, with any talker ID, gives its fields (and ZDA
+    // the same time as RMC)
+    unsigned int sentenceCases = 0;
+    time_t rmcTime = 0;
+    for (const SentenceCase* c = SENTENCE_CASES; c->sentence; c++)
+    {
+        const char* body = c->sentence + 1;
+        unsigned int len = strchr(body, '*') - body;
+        GPSPositionV2 fix;
+        NMEAParser::SentenceInfo info;
+        bool parsed = NMEAParser::GetTimeAndPosition(body, len, &fix, &info);
+        if ((0 != c->valid) != parsed)
+        {
+            fprintf(stderr, "gpsBench: sentence \"%.*s\" %s\n", len, body,
+                            parsed ? "unexpectedly parsed" : "not parsed");
+            result = false;
+        }
+        else if (parsed && (fix.valid != c->valid))
+        {
+            fprintf(stderr, "gpsBench: sentence \"%.*s\" valid fields 0x%02x (expected 0x%02x)\n",
+                            len, body, fix.valid, c->valid);
+            result = false;
+        }
+        else if (parsed && (0 != (fix.valid & GPS_VALID_TIME)))
+        {
+            if (0 == rmcTime) rmcTime = fix.gps_time.tv_sec;
+            if (fix.gps_time.tv_sec != rmcTime)
+            {
+                fprintf(stderr, "gpsBench: sentence \"%.*s\" time mismatch\n", len, body);
+                result = false;
+            }
+        }
+        sentenceCases++;
+    }
+    Report("precision", "sentence_cases", sentenceCases, "count");
+    Report("precision", "passed", result ? 1.0 : 0.0, "bool");
+    return result;
+}  // end BenchPrecision()
+
+// Position "k" published by BenchPublish() (so readers can detect torn copies)
+static void MakePosition(long k, GPSPosition& pos)
+{
+    memset(&pos, 0, sizeof(pos));
+    pos.x = (double)k;
+    pos.y = -(double)k;
+    pos.z = 2.0*(double)k;
+    pos.gps_time.tv_sec = k;
+    pos.sys_time.tv_sec = k;
+    pos.sys_time.tv_usec = k % 1000000;
+    pos.xyvalid = pos.zvalid = pos.tvalid = true;
+    pos.stale = (int)(k & 1);
+}  // end MakePosition()
+
+static bool PositionIsConsistent(const GPSPosition& pos)
+{
+    long k = (long)pos.x;
+    return ((pos.y == -pos.x) && (pos.z == 2.0*pos.x) &&
+            (pos.gps_time.tv_sec == k) && (pos.sys_time.tv_sec == k) &&
+            (pos.sys_time.tv_usec == (k % 1000000)) && (pos.stale == (int)(k & 1)));
+}  // end PositionIsConsistent()
+
+// Measures publish/read cost and stresses the sequence-locked publication
+// with "readers" concurrent reader processes checking for torn reads
+static bool BenchPublish(unsigned int count, unsigned int readers, unsigned int seconds)
+{
+    char keyFile[64];
+    sprintf(keyFile, "/tmp/gpsBench.%d", (int)getpid());
+    GPSHandle handle = GPSPublishInit(keyFile);
+    if (!handle)
+    {
+        fprintf(stderr, "gpsBench: GPSPublishInit() error\n");
+        return false;
+    }
+    
+    // 1) Uncontended cost per operation
+    GPSPosition pos;
+    double start = MonotonicNsec();
+    for (unsigned int i = 0; i < count; i++)
+    {
+        MakePosition(i, pos);
+        GPSPublishUpdate(handle, &pos);
+    }
+    Report("publish", "update_time", (MonotonicNsec() - start) / count, "nsec");
+    start = MonotonicNsec();
+    unsigned int torn = 0;
+    for (unsigned int i = 0; i < count; i++)
+    {
+        if (!GPSGetCurrentPosition(handle, &pos) || !PositionIsConsistent(pos)) torn++;
+    }
+    Report("publish", "get_time", (MonotonicNsec() - start) / count, "nsec");
+    
+    // Subscriber attach (shm_open() and mmap()) and its first read, which
+    // shouldn't page fault (the subscription is mapped with its pages present)
+    const unsigned int ATTACHES = 1000;
+    double attachNsec = 0.0, firstReadNsec = 0.0;
+    long faults = 0;
+    for (unsigned int i = 0; i < ATTACHES; i++)
+    {
+        double t = MonotonicNsec();
+        GPSHandle sub = GPSSubscribe(keyFile);
+        attachNsec += MonotonicNsec() - t;
+        if (!sub)
+        {
+            GPSPublishShutdown(handle, keyFile);
+            return false;
+        }
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        long startFaults = usage.ru_minflt + usage.ru_majflt;
+        GPSPositionV2 posV2;
+        t = MonotonicNsec();
+        GPSGetCurrentPositionV2(sub, &posV2);
+        firstReadNsec += MonotonicNsec() - t;
+        getrusage(RUSAGE_SELF, &usage);
+        faults += usage.ru_minflt + usage.ru_majflt - startFaults;
+        GPSUnsubscribe(sub);
+    }
+    Report("publish", "subscribe_time", attachNsec / ATTACHES / 1000.0, "usec");
+    Report("publish", "first_read_time", firstReadNsec / ATTACHES, "nsec");
+    Report("publish", "first_read_faults", (double)faults / ATTACHES, "faults");
+    
+    // Publisher liveness check cost (polled by control loops)
+    GPSHandle watcher = GPSSubscribe(keyFile);
+    if (!watcher)
+    {
+        GPSPublishShutdown(handle, keyFile);
+        return false;
+    }
+    unsigned int valid = 0;
+    start = MonotonicNsec();
+    for (unsigned int i = 0; i < count; i++)
+    {
+        if (GPSSubscriptionIsValid(watcher)) valid++;
+    }
+    Report("publish", "valid_time", (MonotonicNsec() - start) / count, "nsec");
+    if (valid != count)
+    {
+        fprintf(stderr, "gpsBench: live publication found invalid!\n");
+        GPSUnsubscribe(watcher);
+        GPSPublishShutdown(handle, keyFile);
+        return false;
+    }
+    
+    // 2) Concurrent reader processes vs. a continuously publishing writer
+    int fds[2];
+    if (pipe(fds))
+    {
+        perror("gpsBench: pipe() error");
+        GPSUnsubscribe(watcher);
+        GPSPublishShutdown(handle, keyFile);
+        return false;
+    }
+    for (unsigned int r = 0; r < readers; r++)
+    {
+        pid_t pid = fork();
+        if (pid < 0)
+        {
+            perror("gpsBench: fork() error");
+            break;
+        }
+        else if (0 == pid)
+        {
+            close(fds[0]);
+            unsigned long result[2] = {0, 0};  // reads, torn reads
+            GPSHandle sub = GPSSubscribe(keyFile);
+            if (sub)
+            {
+                double end = MonotonicNsec() + (double)seconds*1.0e09;
+                while (MonotonicNsec() < end)
+                {
+                    for (int i = 0; i < 1000; i++)
+                    {
+                        GPSPosition p;
+                        if (!GPSGetCurrentPosition(sub, &p) || !PositionIsConsistent(p))
+                            result[1]++;
+                    }
+                    result[0] += 1000;
+                }
+                GPSUnsubscribe(sub);
+            }
+            if (write(fds[1], result, sizeof(result)) < 0)
+                perror("gpsBench: write() error");
+            _exit(0);
+        }
+    }
+    close(fds[1]);
+    double end = MonotonicNsec() + (double)seconds*1.0e09;
+    unsigned long updates = 0;
+    long k = count;
+    while (MonotonicNsec() < end)
+    {
+        for (int i = 0; i < 1000; i++)
+        {
+            MakePosition(k++, pos);
+            GPSPublishUpdate(handle, &pos);
+        }
+        updates += 1000;
+    }
+    unsigned long reads = 0;
+    unsigned long result[2];
+    while (sizeof(result) == read(fds[0], result, sizeof(result)))
+    {
+        reads += result[0];
+        torn += result[1];
+    }
+    close(fds[0]);
+    while (wait(NULL) > 0);
+    GPSPublishShutdown(handle, keyFile);
+    bool validAfterShutdown = GPSSubscriptionIsValid(watcher);
+    GPSUnsubscribe(watcher);
+    
+    Report("publish", "readers", readers, "count");
+    Report("publish", "updates_per_sec", (double)updates / seconds, "ops");
+    Report("publish", "reads_per_sec", (double)reads / seconds, "ops");
+    Report("publish", "torn_reads", torn, "count");
+    if (validAfterShutdown)
+    {
+        fprintf(stderr, "gpsBench: publication still valid after shutdown!\n");
+        return false;
+    }
+    if (0 != torn)
+    {
+        fprintf(stderr, "gpsBench: detected torn position reads!\n");
+        return false;
+    }
+    return true;
+}  // end BenchPublish()
+
+static int CompareDouble(const void* a, const void* b)
+{
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x < y) ? -1 : ((x > y) ? 1 : 0);
+}  // end CompareDouble()
+
+// Measures the latency from GPSPublishUpdate() until GPSWaitForUpdate()
+// returns in each of "subscribers" processes (the publish time is
+// carried in the published "x" value)
+static bool BenchWakeupRun(const char* keyFile, GPSHandle handle, 
+                           unsigned int subscribers, unsigned int updates)
+{
+    int fds[2];
+    if (pipe(fds))
+    {
+        perror("gpsBench: pipe() error");
+        return false;
+    }
+    unsigned int started = 0;
+    for (unsigned int r = 0; r < subscribers; r++)
+    {
+        pid_t pid = fork();
+        if (pid < 0)
+        {
+            perror("gpsBench: fork() error");
+            break;
+        }
+        else if (0 == pid)
+        {
+            close(fds[0]);
+            // summary[] = mean, p50, p99, max (usec)
+            double summary[4] = {-1.0, -1.0, -1.0, -1.0};
+            double* latency = new double[updates];
+            unsigned int n = 0;
+            GPSHandle sub = GPSSubscribe(keyFile);
+            if (sub)
+            {
+                unsigned int seq = GPSGetSequence(sub);
+                while (n < updates)
+                {
+                    unsigned int next = GPSWaitForUpdate(sub, seq, 2000);
+                    double now = MonotonicNsec();
+                    if (next == seq) break;  // timed out
+                    seq = next;
+                    GPSPosition p;
+                    GPSGetCurrentPosition(sub, &p);
+                    if (p.x > 0.0) latency[n++] = (now - p.x) / 1000.0;
+                }
+                GPSUnsubscribe(sub);
+            }
+            if (n > 0)
+            {
+                double sum = 0.0;
+                for (unsigned int i = 0; i < n; i++) sum += latency[i];
+                qsort(latency, n, sizeof(double), CompareDouble);
+                summary[0] = sum / n;
+                summary[1] = latency[n/2];
+                summary[2] = latency[(n*99)/100];
+                summary[3] = latency[n-1];
+            }
+            if (write(fds[1], summary, sizeof(summary)) < 0)
+                perror("gpsBench: write() error");
+            _exit(0);
+        }
+        started++;
+    }
+    close(fds[1]);
+    
+    usleep(200000 + started*2000);  // let subscribers attach and wait
+    GPSPosition pos;
+    memset(&pos, 0, sizeof(pos));
+    for (unsigned int i = 0; i < updates; i++)
+    {
+        pos.x = MonotonicNsec();
+        GPSPublishUpdate(handle, &pos);
+        usleep(2000 + started*50);  // let all subscribers wake and wait again
+    }
+    
+    double summary[4];
+    double mean = 0.0, p50 = 0.0, p99 = 0.0, max = 0.0;
+    unsigned int reporting = 0;
+    while (sizeof(summary) == read(fds[0], summary, sizeof(summary)))
+    {
+        if (summary[0] < 0.0) continue;
+        reporting++;
+        mean += summary[0];
+        p50 += summary[1];
+        if (summary[2] > p99) p99 = summary[2];
+        if (summary[3] > max) max = summary[3];
+    }
+    close(fds[0]);
+    while (wait(NULL) > 0);
+    if (reporting < started)
+    {
+        fprintf(stderr, "gpsBench: only %u of %u subscribers reported!\n", reporting, started);
+        return false;
+    }
+    char bench[32];
+    sprintf(bench, "wakeup.%u", subscribers);
+    Report(bench, "subscribers", reporting, "count");
+    Report(bench, "latency_mean", mean / reporting, "usec");
+    Report(bench, "latency_p50", p50 / reporting, "usec");
+    Report(bench, "latency_p99", p99, "usec");
+    Report(bench, "latency_max", max, "usec");
+    return true;
+}  // end BenchWakeupRun()
+
+static bool BenchWakeup(unsigned int updates, unsigned int subscribers)
+{
+    char keyFile[64];
+    sprintf(keyFile, "/tmp/gpsBench.%d", (int)getpid());
+    GPSHandle handle = GPSPublishInit(keyFile);
+    if (!handle)
+    {
+        fprintf(stderr, "gpsBench: GPSPublishInit() error\n");
+        return false;
+    }
+    bool result = true;
+    if (0 != subscribers)
+    {
+        result = BenchWakeupRun(keyFile, handle, subscribers, updates);
+    }
+    else
+    {
+        const unsigned int COUNTS[] = {1, 10, 100};
+        for (unsigned int i = 0; result && (i < 3); i++)
+            result = BenchWakeupRun(keyFile, handle, COUNTS[i], updates);
+    }
+    GPSPublishShutdown(handle, keyFile);
+    return result;
+}  // end BenchWakeup()
+
+static struct timeval SecondsToTimeval(double seconds)
+{
+    struct timeval time;
+    time.tv_sec = (time_t)floor(seconds);
+    time.tv_usec = (suseconds_t)((seconds - time.tv_sec) * 1.0e06 + 0.5);
+    if (time.tv_usec > 999999)
+    {
+        time.tv_sec++;
+        time.tv_usec -= 1000000;
+    }
+    return time;
+}  // end SecondsToTimeval()
+
+// Runs one clock steering "mode" against a SimulatedClock for
+// "seconds" (simulated) pulses and reports the true clock offset
+// statistics over the second half of the run (after acquisition).
+// CLOCK_PUBLISHER steers through gpsLogger's PublisherStage::AdjustClock()
+// with the clock starting ahead of GPS time, so the offsets it sees are
+// negative and must reach the loop, not be taken for a time change.
+enum ClockMode {CLOCK_ADJTIME, CLOCK_LOOP, CLOCK_LOOP_ADJTIME, CLOCK_PUBLISHER};
+static bool BenchClockRun(ClockMode mode, unsigned int seconds)
+{
+    const double OSCILLATOR_PPM = 25.0;
+    const double JITTER_USEC = 20.0;
+    SimulatedClock clock(OSCILLATOR_PPM, JITTER_USEC);
+    clock.SetOffset(0.002);  // (as if settimeofday() got it within 2 msec)
+    if (CLOCK_LOOP_ADJTIME == mode) clock.DisableFrequency();
+    ClockDiscipline discipline;
+    discipline.Init(&clock);
+    char keyFile[64];
+    GPSHandle handle = NULL;
+    PublisherStage publisher;
+    GPSStats stats;
+    memset(&stats, 0, sizeof(stats));
+    if (CLOCK_PUBLISHER == mode)
+    {
+        clock.SetOffset(-0.002);  // (ahead)
+        sprintf(keyFile, "/tmp/gpsBench.%d", (int)getpid());
+        handle = GPSPublishInit(keyFile);
+        if (!handle)
+        {
+            fprintf(stderr, "gpsBench: GPSPublishInit() error\n");
+            return false;
+        }
+        // (unthreaded, so each Put() is serviced at once)
+        publisher.Open(handle, NULL);
+        publisher.SetStats(&stats);
+        publisher.SetClock(true, true, false, true, ClockDiscipline::DEFAULT_TIME_CONSTANT, &clock);
+    }
+    bool result = true;
+    double sumSquare = 0.0;
+    double maxOffset = 0.0;
+    unsigned int samples = 0;
+    double start = MonotonicNsec();
+    for (unsigned int i = 0; i < seconds; i++)
+    {
+        // Sample the true offset through the second (saw-tooth included)
+        for (int j = 0; j < 10; j++)
+        {
+            clock.Advance(0.1);
+            if (i >= seconds/2)
+            {
+                double offset = clock.GetTrueOffset();
+                sumSquare += offset * offset;
+                if (fabs(offset) > maxOffset) maxOffset = fabs(offset);
+                samples++;
+            }
+        }
+        // PPS: measure and correct
+        double offset = clock.MeasureOffset();
+        if (CLOCK_ADJTIME == mode)
+        {
+            clock.SlewPhase(offset);  // (the former per-pulse adjtime())
+        }
+        else if (CLOCK_PUBLISHER == mode)
+        {
+            // (the pulse's system time, and the GPS time it marks; not
+            // flagged "pps", which would time the adjustment by the
+            // real clock)
+            FixEvent event;
+            memset(&event, 0, sizeof(event));
+            event.type = FixEvent::CLOCK;
+            event.ref_time = SecondsToTimeval(clock.GetLocalTime());
+            event.fix.gps_time = SecondsToTimeval(clock.GetLocalTime() + offset);
+            publisher.Put(event);
+            // (a reading taken for a large time change is delayed first, so
+            // this stops before the real clock could be stepped)
+            if (stats.counter[GPS_STATS_TIME_CHANGES_DELAYED] || stats.counter[GPS_STATS_TIME_CHANGES])
+            {
+                fprintf(stderr, "gpsBench: clock offset %.6f sec taken for a time change!\n", offset);
+                result = false;
+                break;
+            }
+        }
+        else
+        {
+            discipline.Update(offset, clock.GetLocalTime());
+        }
+    }
+    double elapsed = (MonotonicNsec() - start) / 1.0e09;
+    if (CLOCK_PUBLISHER == mode) GPSPublishShutdown(handle, keyFile);
+    if (!result) return false;
+    const char* NAMES[] = {"clock.adjtime", "clock.loop", "clock.loop_adjtime", "clock.publisher"};
+    const char* bench = NAMES[mode];
+    Report(bench, "offset_rms", 1.0e06 * sqrt(sumSquare / samples), "usec");
+    Report(bench, "offset_max", 1.0e06 * maxOffset, "usec");
+    if ((CLOCK_LOOP == mode) || (CLOCK_LOOP_ADJTIME == mode))
+        Report(bench, "frequency_error", fabs(OSCILLATOR_PPM + discipline.GetFrequency()), "ppm");
+    Report(bench, "speedup", seconds / elapsed, "x_realtime");
+    return true;
+}  // end BenchClockRun()
+
+// Compares the former per-pulse adjtime() phase correction with the
+// frequency-disciplining loop (with adjtimex() frequency adjustment and
+// with adjtime() only) on a simulated clock with a 25 ppm oscillator
+// error and 20 usec (1 sigma) PPS timestamp jitter, and then the loop
+// as gpsLogger's publisher stage drives it
+static bool BenchClock(unsigned int seconds)
+{
+    return (BenchClockRun(CLOCK_ADJTIME, seconds) &&
+            BenchClockRun(CLOCK_LOOP, seconds) &&
+            BenchClockRun(CLOCK_LOOP_ADJTIME, seconds) &&
+            BenchClockRun(CLOCK_PUBLISHER, seconds));
+}  // end BenchClock()
+
+// A PPSSource whose "edges" are bytes written to a pipe by BenchPPS()
+class PipePPS : public PPSSource
+{
+    public:
+        PipePPS(int readFd, int writeFd) : read_fd(readFd), write_fd(writeFd) {}
+
+        const char* GetName() const
+            {return "pipe";}
+        bool WaitForEdge(struct timeval& edgeTime)
+        {
+            char c;
+            if (1 != read(read_fd, &c, 1)) return false;
+            gettimeofday(&edgeTime, NULL);
+            if ('q' != c) return true;
+            errno = EINTR;  // (Stop() called)
+            return false;
+        }
+        void Interrupt(pthread_t /*thread*/)
+        {
+            if (1 != write(write_fd, "q", 1))
+                perror("gpsBench: write() error");
+        }
+
+    private:
+        int read_fd;
+        int write_fd;
+};  // end class PipePPS
+
+// Fake PPS edge source for BenchPPS():  each edge is timestamped,
+// made visible as a "line state" change (for polling) and written
+// to the PipePPS pipe
+typedef struct EdgeSource
+{
+    unsigned int    count;
+    unsigned int    period_usec;
+    int             write_fd;
+    struct timeval* times;      // [count] true edge times
+    unsigned long   sequence;   // (polled line state)
+    bool            done;
+} EdgeSource;
+
+static void* EdgeSourceMain(void* arg)
+{
+    EdgeSource* source = (EdgeSource*)arg;
+    usleep(source->period_usec);
+    for (unsigned int i = 0; i < source->count; i++)
+    {
+        gettimeofday(&source->times[i], NULL);
+        __atomic_store_n(&source->sequence, i + 1, __ATOMIC_RELEASE);
+        if (1 != write(source->write_fd, "e", 1))
+            perror("gpsBench: write() error");
+        usleep(source->period_usec);
+    }
+    __atomic_store_n(&source->done, true, __ATOMIC_RELEASE);
+    return NULL;
+}  // end EdgeSourceMain()
+
+static double EdgeErrorUsec(const struct timeval& detected, const struct timeval& actual)
+{
+    return (1.0e06 * (detected.tv_sec - actual.tv_sec) +
+            ((long)detected.tv_usec - (long)actual.tv_usec));
+}  // end EdgeErrorUsec()
+
+static void ReportEdgeErrors(const char* bench, double* errors, unsigned int count,
+                             unsigned int missed)
+{
+    Report(bench, "edges", count, "count");
+    Report(bench, "missed", missed, "count");
+    if (0 == count) return;
+    qsort(errors, count, sizeof(double), CompareDouble);
+    double mean = 0.0;
+    for (unsigned int i = 0; i < count; i++) mean += errors[i];
+    mean /= count;
+    double var = 0.0;
+    for (unsigned int i = 0; i < count; i++) var += (errors[i] - mean) * (errors[i] - mean);
+    Report(bench, "timestamp_error_mean", mean, "usec");
+    Report(bench, "timestamp_error_p50", errors[count/2], "usec");
+    Report(bench, "timestamp_error_p99", errors[(count*99)/100], "usec");
+    Report(bench, "timestamp_error_max", errors[count-1], "usec");
+    Report(bench, "timestamp_jitter", sqrt(var / count), "usec");
+}  // end ReportEdgeErrors()
+
+// Reads sentences from a pseudo-terminal (at the given "baud") while a
+// fake edge source generates "count" pulses and compares two ways of
+// timestamping them:  polling the line state after each serial read
+// (as the serial loop formerly did with TIOCMGET) and the PPSCapture
+// thread (blocked waiting for the edge)
+static bool BenchPPS(unsigned int count, unsigned int baud, unsigned int burst)
+{
+    const unsigned int PERIOD_USEC = 100000;
+    int masterFd, slaveFd;
+    if (!OpenPty(masterFd, slaveFd)) return false;
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        perror("gpsBench: fork() error");
+        return false;
+    }
+    else if (0 == pid)
+    {
+        close(slaveFd);
+        // (enough sentences to keep the serial loop busy throughout)
+        unsigned int sentences = (unsigned int)(((double)count + 2) * PERIOD_USEC * 1.0e-06 * baud / 10 / 60) + 10;
+        FeedSentences(masterFd, sentences, baud, burst);
+        sleep(1);
+        _exit(0);
+    }
+    close(masterFd);
+    
+    int edgePipe[2];
+    if (pipe(edgePipe))
+    {
+        perror("gpsBench: pipe() error");
+        return false;
+    }
+    struct timeval* actual = new struct timeval[count];
+    struct timeval* polled = new struct timeval[count];
+    struct timeval* captured = new struct timeval[count];
+    bool* havePolled = new bool[count];
+    bool* haveCaptured = new bool[count];
+    memset(havePolled, 0, count * sizeof(bool));
+    memset(haveCaptured, 0, count * sizeof(bool));
+    PipePPS pipeSource(edgePipe[0], edgePipe[1]);
+    PPSCapture capture;
+    if (!capture.Start(&pipeSource))
+        return false;
+    EdgeSource source;
+    source.count = count;
+    source.period_usec = PERIOD_USEC;
+    source.write_fd = edgePipe[1];
+    source.times = actual;
+    source.sequence = 0;
+    source.done = false;
+    pthread_t sourceThread;
+    if (0 != pthread_create(&sourceThread, NULL, EdgeSourceMain, &source))
+    {
+        fprintf(stderr, "gpsBench: pthread_create() error\n");
+        return false;
+    }
+    
+    SerialInput serialInput;
+    serialInput.SetDescriptor(slaveFd);
+    serialInput.SetBaud(baud);
+    unsigned long readCount = 0;
+    unsigned long lastSequence = 0;
+    while (!__atomic_load_n(&source.done, __ATOMIC_ACQUIRE))
+    {
+        char character;
+        struct timeval arrivalTime;
+        if (serialInput.GetByte(character, arrivalTime) <= 0)
+        {
+            fprintf(stderr, "gpsBench: serial input ended early\n");
+            break;
+        }
+        if (readCount == serialInput.GetReadCount()) continue;
+        readCount = serialInput.GetReadCount();
+        struct timeval now;
+        gettimeofday(&now, NULL);
+        // The former way:  poll the line state after each read
+        unsigned long sequence = __atomic_load_n(&source.sequence, __ATOMIC_ACQUIRE);
+        if (sequence != lastSequence)
+        {
+            // (any pulses between polls are missed)
+            polled[sequence - 1] = now;
+            havePolled[sequence - 1] = true;
+            lastSequence = sequence;
+        }
+        // Edges captured by the PPSCapture thread
+        PPSEdge edge;
+        if (capture.GetEdge(now, 10.0, edge) && (edge.sequence <= count))
+        {
+            captured[edge.sequence - 1] = edge.time;
+            haveCaptured[edge.sequence - 1] = true;
+        }
+    }
+    pthread_join(sourceThread, NULL);
+    usleep(10000);
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    PPSEdge edge;
+    if (capture.GetEdge(now, 10.0, edge) && (edge.sequence <= count))
+    {
+        captured[edge.sequence - 1] = edge.time;
+        haveCaptured[edge.sequence - 1] = true;
+    }
+    capture.Stop();
+    close(slaveFd);
+    kill(pid, SIGTERM);
+    waitpid(pid, NULL, 0);
+    close(edgePipe[0]);
+    close(edgePipe[1]);
+
+    double* errors = new double[count];
+    unsigned int n = 0;
+    for (unsigned int i = 0; i < count; i++)
+        if (havePolled[i]) errors[n++] = EdgeErrorUsec(polled[i], actual[i]);
+    ReportEdgeErrors("pps.poll", errors, n, count - n);
+    n = 0;
+    for (unsigned int i = 0; i < count; i++)
+        if (haveCaptured[i]) errors[n++] = EdgeErrorUsec(captured[i], actual[i]);
+    ReportEdgeErrors("pps.capture", errors, n, count - n);
+    delete[] errors;
+    delete[] actual;
+    delete[] polled;
+    delete[] captured;
+    delete[] havePolled;
+    delete[] haveCaptured;
+    return true;
+}  // end BenchPPS()
+
+// Captures "count" edges from "source" (pulsing every "periodUsec")
+// and reports the timestamp jitter, from the spread of the intervals
+// between successive edges (so no reference clock is needed)
+static bool BenchPPSSourceRun(const char* bench, PPSSource* source,
+                              unsigned int count, unsigned int periodUsec)
+{
+    PPSCapture capture;
+    if (!capture.Start(source)) return false;
+    double* intervals = new double[count];
+    unsigned int n = 0;
+    unsigned int missed = 0;
+    bool haveLast = false;
+    struct timeval last;
+    double timeout = 1.0e-06 * periodUsec * (count + 5) + 2.0;
+    double start = MonotonicNsec();
+    while ((n < count) && ((MonotonicNsec() - start) < (timeout * 1.0e09)))
+    {
+        usleep(periodUsec / 10);
+        struct timeval now;
+        gettimeofday(&now, NULL);
+        PPSEdge edge;
+        if (!capture.GetEdge(now, 10.0, edge)) continue;
+        if (haveLast)
+        {
+            double interval = EdgeErrorUsec(edge.time, last);
+            if (interval > 1.5 * periodUsec)
+                missed++;
+            else
+                intervals[n++] = interval - periodUsec;
+        }
+        last = edge.time;
+        haveLast = true;
+    }
+    capture.Stop();
+    Report(bench, "intervals", n, "count");
+    Report(bench, "missed", missed, "count");
+    if (0 != n)
+    {
+        double mean = 0.0;
+        double max = 0.0;
+        for (unsigned int i = 0; i < n; i++)
+        {
+            mean += intervals[i];
+            if (fabs(intervals[i]) > max) max = fabs(intervals[i]);
+        }
+        mean /= n;
+        double var = 0.0;
+        for (unsigned int i = 0; i < n; i++) 
+            var += (intervals[i] - mean) * (intervals[i] - mean);
+        // (each interval is the difference of two independent errors)
+        Report(bench, "timestamp_jitter", sqrt(var / n / 2.0), "usec");
+        Report(bench, "interval_error_max", max, "usec");
+    }
+    delete[] intervals;
+    if (0 == n)
+    {
+        fprintf(stderr, "gpsBench: no PPS edges from %s source\n", source->GetName());
+        return false;
+    }
+    return true;
+}  // end BenchPPSSourceRun()
+
+// Measures PPS timestamp jitter for each PPSSource backend:  the fake
+// source (10 Hz, with 20 usec of injected jitter, as a check of the
+// measurement) and, if given, a serial port modem line ("device") and
+// a kernel PPS device ("ppsDevice")
+static bool BenchPPSSource(unsigned int count, const char* device, int ppsSignal,
+                           const char* ppsDevice)
+{
+    FakePPS fake(100000, 20.0);
+    if (!BenchPPSSourceRun("ppssource.fake", &fake, count ? count : 50, 100000))
+        return false;
+    if (device)
+    {
+        int fd = open(device, O_RDONLY | O_NOCTTY | O_NONBLOCK);
+        if (fd < 0)
+        {
+            perror("gpsBench: Error opening <serialDevice>");
+            return false;
+        }
+        ModemLinePPS line;
+        line.Init(fd, ppsSignal, false);
+        bool result = BenchPPSSourceRun("ppssource.line", &line, count ? count : 10, 1000000);
+        close(fd);
+        if (!result) return false;
+    }
+    if (ppsDevice)
+    {
+        KernelPPS kernel;
+        if (!kernel.Open(ppsDevice, false)) return false;
+        if (!BenchPPSSourceRun("ppssource.kernel", &kernel, count ? count : 10, 1000000))
+            return false;
+    }
+    return true;
+}  // end BenchPPSSource()
+
+// Formats an RMC and GGA sentence pair (with checksums) for "epoch"
+// (an epoch number, as the time of day in 0.1 second units)
+static unsigned int MakeEpochSentences(char* buffer, unsigned int epoch)
+{
+    unsigned int tenths = epoch % 864000;
+    char timeOfDay[16];
+    sprintf(timeOfDay, "%02u%02u%02u.%u", tenths / 36000, (tenths / 600) % 60,
+                                          (tenths / 10) % 60, tenths % 10);
+    char body[2][96];
+    sprintf(body[0], "GPRMC,%s,A,4124.89630,N,08151.68380,W,0.02,31.66,280511,,,A", timeOfDay);
+    sprintf(body[1], "GPGGA,%s,4124.89630,N,08151.68380,W,1,08,0.9,280.2,M,-34.0,M,,", timeOfDay);
+    unsigned int len = 0;
+    for (int k = 0; k < 2; k++)
+    {
+        unsigned char checksum = 0;
+        for (const char* ptr = body[k]; '\0' != *ptr; ptr++)
+            checksum ^= (unsigned char)*ptr;
+        len += sprintf(buffer + len, "$%s*%02X\r\n", body[k], checksum);
+    }
+    return len;
+}  // end MakeEpochSentences()
+
+// Feeds RMC and GGA sentences to every "masterFd" at "rate" epochs per
+// second (all devices per epoch, like receivers locked to GPS time)
+static void FeedDevices(const int* masterFds, unsigned int devices, unsigned int epochs,
+                        unsigned int rate)
+{
+    double periodNsec = 1.0e09 / rate;
+    double next = MonotonicNsec();
+    for (unsigned int e = 0; e < epochs; e++)
+    {
+        char buffer[256];
+        unsigned int len = MakeEpochSentences(buffer, e);
+        for (unsigned int d = 0; d < devices; d++)
+        {
+            if (write(masterFds[d], buffer, len) < 0)
+            {
+                perror("gpsBench: write() error");
+                return;
+            }
+        }
+        next += periodNsec;
+        double wait = next - MonotonicNsec();
+        if (wait > 0.0)
+        {
+            struct timespec delay;
+            delay.tv_sec = (time_t)(wait / 1.0e09);
+            delay.tv_nsec = (long)(wait - delay.tv_sec * 1.0e09);
+            nanosleep(&delay, NULL);
+        }
+    }
+}  // end FeedDevices()
+
+// Serves "devices" pseudo-terminal GPS receivers with one ReceiverLoop
+// (as a multi-device gpsLogger does) for "seconds" at "rate" epochs per
+// second, and reports the loop's CPU time per receiver and per sentence
+// (and the fixes published per epoch, which the epoch assembler makes one)
+static bool BenchMultiRun(unsigned int devices, unsigned int seconds, unsigned int rate)
+{
+    char bench[32];
+    sprintf(bench, "multi.%u", devices);
+    char keyFile[64];
+    sprintf(keyFile, "/tmp/gpsBench.%d", (int)getpid());
+    GPSHandle handle = GPSPublishInitSlots(keyFile, devices);
+    if (!handle)
+    {
+        fprintf(stderr, "gpsBench: GPSPublishInitSlots() error\n");
+        return false;
+    }
+    int* masterFds = new int[devices];
+    int* slaveFds = new int[devices];
+    GPSReceiver* receivers = new GPSReceiver[devices];
+    ReceiverLoop loop;
+    bool result = loop.Open();
+    unsigned int opened = 0;
+    for (; result && (opened < devices); opened++)
+    {
+        if (!OpenPty(masterFds[opened], slaveFds[opened]))
+        {
+            result = false;
+            break;
+        }
+        // (the pty is already raw, so it is opened as a non-serial "input")
+        GPSReceiver& receiver = receivers[opened];
+        if (!receiver.Open(ptsname(masterFds[opened]), false, 0) || !loop.Add(&receiver))
+        {
+            result = false;
+            opened++;
+            break;
+        }
+        receiver.SetPublication(GPSGetSlot(handle, opened));
+    }
+    pid_t pid = -1;
+    unsigned int epochs = seconds * rate;
+    if (result && ((pid = fork()) < 0))
+    {
+        perror("gpsBench: fork() error");
+        result = false;
+    }
+    else if (0 == pid)
+    {
+        FeedDevices(masterFds, devices, epochs, rate);
+        pause();  // (until killed, so the ptys stay open)
+        _exit(0);
+    }
+    if (result)
+    {
+        unsigned long expected = 2UL * epochs * devices;
+        unsigned long sentences = 0;
+        unsigned long fixes = 0;
+        unsigned long wakeups = 0;
+        double startCpu = CpuUsec();
+        double start = MonotonicNsec();
+        double deadline = start + (seconds + 2) * 1.0e09;
+        while ((sentences < expected) && (MonotonicNsec() < deadline))
+        {
+            if (loop.Poll(100) > 0) wakeups++;
+            sentences = 0;
+            for (unsigned int d = 0; d < devices; d++)
+                sentences += receivers[d].GetSentenceCount();
+        }
+        // (the last epoch is published upon its timeout)
+        struct timeval currentTime;
+        gettimeofday(&currentTime, NULL);
+        currentTime.tv_sec += 1;
+        for (unsigned int d = 0; d < devices; d++)
+        {
+            receivers[d].CheckStale(currentTime, 30);
+            fixes += receivers[d].GetFixCount();
+        }
+        double cpu = CpuUsec() - startCpu;
+        double elapsed = (MonotonicNsec() - start) / 1.0e03;  // usec
+        if (sentences < expected)
+            fprintf(stderr, "gpsBench: %s received %lu of %lu sentences!\n", bench, sentences, expected);
+        if (0 == sentences)
+        {
+            result = false;
+        }
+        else
+        {
+            Report(bench, "sentences", sentences, "count");
+            Report(bench, "fixes_per_epoch", (double)fixes / ((double)epochs * devices), "fixes");
+            Report(bench, "cpu_total", 100.0 * cpu / elapsed, "percent");
+            Report(bench, "cpu_per_receiver", 100.0 * cpu / elapsed / devices, "percent");
+            Report(bench, "cpu_per_sentence", cpu / sentences, "usec");
+            Report(bench, "wakeups_per_sentence", (double)wakeups / sentences, "calls");
+        }
+    }
+    if (pid > 0)
+    {
+        kill(pid, SIGTERM);
+        waitpid(pid, NULL, 0);
+    }
+    for (unsigned int d = 0; d < opened; d++)
+    {
+        receivers[d].Close();
+        close(masterFds[d]);
+        close(slaveFds[d]);
+    }
+    loop.Close();
+    delete[] receivers;
+    delete[] slaveFds;
+    delete[] masterFds;
+    GPSPublishShutdown(handle, keyFile);
+    return result;
+}  // end BenchMultiRun()
+
+static bool BenchMulti(unsigned int devices, unsigned int seconds, unsigned int rate)
+{
+    if (0 != devices) return BenchMultiRun(devices, seconds, rate);
+    // (by default, 1 to 32 devices)
+    for (unsigned int n = 1; n <= 32; n *= 2)
+    {
+        if (!BenchMultiRun(n, seconds, rate)) return false;
+    }
+    return true;
+}  // end BenchMulti()
+
+// Runs the real "gpsLogger" binary on a pseudo-terminal and measures
+// the end-to-end latency from the write() of each epoch's RMC and GGA
+// sentences until its fix is visible to a subscriber (GPSWaitForUpdate()
+// returns and the fix is that epoch's), for "epochs" epochs at "rate"
+// per second (with the parser and publisher stages each on a thread of
+// their own, i.e. gpsLogger's "pipeline" option, if "pipeline")
+static bool BenchEndToEnd(const char* gpsLogger, unsigned int epochs, unsigned int rate,
+                          bool pipeline = false)
+{
+    const char* bench = pipeline ? "endtoend.pipeline" : "endtoend";
+    const unsigned int WARMUP = 5;  // (until the epoch assembler expects RMC+GGA)
+    char keyFile[64];
+    sprintf(keyFile, "/tmp/gpsBench.%d", (int)getpid());
+    int masterFd, slaveFd;
+    if (!OpenPty(masterFd, slaveFd)) return false;
+    char device[64];
+    strncpy(device, ptsname(masterFd), 63);
+    device[63] = '\0';
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        perror("gpsBench: fork() error");
+        close(masterFd);
+        close(slaveFd);
+        return false;
+    }
+    else if (0 == pid)
+    {
+        // (any gpsLogger output goes to <stderr>, leaving <stdout> to the report)
+        dup2(STDERR_FILENO, STDOUT_FILENO);
+        close(masterFd);
+        close(slaveFd);
+        execl(gpsLogger, gpsLogger, "pub", keyFile, "device", device, 
+              "speed", "115200", "noLog", pipeline ? "pipeline" : (char*)NULL, (char*)NULL);
+        fprintf(stderr, "gpsBench: execl(%s) error: %s\n", gpsLogger, strerror(errno));
+        _exit(-1);
+    }
+    
+    // Wait for gpsLogger to publish
+    GPSHandle sub = NULL;
+    for (int i = 0; (i < 50) && !sub; i++)
+    {
+        usleep(100000);
+        if (0 != waitpid(pid, NULL, WNOHANG))
+        {
+            pid = -1;  // (exited)
+            break;
+        }
+        sub = GPSSubscribe(keyFile);
+    }
+    bool result = (NULL != sub);
+    if (!result) fprintf(stderr, "gpsBench: %s did not publish!\n", gpsLogger);
+    
+    double* latency = new double[epochs];
+    unsigned int n = 0;
+    unsigned int missed = 0;
+    double periodNsec = 1.0e09 / rate;
+    double next = MonotonicNsec();
+    for (unsigned int e = 0; result && (e < epochs + WARMUP); e++)
+    {
+        char buffer[256];
+        unsigned int len = MakeEpochSentences(buffer, e);
+        unsigned int tenths = e % 864000;
+        unsigned int seq = GPSGetSequence(sub);
+        double start = MonotonicNsec();
+        if (write(masterFd, buffer, len) < 0)
+        {
+            perror("gpsBench: write() error");
+            result = false;
+            break;
+        }
+        // (an update may be the previous epoch, e.g. published upon timeout)
+        bool found = false;
+        double end = start + periodNsec;
+        while (!found)
+        {
+            int timeout = (int)((end - MonotonicNsec()) / 1.0e06);
+            if (timeout <= 0) break;
+            unsigned int current = GPSWaitForUpdate(sub, seq, timeout);
+            double now = MonotonicNsec();
+            if (current == seq) break;  // timed out
+            seq = current;
+            GPSPositionV2 pos;
+            GPSGetCurrentPositionV2(sub, &pos);
+            if (!pos.stale && (0 != (pos.valid & GPS_VALID_TIME)) &&
+                (pos.gps_time.tv_sec % 60 == (long)((tenths / 10) % 60)) &&
+                (pos.gps_time.tv_usec / 100000 == (long)(tenths % 10)))
+            {
+                found = true;
+                if (e >= WARMUP) latency[n++] = (now - start) / 1000.0;
+            }
+        }
+        if (!found && (e >= WARMUP)) missed++;
+        next += periodNsec;
+        double wait = next - MonotonicNsec();
+        if (wait > 0.0) usleep((useconds_t)(wait / 1000.0));
+    }
+    
+    if (sub) GPSUnsubscribe(sub);
+    // (gpsLogger's own per-stage figures, copied before it shuts down)
+    GPSStats stageStats;
+    bool haveStageStats = false;
+    if (result && (pid > 0))
+    {
+        const GPSStats* stats = GPSStatsSubscribe(keyFile);
+        if (stats)
+        {
+            stageStats = *stats;
+            haveStageStats = true;
+            GPSStatsUnsubscribe(stats);
+        }
+    }
+    if (pid > 0)
+    {
+        kill(pid, SIGTERM);
+        waitpid(pid, NULL, 0);
+    }
+    close(masterFd);
+    close(slaveFd);
+    if (result && (0 == n))
+    {
+        fprintf(stderr, "gpsBench: no fixes were published!\n");
+        result = false;
+    }
+    if (result)
+    {
+        double sum = 0.0;
+        for (unsigned int i = 0; i < n; i++) sum += latency[i];
+        qsort(latency, n, sizeof(double), CompareDouble);
+        Report(bench, "epochs", n, "count");
+        Report(bench, "missed", missed, "count");
+        Report(bench, "latency_mean", sum / n, "usec");
+        Report(bench, "latency_p50", latency[n/2], "usec");
+        Report(bench, "latency_p99", latency[(n*99)/100], "usec");
+        Report(bench, "latency_max", latency[n-1], "usec");
+        for (unsigned int i = 0; haveStageStats && (i < GPS_STATS_HISTOGRAM_COUNT); i++)
+        {
+            const GPSHistogram& h = stageStats.histogram[i];
+            if (0 == h.count) continue;
+            char metric[64];
+            sprintf(metric, "%s_mean", GPSStatsGetHistogramName(i));
+            Report(bench, metric, 1.0e-03 * h.sum / h.count, "usec");
+            sprintf(metric, "%s_p99", GPSStatsGetHistogramName(i));
+            Report(bench, metric, 1.0e-03 * GPSStatsGetQuantile(&h, 0.99), "usec");
+        }
+    }
+    delete[] latency;
+    return result;
+}  // end BenchEndToEnd()
+
+// Feeds epochs (from "epoch" on) to "masterFd" at "rate" per second until
+// a subscriber ("sub") sees a fresh fix of one of them, for up to "msec".
+// Returns the msec that took (or -1).
+static double FeedUntilFix(int masterFd, GPSHandle sub, unsigned int& epoch,
+                           unsigned int rate, unsigned int msec)
+{
+    double start = MonotonicNsec();
+    double end = start + 1.0e06 * msec;
+    double periodNsec = 1.0e09 / rate;
+    double next = start;
+    unsigned int firstEpoch = epoch;
+    unsigned int seq = GPSGetSequence(sub);
+    while (MonotonicNsec() < end)
+    {
+        double now = MonotonicNsec();
+        if (now >= next)
+        {
+            char buffer[256];
+            unsigned int len = MakeEpochSentences(buffer, epoch++);
+            if (write(masterFd, buffer, len) < 0)
+            {
+                perror("gpsBench: write() error");
+                return -1.0;
+            }
+            next += periodNsec;
+        }
+        int timeout = (int)((next - MonotonicNsec()) / 1.0e06) + 1;
+        unsigned int current = GPSWaitForUpdate(sub, seq, timeout);
+        if (current == seq) continue;
+        seq = current;
+        GPSPositionV2 pos;
+        GPSGetCurrentPositionV2(sub, &pos);
+        if (pos.stale || (0 == (pos.valid & GPS_VALID_TIME))) continue;
+        // (a fix of an epoch fed since "start", by its time of day)
+        long tenths = (pos.gps_time.tv_sec % 86400) * 10 + pos.gps_time.tv_usec / 100000;
+        for (unsigned int e = firstEpoch; e < epoch; e++)
+        {
+            if ((long)(e % 864000) == tenths)
+                return (MonotonicNsec() - start) / 1.0e06;
+        }
+    }
+    return -1.0;
+}  // end FeedUntilFix()
+
+// Opens a pseudo-terminal pair (see OpenPty()) and points the "link"
+// symlink at its slave (the "device" gpsLogger opens, so it can be
+// "unplugged" and "plugged in" again at the same name)
+static bool OpenLinkedPty(const char* link, int& masterFd, int& slaveFd)
+{
+    if (!OpenPty(masterFd, slaveFd)) return false;
+    char tempLink[80];
+    sprintf(tempLink, "%s.new", link);
+    unlink(tempLink);
+    if (symlink(ptsname(masterFd), tempLink) || rename(tempLink, link))
+    {
+        perror("gpsBench: symlink() error");
+        close(masterFd);
+        close(slaveFd);
+        return false;
+    }
+    return true;
+}  // end OpenLinkedPty()
+
+// Runs the real "gpsLogger" binary on a pseudo-terminal and "unplugs" it
+// (closes it, so gpsLogger's reads fail) "cycles" times, each time making
+// a new one available at the same device name, and measures the time from
+// the unplug until the publication is marked stale ("detect") and from the
+// new device until a subscriber sees a fresh fix ("recover"), checking that
+// the publication (the same subscription) stays valid throughout
+static bool BenchReconnect(const char* gpsLogger, unsigned int cycles, unsigned int rate)
+{
+    char keyFile[64], device[64];
+    sprintf(keyFile, "/tmp/gpsBench.%d", (int)getpid());
+    sprintf(device, "/tmp/gpsBench.%d.tty", (int)getpid());
+    int masterFd, slaveFd;
+    if (!OpenLinkedPty(device, masterFd, slaveFd)) return false;
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        perror("gpsBench: fork() error");
+        close(masterFd);
+        close(slaveFd);
+        unlink(device);
+        return false;
+    }
+    else if (0 == pid)
+    {
+        // (any gpsLogger output goes to <stderr>, leaving <stdout> to the report)
+        dup2(STDERR_FILENO, STDOUT_FILENO);
+        close(masterFd);
+        close(slaveFd);
+        execl(gpsLogger, gpsLogger, "pub", keyFile, "device", device, 
+              "speed", "115200", "noLog", (char*)NULL);
+        fprintf(stderr, "gpsBench: execl(%s) error: %s\n", gpsLogger, strerror(errno));
+        _exit(-1);
+    }
+    
+    // Wait for gpsLogger to publish
+    GPSHandle sub = NULL;
+    for (int i = 0; (i < 50) && !sub; i++)
+    {
+        usleep(100000);
+        if (0 != waitpid(pid, NULL, WNOHANG))
+        {
+            pid = -1;  // (exited)
+            break;
+        }
+        sub = GPSSubscribe(keyFile);
+    }
+    bool result = (NULL != sub);
+    if (!result) fprintf(stderr, "gpsBench: %s did not publish!\n", gpsLogger);
+    unsigned int epoch = 0;
+    if (result && (FeedUntilFix(masterFd, sub, epoch, rate, 5000) < 0.0))
+    {
+        fprintf(stderr, "gpsBench: no fixes were published!\n");
+        result = false;
+    }
+    
+    double* detect = new double[cycles];
+    double* recover = new double[cycles];
+    unsigned int n = 0;
+    unsigned int failed = 0;
+    for (unsigned int c = 0; result && (c < cycles); c++)
+    {
+        // Unplug, and wait for the publication to go stale
+        unsigned int seq = GPSGetSequence(sub);
+        double start = MonotonicNsec();
+        close(masterFd);
+        close(slaveFd);
+        masterFd = slaveFd = -1;
+        double detectMsec = -1.0;
+        while ((MonotonicNsec() - start) < 2.0e09)
+        {
+            unsigned int current = GPSWaitForUpdate(sub, seq, 100);
+            if (current == seq) continue;
+            seq = current;
+            GPSPositionV2 pos;
+            GPSGetCurrentPositionV2(sub, &pos);
+            if (pos.stale)
+            {
+                detectMsec = (MonotonicNsec() - start) / 1.0e06;
+                break;
+            }
+        }
+        // Plug in a new device, and wait for a fresh fix
+        if (!OpenLinkedPty(device, masterFd, slaveFd))
+        {
+            result = false;
+            break;
+        }
+        double recoverMsec = FeedUntilFix(masterFd, sub, epoch, rate, 5000);
+        if ((detectMsec < 0.0) || (recoverMsec < 0.0) || !GPSSubscriptionIsValid(sub))
+        {
+            failed++;
+            continue;
+        }
+        detect[n] = detectMsec;
+        recover[n] = recoverMsec;
+        n++;
+    }
+    
+    if (sub) GPSUnsubscribe(sub);
+    if (pid > 0)
+    {
+        kill(pid, SIGTERM);
+        waitpid(pid, NULL, 0);
+    }
+    if (masterFd >= 0) close(masterFd);
+    if (slaveFd >= 0) close(slaveFd);
+    unlink(device);
+    if (result && (0 != failed))
+    {
+        fprintf(stderr, "gpsBench: %u of %u reconnections failed!\n", failed, cycles);
+        result = false;
+    }
+    if (result && (n > 0))
+    {
+        double detectSum = 0.0, recoverSum = 0.0;
+        for (unsigned int i = 0; i < n; i++)
+        {
+            detectSum += detect[i];
+            recoverSum += recover[i];
+        }
+        qsort(detect, n, sizeof(double), CompareDouble);
+        qsort(recover, n, sizeof(double), CompareDouble);
+        Report("reconnect", "cycles", n, "count");
+        Report("reconnect", "detect_mean", detectSum / n, "msec");
+        Report("reconnect", "detect_max", detect[n-1], "msec");
+        Report("reconnect", "recover_mean", recoverSum / n, "msec");
+        Report("reconnect", "recover_p50", recover[n/2], "msec");
+        Report("reconnect", "recover_max", recover[n-1], "msec");
+    }
+    delete[] detect;
+    delete[] recover;
+    return result;
+}  // end BenchReconnect()
+
+// A small deterministic PRNG (xorshift32), so each fuzz run is repeatable
+static unsigned int fuzz_seed = 2463534242U;
+static unsigned int FuzzRandom(unsigned int range)
+{
+    fuzz_seed ^= fuzz_seed << 13;
+    fuzz_seed ^= fuzz_seed >> 17;
+    fuzz_seed ^= fuzz_seed << 5;
+    return fuzz_seed % range;
+}  // end FuzzRandom()
+
+// Mutates a sentence body (the text between '$' and '*') in place,
+// returning its new length (at most "maxLength")
+static unsigned int MutateSentence(char* body, unsigned int len, unsigned int maxLength)
+{
+    static const char ALPHABET[] = "0123456789.,-+ENSWAVMKT*$\r\n";
+    static const char* const NUMBERS[] = {"", "9999999999999999999999", "99.99999999999999",
+                                         "-1", "9060.0", "18060.00000", "235960.999",
+                                         ".", "-.", "1e9", "0x10", "+0"};
+    unsigned int mutations = 1 + FuzzRandom(4);
+    for (unsigned int m = 0; m < mutations; m++)
+    {
+        unsigned int pos = len ? FuzzRandom(len) : 0;
+        switch (FuzzRandom(6))
+        {
+            case 0:  // replace a byte
+                if (len)
+                    body[pos] = FuzzRandom(4) ? ALPHABET[FuzzRandom(sizeof(ALPHABET) - 1)]
+                                              : (char)FuzzRandom(256);
+                break;
+            case 1:  // delete a byte
+                if (len)
+                {
+                    memmove(body + pos, body + pos + 1, len - pos - 1);
+                    len--;
+                }
+                break;
+            case 2:  // insert a byte (usually a field separator)
+                if (len < maxLength)
+                {
+                    memmove(body + pos + 1, body + pos, len - pos);
+                    body[pos] = FuzzRandom(2) ? ',' : ALPHABET[FuzzRandom(sizeof(ALPHABET) - 1)];
+                    len++;
+                }
+                break;
+            case 3:  // truncate
+                len = pos;
+                break;
+            case 4:  // replace the field at "pos" with an extreme value
+            {
+                unsigned int start = pos;
+                while ((start > 0) && (',' != body[start - 1])) start--;
+                unsigned int end = pos;
+                while ((end < len) && (',' != body[end])) end++;
+                const char* number = NUMBERS[FuzzRandom(sizeof(NUMBERS) / sizeof(NUMBERS[0]))];
+                unsigned int numberLength = strlen(number);
+                if (len - (end - start) + numberLength > maxLength) break;
+                memmove(body + start + numberLength, body + end, len - end);
+                memcpy(body + start, number, numberLength);
+                len = len - (end - start) + numberLength;
+                break;
+            }
+            default:  // swap the talker ID (e.g. for a proprietary or bad one)
+                if (len >= 2)
+                {
+                    body[0] = 'A' + FuzzRandom(26);
+                    body[1] = FuzzRandom(8) ? ('A' + FuzzRandom(26)) : 'p';
+                }
+                break;
+        }
+    }
+    return len;
+}  // end MutateSentence()
+
+// Returns NULL if a parsed fix is sane, or else what is wrong with it
+static const char* CheckFix(const GPSPositionV2& fix)
+{
+    const unsigned int ALL_VALID = GPS_VALID_XY | GPS_VALID_Z | GPS_VALID_TIME | 
+                                   GPS_VALID_SPEED | GPS_VALID_HEADING | GPS_VALID_HDOP |
+                                   GPS_VALID_SATELLITES | GPS_VALID_QUALITY;
+    if (0 != (fix.valid & ~ALL_VALID)) return "unknown valid flags";
+    if (0 != (fix.valid & GPS_VALID_XY))
+    {
+        if (!isfinite(fix.x) || !isfinite(fix.y)) return "non-finite position";
+        if ((fabs(fix.x) > 180.0) || (fabs(fix.y) > 90.0)) return "position out of range";
+    }
+    if ((0 != (fix.valid & GPS_VALID_Z)) && !isfinite(fix.z)) return "non-finite altitude";
+    if ((0 != (fix.valid & GPS_VALID_TIME)) && 
+        ((fix.gps_time.tv_usec < 0) || (fix.gps_time.tv_usec >= 1000000)))
+        return "time usec out of range";
+    if ((0 != (fix.valid & GPS_VALID_SPEED)) && !(fix.speed >= 0.0 && isfinite(fix.speed))) 
+        return "bad speed";
+    if ((0 != (fix.valid & GPS_VALID_HEADING)) && !isfinite(fix.heading)) return "bad heading";
+    if ((0 != (fix.valid & GPS_VALID_HDOP)) && !isfinite(fix.hdop)) return "bad HDOP";
+    return NULL;
+}  // end CheckFix()
+
+// Feeds "count" randomly mutated sentences to both NMEAStream and
+// NMEAParser::GetTimeAndPosition() (given an exactly sized heap copy, so
+// the AddressSanitizer build of "make fuzz" catches any over-read).  The
+// fixes must be sane, and the two parse paths must agree on any sentence
+// the stream frames as given.
+static bool BenchFuzz(unsigned int count)
+{
+    // Seed sentence bodies (without '$' or checksum)
+    char seeds[32][NMEAParser::MAX_SENTENCE_LENGTH + 1];
+    unsigned int seedCount = 0;
+    for (const SentenceCase* c = SENTENCE_CASES; c->sentence; c++)
+    {
+        const char* end = strchr(c->sentence, '*');
+        unsigned int len = end - (c->sentence + 1);
+        memcpy(seeds[seedCount], c->sentence + 1, len);
+        seeds[seedCount++][len] = '\0';
+    }
+    // (parse error messages are expected, so the <stderr> stream is muted
+    // meanwhile, but not its descriptor, which sanitizer reports are written to)
+    FILE* nullFile = fopen("/dev/null", "w");
+    if (NULL == nullFile)
+    {
+        perror("gpsBench: /dev/null error");
+        return false;
+    }
+    fflush(stderr);
+    FILE* savedStderr = stderr;
+    stderr = nullFile;
+    
+    const unsigned int MAX_BODY = 2 * NMEAParser::MAX_SENTENCE_LENGTH;
+    NMEAStream stream;
+    struct timeval arrivalTime = {0, 0};
+    unsigned long fixes = 0, sentences = 0, skipped = 0, framingErrors = 0;
+    unsigned long compared = 0, mismatches = 0, insane = 0;
+    const char* failure = NULL;
+    char failedInput[MAX_BODY + 8];  // (the first failing input, for reproduction)
+    failedInput[0] = '\0';
+#ifdef HAVE_ALLOC_COUNT
+    unsigned long allocs = 0;
+#endif // HAVE_ALLOC_COUNT
+    for (unsigned int i = 0; i < count; i++)
+    {
+        char body[MAX_BODY + 1];
+        const char* seed = seeds[FuzzRandom(seedCount)];
+        unsigned int len = strlen(seed);
+        memcpy(body, seed, len);
+        len = MutateSentence(body, len, MAX_BODY);
+        // (some, and the first, are over-length, and the stream's text of a
+        // framing error is then looked at, as debug output does)
+        if ((0 == i) || (0 == FuzzRandom(16)))
+        {
+            unsigned int overLength = NMEAParser::MAX_SENTENCE_LENGTH + 1 + FuzzRandom(8);
+            while (len < overLength) body[len++] = FuzzRandom(2) ? ',' : '0';
+        }
+        unsigned char checksum = 0;
+        for (unsigned int k = 0; k < len; k++) checksum ^= (unsigned char)body[k];
+        if (0 == FuzzRandom(4)) checksum ^= 1 + FuzzRandom(255);  // (a bad checksum)
+        char input[MAX_BODY + 8];
+        input[0] = '$';
+        memcpy(input + 1, body, len);
+        unsigned int inputLength = 1 + len;
+        inputLength += sprintf(input + inputLength, "*%02X\r\n", checksum);
+        
+        // 1) NMEAStream (noting the last event of the input)
+        GPSPositionV2 streamFix;
+        memset(&streamFix, 0, sizeof(streamFix));
+        NMEAStream::Event last = NMEAStream::NONE;
+        stream.Reset();
+#ifdef HAVE_ALLOC_COUNT
+        unsigned long allocStart = alloc_count;
+#endif // HAVE_ALLOC_COUNT
+        for (unsigned int k = 0; k < inputLength; k++)
+        {
+            NMEAStream::Event event = stream.PutByte(input[k], arrivalTime);
+            switch (event)
+            {
+                case NMEAStream::NONE:
+                    continue;
+                case NMEAStream::FIX:
+                    fixes++;
+                    streamFix = stream.GetFix();
+                    if (const char* problem = CheckFix(streamFix))
+                    {
+                        insane++;
+                        failure = problem;
+                    }
+                    break;
+                case NMEAStream::SENTENCE:
+                    sentences++;
+                    break;
+                case NMEAStream::SKIPPED:
+                    skipped++;
+                    break;
+                case NMEAStream::FRAMING_ERROR:
+                    framingErrors++;
+                    if (strlen(stream.GetSentence()) > NMEAParser::MAX_SENTENCE_LENGTH)
+                        failure = "framing error sentence text too long";
+                    break;
+            }
+            last = event;
+        }
+#ifdef HAVE_ALLOC_COUNT
+        allocs += alloc_count - allocStart;
+#endif // HAVE_ALLOC_COUNT
+        
+        // 2) GetTimeAndPosition() of the body, which the stream parsed
+        // the same way if it was one sentence with a good checksum
+        char* copy = (char*)malloc(len ? len : 1);
+        memcpy(copy, body, len);
+        GPSPositionV2 fix;
+        NMEAParser::SentenceInfo info;
+        bool parsed = NMEAParser::GetTimeAndPosition(copy, len, &fix, &info);
+        free(copy);
+        if (parsed)
+        {
+            if (const char* problem = CheckFix(fix))
+            {
+                insane++;
+                failure = problem;
+            }
+        }
+        bool framed = (len <= NMEAParser::MAX_SENTENCE_LENGTH) &&
+                      (NULL == memchr(body, '$', len)) && (NULL == memchr(body, '*', len)) &&
+                      (NULL == memchr(body, '\r', len)) && (NULL == memchr(body, '\n', len));
+        unsigned char actual = 0;
+        for (unsigned int k = 0; k < len; k++) actual ^= (unsigned char)body[k];
+        if (framed && (actual == checksum) && (NMEAStream::SKIPPED != last))
+        {
+            compared++;
+            bool agree = (parsed == (NMEAStream::FIX == last));
+            if (agree && parsed)
+            {
+                agree = (fix.valid == streamFix.valid) &&
+                        (fix.x == streamFix.x) && (fix.y == streamFix.y) &&
+                        (fix.z == streamFix.z) &&
+                        (fix.gps_time.tv_sec == streamFix.gps_time.tv_sec) &&
+                        (fix.gps_time.tv_usec == streamFix.gps_time.tv_usec);
+            }
+            if (!agree)
+            {
+                mismatches++;
+                failure = "stream and buffered parse differ";
+            }
+        }
+        if (failure && ('\0' == failedInput[0]))
+        {
+            memcpy(failedInput, input, inputLength - 2);  // (without CR/LF)
+            failedInput[inputLength - 2] = '\0';
+        }
+    }
+    
+    stderr = savedStderr;
+    fclose(nullFile);
+    Report("fuzz", "inputs", count, "count");
+    Report("fuzz", "fixes", fixes, "count");
+    Report("fuzz", "other_sentences", sentences, "count");
+    Report("fuzz", "skipped", skipped, "count");
+    Report("fuzz", "framing_errors", framingErrors, "count");
+    Report("fuzz", "compared", compared, "count");
+    Report("fuzz", "mismatches", mismatches, "count");
+    Report("fuzz", "bad_fixes", insane, "count");
+#ifdef HAVE_ALLOC_COUNT
+    Report("fuzz", "allocations", allocs, "count");
+    if (0 != allocs)
+    {
+        fprintf(stderr, "gpsBench: stream parse path performed heap allocations!\n");
+        return false;
+    }
+#endif // HAVE_ALLOC_COUNT
+    if (NULL != failure)
+    {
+        fprintf(stderr, "gpsBench: fuzz failure: %s (first failing input \"%s\")\n",
+                        failure, failedInput);
+        return false;
+    }
+    return true;
+}  // end BenchFuzz()
+
+static void Usage()
+{
+    fprintf(stderr, "Usage: gpsBench {serial|parse|stream|precision|publish|wakeup|clock|pps|ppssource|multi|\n"
+                    "                 endtoend|pipeline|reconnect|fuzz|suite}\n"
+                    "                [count <n>][speed <baud>][burst <bytes>]\n"
+                    "                [readers <n>][time <seconds>]\n"
+                    "                [device <serialDevice>][cts][ppsDevice <ppsDevice>]\n"
+                    "                [rate <epochsPerSecond>][logger <gpsLoggerPath>][json]\n");
+}  // end Usage()
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        Usage();
+        return -1;
+    }
+    const char* bench = argv[1];
+    unsigned int count = 0;  // (0 selects per-benchmark default)
+    unsigned int baud = 115200;
+    unsigned int burst = 16;
+    unsigned int readers = 0;  // (0 selects per-benchmark default)
+    unsigned int seconds = 2;
+    const char* device = NULL;
+    int ppsSignal = TIOCM_CD;
+    const char* ppsDevice = NULL;
+    unsigned int rate = 10;
+    const char* gpsLogger = "./gpsLogger";
+    for (int i = 2; i < argc; i++)
+    {
+        if (!strcmp("count", argv[i]) && (i+1 < argc))
+        {
+            count = atoi(argv[++i]);
+        }
+        else if (!strcmp("speed", argv[i]) && (i+1 < argc))
+        {
+            baud = atoi(argv[++i]);
+        }
+        else if (!strcmp("burst", argv[i]) && (i+1 < argc))
+        {
+            burst = atoi(argv[++i]);
+        }
+        else if (!strcmp("readers", argv[i]) && (i+1 < argc))
+        {
+            readers = atoi(argv[++i]);
+        }
+        else if (!strcmp("time", argv[i]) && (i+1 < argc))
+        {
+            seconds = atoi(argv[++i]);
+        }
+        else if (!strcmp("device", argv[i]) && (i+1 < argc))
+        {
+            device = argv[++i];
+        }
+        else if (!strcmp("cts", argv[i]))
+        {
+            ppsSignal = TIOCM_CTS;
+        }
+        else if (!strcmp("ppsDevice", argv[i]) && (i+1 < argc))
+        {
+            ppsDevice = argv[++i];
+        }
+        else if (!strcmp("rate", argv[i]) && (i+1 < argc))
+        {
+            rate = atoi(argv[++i]);
+        }
+        else if (!strcmp("logger", argv[i]) && (i+1 < argc))
+        {
+            gpsLogger = argv[++i];
+        }
+        else if (!strcmp("json", argv[i]))
+        {
+            json_output = true;
+        }
+        else
+        {
+            fprintf(stderr, "gpsBench: Invalid command!\n");
+            Usage();
+            return -1;
+        }
+    }
+    if ((0 == baud) || (0 == burst) || (0 == seconds) || (0 == rate))
+    {
+        fprintf(stderr, "gpsBench: Invalid option value!\n");
+        return -1;
+    }
+
+    ReportBegin(bench);
+    bool result;
+    if (!strcmp("serial", bench))
+    {
+        result = BenchSerial(count ? count : 1000, baud, burst);
+    }
+    else if (!strcmp("parse", bench))
+    {
+        result = BenchParse(count ? count : 1000000);
+    }
+    else if (!strcmp("stream", bench))
+    {
+        result = BenchStream(count ? count : 1000000);
+    }
+    else if (!strcmp("precision", bench))
+    {
+        result = BenchPrecision();
+    }
+    else if (!strcmp("publish", bench))
+    {
+        result = BenchPublish(count ? count : 1000000, readers ? readers : 4, seconds);
+    }
+    else if (!strcmp("wakeup", bench))
+    {
+        // (by default, runs with 1, 10 and 100 subscribers)
+        result = BenchWakeup(count ? count : 200, readers);
+    }
+    else if (!strcmp("clock", bench))
+    {
+        // ("count" is simulated seconds)
+        result = BenchClock(count ? count : 3600);
+    }
+    else if (!strcmp("pps", bench))
+    {
+        result = BenchPPS(count ? count : 50, baud, burst);
+    }
+    else if (!strcmp("ppssource", bench))
+    {
+        result = BenchPPSSource(count, device, ppsSignal, ppsDevice);
+    }
+    else if (!strcmp("multi", bench))
+    {
+        // ("count" is the number of devices, 1 to 32 by default)
+        result = BenchMulti(count, seconds, rate);
+    }
+    else if (!strcmp("endtoend", bench))
+    {
+        // ("count" is the number of epochs)
+        result = BenchEndToEnd(gpsLogger, count ? count : 100, rate);
+    }
+    else if (!strcmp("pipeline", bench))
+    {
+        // (the same, with gpsLogger's stages each on a thread of their own)
+        result = BenchEndToEnd(gpsLogger, count ? count : 100, rate, true);
+    }
+    else if (!strcmp("reconnect", bench))
+    {
+        // ("count" is the number of unplug/reconnect cycles)
+        result = BenchReconnect(gpsLogger, count ? count : 10, rate);
+    }
+    else if (!strcmp("fuzz", bench))
+    {
+        result = BenchFuzz(count ? count : 1000000);
+    }
+    else if (!strcmp("suite", bench))
+    {
+        // The regression suite (see "make bench"):  parser, publish path,
+        // end-to-end latency (without and with the pipeline threads) and
+        // reconnection, each with its defaults
+        result = BenchParse(1000000) && BenchStream(1000000) && BenchPrecision() &&
+                 BenchPublish(1000000, readers ? readers : 4, seconds) &&
+                 BenchWakeup(200, 1) && BenchEndToEnd(gpsLogger, 100, rate) &&
+                 BenchEndToEnd(gpsLogger, 100, rate, true) && BenchReconnect(gpsLogger, 10, rate);
+    }
+    else
+    {
+        fprintf(stderr, "gpsBench: Unknown benchmark \"%s\"\n", bench);
+        Usage();
+        ReportEnd(false);
+        return -1;
+    }
+    ReportEnd(result);
+    return result ? 0 : -1;
+}  // end main()
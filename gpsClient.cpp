@@ -6,21 +6,71 @@
 #include <stdlib.h>
 #include <unistd.h>
 
+// Prints the extended fields (of the latest fix) if the publisher has them
+static void PrintExtended(GPSHandle gpsHandle)
+{
+    GPSPositionV2 v2;
+    if (!GPSGetCurrentPositionV2(gpsHandle, &v2) || v2.stale) return;
+    fprintf(stdout, "  ");
+    if (v2.valid & GPS_VALID_SPEED) fprintf(stdout, " speed>%.2f m/s", v2.speed);
+    if (v2.valid & GPS_VALID_HEADING) fprintf(stdout, " heading>%.1f", v2.heading);
+    if (v2.valid & GPS_VALID_HDOP) fprintf(stdout, " hdop>%.1f", v2.hdop);
+    if (v2.valid & GPS_VALID_SATELLITES) fprintf(stdout, " satellites>%u", v2.satellites);
+    if (v2.valid & GPS_VALID_QUALITY) fprintf(stdout, " quality>%u", v2.quality);
+    fprintf(stdout, "\n");
+}  // end PrintExtended()
+
 int main(int argc, char* argv[])
 {
-    GPSHandle gpsHandle = GPSSubscribe();
+    // Usage: gpsClient [<keyFile> [<slot>]]
+    // (a multi-device gpsLogger publishes device "k" to slot "k")
+    const char* keyFile = (argc > 1) ? argv[1] : NULL;
+    unsigned int slot = (argc > 2) ? atoi(argv[2]) : 0;
+    GPSHandle gpsHandle = GPSSubscribeSlot(keyFile, slot);
     if (!gpsHandle)
     {
         fprintf(stderr, "gpsClient: Error subscribing to GPS position report.\n");
         exit(-1);   
     }
+    GPSPosition p;
+    if (!GPSGetCurrentPosition(gpsHandle, &p))
+        fprintf(stderr, "gpsClient: GPS publisher died mid-update.\n");
+    fprintf(stdout, "currentPosition: %f:%f:%f%s\n",
+            p.x, p.y, p.z, p.stale ? " (stale)" : "");
+    PrintExtended(gpsHandle);
+    fflush(stdout);
+    unsigned int sequence = GPSGetSequence(gpsHandle);
+    unsigned int nextFix = GPSGetFixCount(gpsHandle);
     while(1)
     {
-        GPSPosition p;
-        GPSGetCurrentPosition(gpsHandle, &p);
-        fprintf(stdout, "currentPosition: %f:%f:%f\n",
-                p.x, p.y, p.z);
-        sleep(1);   
+        // Sleep until the next update (or 10 seconds without one)
+        unsigned int next = GPSWaitForUpdate(gpsHandle, sequence, 10000);
+        if (next == sequence)
+        {
+            // (a publisher that is running, but without fixes, still beats its heartbeat)
+            if (GPSSubscriptionIsValid(gpsHandle))
+                fprintf(stderr, "gpsClient: No GPS update in 10 seconds.\n");
+            else
+                fprintf(stderr, "gpsClient: GPS publisher is not running.\n");
+        }
+        sequence = next;
+        // Process every fix published since we last looked
+        GPSPosition fixes[GPS_HISTORY_DEPTH];
+        unsigned int lost;
+        unsigned int count = GPSGetFixHistory(gpsHandle, &nextFix, fixes, 
+                                              GPS_HISTORY_DEPTH, &lost);
+        if (lost)
+            fprintf(stderr, "gpsClient: Missed %u fixes.\n", lost);
+        for (unsigned int i = 0; i < count; i++)
+            fprintf(stdout, "currentPosition: %f:%f:%f\n",
+                    fixes[i].x, fixes[i].y, fixes[i].z);
+        if (count) PrintExtended(gpsHandle);
+        if (0 == count)
+        {
+            GPSGetCurrentPosition(gpsHandle, &p);
+            if (p.stale) fprintf(stdout, "currentPosition: (stale)\n");
+        }
+        fflush(stdout);
     }
     GPSUnsubscribe(gpsHandle);
 }  // end main()
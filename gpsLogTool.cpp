@@ -0,0 +1,196 @@
+// gpsLogTool - converts gpsLogger text logs to the indexed binary log
+// format and queries binary logs by time range
+
+#include "binaryLog.h"
+#include "nmeaParse.h"  // for NMEAParser::DaysFromCivil()
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static void Usage()
+{
+    fprintf(stderr, "Usage: gpsLogTool convert <textLog> <binaryLog> <yyyy-mm-dd>\n"
+                    "       gpsLogTool query <binaryLog> [<startTime> [<endTime>]]\n"
+                    "       gpsLogTool info <binaryLog>\n"
+                    "(times are \"yyyy-mm-dd[Thh:mm[:ss[.ffffff]]]\" UTC or seconds since 1970)\n");
+}  // end Usage()
+
+// Parses a date/time argument to usec since 1970 (UTC)
+static bool ParseTime(const char* text, int64_t& usec)
+{
+    unsigned int year, month, day;
+    unsigned int hour = 0, minute = 0;
+    double second = 0.0;
+    int count = sscanf(text, "%u-%u-%uT%u:%u:%lf", &year, &month, &day, &hour, &minute, &second);
+    if (count >= 3)
+    {
+        if ((month < 1) || (month > 12) || (day < 1) || (day > 31) ||
+            (hour > 23) || (minute > 59) || (second < 0.0) || (second >= 61.0))
+            return false;
+        int64_t secs = (int64_t)NMEAParser::DaysFromCivil(year, month, day)*86400 + hour*3600 + minute*60;
+        usec = secs*1000000 + (int64_t)(second*1.0e06 + 0.5);
+        return true;
+    }
+    char* end;
+    double secs = strtod(text, &end);
+    if ((end == text) || ('\0' != *end)) return false;
+    usec = (int64_t)(secs*1.0e06 + ((secs < 0.0) ? -0.5 : 0.5));
+    return true;
+}  // end ParseTime()
+
+static void PrintRecord(const BinaryLogRecord& record)
+{
+    time_t secs = (time_t)(record.sys_usec / 1000000);
+    long usec = (long)(record.sys_usec % 1000000);
+    if (usec < 0)
+    {
+        secs--;
+        usec += 1000000;
+    }
+    struct tm theTime;
+    gmtime_r(&secs, &theTime);
+    fprintf(stdout, "date>%04d-%02d-%02d time>%02d:%02d:%02d.%06ld position>%f,%f,%f",
+                    theTime.tm_year + 1900, theTime.tm_mon + 1, theTime.tm_mday,
+                    theTime.tm_hour, theTime.tm_min, theTime.tm_sec, usec,
+                    record.lat, record.lon, record.alt);
+    if (0 != record.device)
+        fprintf(stdout, " device>%u", (unsigned int)(record.device - 1));
+    fprintf(stdout, "\n");
+}  // end PrintRecord()
+
+// Converts "time>HH:MM:SS.uuuuuu position>lat,lon,alt" lines, starting
+// on the given date.  Since the text log has no date, a time of day more
+// than 12 hours earlier than the previous entry is taken as a day rollover.
+// (Other lines, e.g. gpsLogger error output, are skipped)
+static bool Convert(const char* textPath, const char* binaryPath, const char* dateText)
+{
+    int64_t dayUsec;
+    if (!ParseTime(dateText, dayUsec))
+    {
+        fprintf(stderr, "gpsLogTool: invalid <yyyy-mm-dd> date \"%s\"\n", dateText);
+        return false;
+    }
+    dayUsec -= dayUsec % ((int64_t)86400*1000000);
+    FILE* inFile = fopen(textPath, "r");
+    if (!inFile)
+    {
+        perror("gpsLogTool: Error opening <textLog>");
+        return false;
+    }
+    FILE* outFile = fopen(binaryPath, "w+");
+    if (!outFile)
+    {
+        perror("gpsLogTool: Error opening <binaryLog>");
+        fclose(inFile);
+        return false;
+    }
+    BinaryLogWriter writer;
+    if (!writer.Open(outFile))
+    {
+        fclose(inFile);
+        fclose(outFile);
+        return false;
+    }
+    const int64_t USEC_PER_DAY = (int64_t)86400*1000000;
+    int64_t lastTimeOfDay = -1;
+    unsigned long converted = 0;
+    unsigned long skipped = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), inFile))
+    {
+        unsigned int hour, minute, second;
+        unsigned long usec;
+        double lat, lon, alt;
+        unsigned int device;
+        int fields = sscanf(line, "time>%u:%u:%u.%lu position>%lf,%lf,%lf device>%u",
+                            &hour, &minute, &second, &usec, &lat, &lon, &alt, &device);
+        if (fields < 7)
+        {
+            skipped++;
+            continue;
+        }
+        int64_t timeOfDay = ((int64_t)hour*3600 + minute*60 + second)*1000000 + usec;
+        if ((lastTimeOfDay >= 0) && ((lastTimeOfDay - timeOfDay) > (USEC_PER_DAY/2)))
+            dayUsec += USEC_PER_DAY;
+        lastTimeOfDay = timeOfDay;
+        BinaryLogRecord record;
+        memset(&record, 0, sizeof(record));
+        record.sys_usec = dayUsec + timeOfDay;
+        record.lat = lat;
+        record.lon = lon;
+        record.alt = alt;
+        record.flags = BINARY_LOG_XYVALID | BINARY_LOG_ZVALID;
+        if (8 == fields) record.device = device + 1;
+        if (!writer.Write(record)) break;
+        converted++;
+    }
+    bool result = writer.Close();
+    fclose(inFile);
+    if (fclose(outFile)) result = false;
+    fprintf(stderr, "gpsLogTool: converted %lu entries (%lu other lines skipped)\n",
+                    converted, skipped);
+    return result;
+}  // end Convert()
+
+static bool Query(const char* binaryPath, const char* startText, const char* endText)
+{
+    int64_t startUsec = INT64_MIN;
+    int64_t endUsec = INT64_MAX;
+    if ((startText && !ParseTime(startText, startUsec)) ||
+        (endText && !ParseTime(endText, endUsec)))
+    {
+        fprintf(stderr, "gpsLogTool: invalid time argument\n");
+        return false;
+    }
+    BinaryLogReader reader;
+    if (!reader.Open(binaryPath)) return false;
+    if (!reader.Seek(startUsec)) return false;
+    BinaryLogRecord record;
+    while (reader.Read(record) && (record.sys_usec <= endUsec))
+        PrintRecord(record);
+    return true;
+}  // end Query()
+
+static bool Info(const char* binaryPath)
+{
+    BinaryLogReader reader;
+    if (!reader.Open(binaryPath)) return false;
+    fprintf(stdout, "records>%llu index>%s\n",
+                    (unsigned long long)reader.GetRecordCount(),
+                    reader.IndexWasRebuilt() ? "rebuilt (log was not closed)" : "ok");
+    BinaryLogRecord record;
+    if (reader.Read(record))
+    {
+        fprintf(stdout, "first> ");
+        PrintRecord(record);
+        reader.SeekRecord(reader.GetRecordCount() - 1);
+        reader.Read(record);
+        fprintf(stdout, "last>  ");
+        PrintRecord(record);
+    }
+    return true;
+}  // end Info()
+
+int main(int argc, char* argv[])
+{
+    bool result = false;
+    if ((argc == 5) && !strcmp("convert", argv[1]))
+    {
+        result = Convert(argv[2], argv[3], argv[4]);
+    }
+    else if ((argc >= 3) && (argc <= 5) && !strcmp("query", argv[1]))
+    {
+        result = Query(argv[2], (argc > 3) ? argv[3] : NULL, (argc > 4) ? argv[4] : NULL);
+    }
+    else if ((argc == 3) && !strcmp("info", argv[1]))
+    {
+        result = Info(argv[2]);
+    }
+    else
+    {
+        Usage();
+    }
+    return result ? 0 : -1;
+}  // end main()
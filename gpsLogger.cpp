@@ -1,10 +1,22 @@
 
 #include "gpsPub.h"
 #include "nmeaParse.h"
+#include "nmeaStream.h"
+#include "serialInput.h"
+#include "logWriter.h"
+#include "clockDiscipline.h"
+#include "ppsCapture.h"
+#include "gpsReceiver.h"
+#include "epochAssembler.h"
+#include "eventSource.h"
+#include "gpsStats.h"
+#include "gpsPipeline.h"
+#include "realTime.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 #include <termios.h>
 #include <unistd.h>
 #include <sys/types.h>
@@ -15,14 +27,10 @@
 #include <time.h>
 #include <signal.h>
 #include <errno.h>
-#include <sched.h>  // for process priority boost
+#include <poll.h>
 
 #define VERSION "1.8"
 
-#ifdef LINUX
-#include <linux/serial.h>  // for Linux low latency option
-#endif // LINUX
-
 bool GPSGetTimeAndPosition(char* lineBuffer, struct timeval* currentTime,
                            double* xPos, double* yPos, double* zPos);
 
@@ -31,21 +39,68 @@ class GPSLogger
     public:
         GPSLogger();
         bool Main(int argc, char* argv[]);
-        void SetStale();
         void Cleanup();
-        void Stop();
+        
+        enum {MAX_DEVICES = 256};
         
     private:
+        bool AddDevice(const char* name, bool isSerial);
+        bool MainMulti(const char* pubFile, unsigned int baud, bool requireChecksum,
+                       bool logging);
+        int ReopenInput(const char* device, int flags, bool isSerialDevice,
+                        unsigned int baud, const struct termios* attr);
+        
         bool        running;
+        bool        debug;
         FILE*       log_ptr;
+        LogWriter   log_writer;
+        PPSCapture  pps_capture;
+        ModemLinePPS pps_line;    // (PPS sources)
+        KernelPPS   pps_kernel;
+        FakePPS     pps_fake;
         int         input_fd;
+        const char* pub_file;
         GPSHandle   gps_handle;
-        GPSPosition p;
+        GPSStats*   gps_stats;    // (hot path statistics, see "gpsStats.h")
+        ParserStage     parser_stage;     // (single device loop stages)
+        PublisherStage  publisher_stage;
+        // (multiple device mode)
+        const char*     device_names[MAX_DEVICES];
+        bool            device_is_serial[MAX_DEVICES];
+        unsigned int    device_count;
+        GPSReceiver*    receivers;
+        ReceiverLoop    receiver_loop;
+        SignalEvent     signal_event;   // (shutdown)
+        TickTimer       tick_timer;
             
-        static void SignalHandler(int sigNum);
         static void Usage();
 };  // end class GPSLogger
 
+// Parses "text", a comma separated list of up to "count" CPU numbers (an
+// empty entry is -1, i.e. none), into "cpus"
+static bool ParseCpuList(const char* text, int* cpus, unsigned int count)
+{
+    for (unsigned int i = 0; i < count; i++) cpus[i] = -1;
+    unsigned int i = 0;
+    while ('\0' != *text)
+    {
+        if (i >= count) return false;
+        if (',' != *text)
+        {
+            char* end;
+            long cpu = strtol(text, &end, 10);
+            if ((end == text) || (cpu < 0) || (cpu > 1023) ||
+                ((',' != *end) && ('\0' != *end)))
+                return false;
+            cpus[i] = (int)cpu;
+            text = end;
+        }
+        i++;
+        if (',' == *text) text++;
+    }
+    return true;
+}  // end ParseCpuList()
+
 GPSLogger theApp;
 int main(int argc, char* argv[])
 {
@@ -63,7 +118,8 @@ int main(int argc, char* argv[])
 
 
 GPSLogger::GPSLogger()
-    : running(false), log_ptr(NULL), input_fd(-1), gps_handle(NULL)
+    : running(false), debug(false), log_ptr(NULL), input_fd(-1), pub_file(NULL), gps_handle(NULL),
+      gps_stats(NULL), device_count(0), receivers(NULL)
 {
 }
 
@@ -79,14 +135,27 @@ bool GPSLogger::Main(int argc, char* argv[])
     bool nmeaParse = true;  // NMEA parse by default
     bool use_pps = false;
     bool configureGPS35 = false;
-    bool debug = false;
     bool requireChecksum = false;
-    bool largeTimeChangeFlag = false;
-    unsigned long largeTimeChangeDelta = 0;
     bool forceClock = false;  // if true, force clock using settimeofday()
                               // instead of adjtime() on first sync
     int ppsSignal = TIOCM_CD;
+    const char* ppsDevice = NULL;  // RFC 2783 PPS device (kernel timestamps)
+    bool ppsFake = false;
     bool doInvert = false;
+    unsigned int logQueueSize = 256;
+    LogWriter::Policy logPolicy = LogWriter::DROP;
+    LogWriter::Format logFormat = LogWriter::TEXT;
+    bool clockLoop = true;  // frequency discipline with "set pps"
+    double clockTimeConstant = ClockDiscipline::DEFAULT_TIME_CONSTANT;
+    bool pipeline = false;  // (stages each on a thread of their own)
+    int pipelineCpus[4] = {-1, -1, -1, -1};  // (reader, parser, publisher and logger)
+    int priority = RealTime::PRIORITY_MAX;  // (SCHED_FIFO, see "realTime.h")
+    bool priorityGiven = false;
+    int cpus[64];  // (process CPU affinity)
+    unsigned int cpuCount = 0;
+    bool memLock = false;
+    unsigned int stackKbytes = 256;  // (of stack prefaulted with "memLock")
+    double jitterSeconds = 0.0;  // (jitter self-test only)
     
     // 1) Parse command-line options
     char** ptr = argv + 1;
@@ -103,6 +172,41 @@ bool GPSLogger::Main(int argc, char* argv[])
             ptr++;
             use_pps = true;
         }
+        else if (!strcmp("ppsDevice", *ptr))
+        {
+            ptr++;
+            if (!(ppsDevice = *ptr))
+            {
+                fprintf(stderr, "gpsLogger: No <ppsDevice> argument given!\n");
+                Usage();
+                return false;
+            }
+            ptr++;
+            use_pps = true;
+        }
+        else if (!strcmp("ppsFake", *ptr))
+        {
+            ptr++;
+            ppsFake = true;
+            use_pps = true;
+        }
+        else if (!strcmp("adjtime", *ptr))
+        {
+            ptr++;
+            clockLoop = false;
+        }
+        else if (!strcmp("clockTC", *ptr))
+        {
+            ptr++;
+            if (!*ptr || (1 != sscanf(*ptr, "%lf", &clockTimeConstant)) ||
+                (clockTimeConstant < 1.0))
+            {
+                fprintf(stderr, "gpsLogger: No (or invalid) <seconds> argument given!\n");
+                Usage();
+                return false;
+            }
+            ptr++;
+        }
         else if (!strncmp("gps35", *ptr, len))
         {
             ptr++;
@@ -148,6 +252,58 @@ bool GPSLogger::Main(int argc, char* argv[])
             ptr++;
             doInvert = true;
         }
+        else if (!strcmp("logQueue", *ptr))
+        {
+            ptr++;
+            if (*ptr && (atoi(*ptr) > 0))
+            {
+                logQueueSize = atoi(*ptr++);
+            }
+            else
+            {
+                fprintf(stderr, "gpsLogger: No (or invalid) <queueSize> argument given!\n");
+                Usage();
+                return false;   
+            }
+        }
+        else if (!strcmp("logPolicy", *ptr))
+        {
+            ptr++;
+            if (*ptr && !strcmp("drop", *ptr))
+            {
+                logPolicy = LogWriter::DROP;
+            }
+            else if (*ptr && !strcmp("block", *ptr))
+            {
+                logPolicy = LogWriter::BLOCK;
+            }
+            else
+            {
+                fprintf(stderr, "gpsLogger: No (or invalid) <policy> argument given!\n");
+                Usage();
+                return false;   
+            }
+            ptr++;
+        }
+        else if (!strcmp("logFormat", *ptr))
+        {
+            ptr++;
+            if (*ptr && !strcmp("text", *ptr))
+            {
+                logFormat = LogWriter::TEXT;
+            }
+            else if (*ptr && !strcmp("binary", *ptr))
+            {
+                logFormat = LogWriter::BINARY;
+            }
+            else
+            {
+                fprintf(stderr, "gpsLogger: No (or invalid) <format> argument given!\n");
+                Usage();
+                return false;   
+            }
+            ptr++;
+        }
         else if (!strncmp("log", *ptr, len))
         {
             ptr++;
@@ -169,6 +325,7 @@ bool GPSLogger::Main(int argc, char* argv[])
             {
                 inputDevice = *ptr++;  
                 isSerialDevice = false; // "input" is non-serial device
+                if (!AddDevice(inputDevice, isSerialDevice)) return false;
             }
             else
             {
@@ -184,6 +341,7 @@ bool GPSLogger::Main(int argc, char* argv[])
             {
                 inputDevice = *ptr++;
                 isSerialDevice = true;
+                if (!AddDevice(inputDevice, isSerialDevice)) return false;
             }
             else
             {
@@ -206,6 +364,85 @@ bool GPSLogger::Main(int argc, char* argv[])
                 return false;   
             }
         }
+        else if (!strcmp("pipeline", *ptr))
+        {
+            ptr++;
+            pipeline = true;
+            // (optionally followed by the stages' CPUs, e.g. "2,3,3" or ",,,0")
+            if (*ptr && (isdigit(**ptr) || (',' == **ptr)))
+            {
+                if (!ParseCpuList(*ptr, pipelineCpus, 4))
+                {
+                    fprintf(stderr, "gpsLogger: Invalid <cpuList> argument given!\n");
+                    Usage();
+                    return false;
+                }
+                ptr++;
+            }
+        }
+        else if (!strcmp("priority", *ptr))
+        {
+            ptr++;
+            if (*ptr && !strcmp("none", *ptr))
+            {
+                priority = RealTime::PRIORITY_NONE;
+            }
+            else if (!*ptr || (1 != sscanf(*ptr, "%d", &priority)) || (priority < 0))
+            {
+                fprintf(stderr, "gpsLogger: No (or invalid) <priority> argument given!\n");
+                Usage();
+                return false;
+            }
+            ptr++;
+            priorityGiven = true;
+        }
+        else if (!strcmp("cpus", *ptr))
+        {
+            ptr++;
+            if (!*ptr || !ParseCpuList(*ptr, cpus, 64))
+            {
+                fprintf(stderr, "gpsLogger: No (or invalid) <cpuList> argument given!\n");
+                Usage();
+                return false;
+            }
+            ptr++;
+            cpuCount = 64;
+        }
+        else if (!strcmp("memLock", *ptr))
+        {
+            ptr++;
+            memLock = true;
+            if (*ptr && isdigit(**ptr))
+            {
+                if ((1 != sscanf(*ptr, "%u", &stackKbytes)) || (stackKbytes > 65536))
+                {
+                    fprintf(stderr, "gpsLogger: Invalid <stackKbytes> argument given!\n");
+                    Usage();
+                    return false;
+                }
+                ptr++;
+            }
+        }
+        else if (!strcmp("jitterTest", *ptr))
+        {
+            ptr++;
+            jitterSeconds = 10.0;
+            if (*ptr && isdigit(**ptr))
+            {
+                if ((1 != sscanf(*ptr, "%lf", &jitterSeconds)) || (jitterSeconds <= 0.0))
+                {
+                    fprintf(stderr, "gpsLogger: Invalid <seconds> argument given!\n");
+                    Usage();
+                    return false;
+                }
+                ptr++;
+            }
+        }
+        else if (!strcmp("pubLock", *ptr))
+        {
+            ptr++;
+            GPSSetPublishOptions(GPS_PUBLISH_PREFAULT | GPS_PUBLISH_MLOCK);
+        }
         else if (!strncmp("pub", *ptr, len))
         {
             ptr++;
@@ -228,21 +465,52 @@ bool GPSLogger::Main(int argc, char* argv[])
         }
     }  // end while(*ptr)
     
-#ifdef LINUX
-    // Boost process priority for real-time operation
-    // (This _may_ work on Linux-only at this point)
-    struct sched_param schp;
-    memset(&schp, 0, sizeof(schp));
-    schp.sched_priority =  sched_get_priority_max(SCHED_FIFO);
-    if (sched_setscheduler(0, SCHED_FIFO, &schp))
+    // With more than one device, a single epoll() loop serves them all,
+    // each publishing to its own slot (device "k" to slot "k")
+    bool multiDevice = (device_count > 1);
+    if (multiDevice && (setTime || use_pps || configureGPS35 || !nmeaParse || pipeline))
     {
-        schp.sched_priority =  sched_get_priority_max(SCHED_OTHER);
-        if (sched_setscheduler(0, SCHED_OTHER, &schp))
-        {
-            perror("gpsLogger: Warning! Couldn't set any real-time priority");
-        }   
+        fprintf(stderr, "gpsLogger: setTime, pps, gps35, bin and pipeline options require a single device!\n");
+        Usage();
+        return false;
+    }
+    
+    // Real-time tuning, before any threads are started (which inherit it).
+    // Tuning asked for explicitly must succeed, while the default (highest)
+    // priority falls back to normal scheduling (which the statistics
+    // segment then shows, see "gpsStatsTool").
+    if (cpuCount && !RealTime::SetAffinity(cpus, cpuCount)) return false;
+    bool tuned = RealTime::SetPriority(priority);
+    if (!tuned && priorityGiven) return false;
+    if (memLock && !RealTime::LockMemory(1024 * stackKbytes)) return false;
+    if (debug || !tuned || (jitterSeconds > 0.0))
+        RealTime::Report(stderr, "gpsLogger: ");
+    
+    // The jitter self-test measures how late the (reader's) loop wakes up as
+    // tuned, instead of logging
+    if (jitterSeconds > 0.0)
+    {
+        if ((pipelineCpus[0] >= 0) && !PipelineStage::PinThread(pthread_self(), pipelineCpus[0]))
+            return false;
+        fprintf(stderr, "gpsLogger: jitter test for %.1f seconds ...\n", jitterSeconds);
+        JitterTest jitterTest;
+        jitterTest.Run(jitterSeconds);
+        jitterTest.Report(stdout, "gpsLogger: jitter ");
+        return true;
     }
-#endif // LINUX
+    
+    // Shutdown signals are received by the main loop (see SignalEvent),
+    // which is done before any threads are started (so they inherit the
+    // signal mask)
+    if (!signal_event.Open()) return false;
+    
+    // Latency histograms and error counters are published (see "gpsStatsTool")
+    // in a segment of their own
+    pub_file = pubFile;  // (for Cleanup())
+    if (!(gps_stats = GPSStatsPublish(pubFile)))
+        fprintf(stderr, "gpsLogger: Warning! Statistics can't be published\n");
+    else
+        gps_stats->priority = RealTime::GetPriority();
     
     // 2) Open log file (if applicable)
     if (logging)
@@ -259,8 +527,20 @@ bool GPSLogger::Main(int argc, char* argv[])
         {
             log_ptr = stdout;
         }    
+        // Log entries are written by a separate thread
+        log_writer.SetDeviceTags(multiDevice);
+        log_writer.SetStats(gps_stats);
+        log_writer.SetCpu(pipelineCpus[3]);
+        if (!log_writer.Open(log_ptr, logQueueSize, logPolicy, logFormat))
+        {
+            fprintf(stderr, "gpsLogger: Error starting log writer!\n");
+            Cleanup();
+            return false;
+        }
     }    
     
+    if (multiDevice) return MainMulti(pubFile, baud, requireChecksum, logging);
+    
     // 3) Init GPS shared memory publishing
     if (!(gps_handle = GPSPublishInit(pubFile)))
     {
@@ -282,83 +562,19 @@ bool GPSLogger::Main(int argc, char* argv[])
         Cleanup();
         return false;   
     }
-    if (isSerialDevice)
-        {
-        // Set up serial port attributes
-        struct termios attr;
-        if (tcgetattr(input_fd, &attr) < 0)
-        {
-            perror("gpsLogger: Error getting serial port settings!");
-            close(input_fd);
-            Cleanup();
-            return false;   
-        }
-        attr.c_cflag &= ~PARENB;  // no parity
-        attr.c_cflag &= ~CSIZE;   // 8-bit bytes (first, clear mask, 
-        attr.c_cflag |= CS8;      //              then, set value)
-        cfmakeraw(&attr);
-        attr.c_cflag |= CLOCAL;
-
-        speed_t speed;
-        switch(baud)
-        {
-            case 4800:
-                speed = B4800;
-                break;
-            case 9600:
-                speed = B9600;
-                break;
-
-            default:
-                fprintf(stderr, "gpsLogger: Invalid <baudRate> setting!\n");
-                Cleanup();
-                return false;
-        }
-
-        if (cfsetispeed(&attr, speed))
-        {
-            perror("gpsLogger: cfsetispeed() error");
-            close(input_fd);
-            Cleanup();
-            return false;   
-        }
-        if (cfsetospeed(&attr, speed))
-        {
-            perror("gpsLogger: cfsetospeed() error");
-            close(input_fd);
-            Cleanup();
-            return false;   
-        }
-
-        attr.c_cc[VTIME]    = 100; // (100 * 0.1 sec) 10 second timeout
-        attr.c_cc[VMIN]     = 0;   // 1 char satisfies read
-
-        if (tcsetattr(input_fd, TCSANOW, &attr) < 0)
-        {
-            perror("gpsLogger: Error setting serial port settings");
-            close(input_fd); 
-            Cleanup();
-            return false;   
-        }
-
-#ifdef ASYNC_LOW_LATENCY  // (LINUX only?)  
-        // Try to set low latency
-        struct serial_struct serinfo;
-        if (ioctl(input_fd, TIOCGSERIAL, &serinfo) < 0)
-        {
-		    perror("gpsLogger: Cannot get serial info");
-            fprintf(stderr, "gpsLogger: Warning - low latency operation not supported on serial device\n");
-        }
-        else
-        {
-            serinfo.flags |= ASYNC_LOW_LATENCY;
-            if (ioctl(input_fd, TIOCSSERIAL, &serinfo) < 0) 
-            {
-		        perror("gpsLogger: Warning: cannot set low latency option");
-	        }
-        }
-#endif // ASYNC_LOW_LATENCY
-    }  // end if (isSerialDevice)
+    // Set up serial port attributes
+    if (isSerialDevice && !SerialInput::Configure(input_fd, baud))
+    {
+        close(input_fd);
+        Cleanup();
+        return false;
+    }
+    // A device (i.e. not a regular file) that is lost (e.g. unplugged) is
+    // reopened with these serial port settings (see ReopenInput())
+    struct stat inputInfo;
+    bool reconnectable = (0 == fstat(input_fd, &inputInfo)) && !S_ISREG(inputInfo.st_mode);
+    struct termios inputAttr;
+    bool haveInputAttr = isSerialDevice && (0 == tcgetattr(input_fd, &inputAttr));
     
     if (configureGPS35)
     {
@@ -450,523 +666,453 @@ bool GPSLogger::Main(int argc, char* argv[])
         }
     }
     
-    signal(SIGINT, SignalHandler);
-    signal(SIGTERM, SignalHandler);
-    signal(SIGALRM, SignalHandler); 
+    if (!tick_timer.Open(GPS_HEARTBEAT_INTERVAL))
+    {
+        close(input_fd);
+        Cleanup();
+        return false;
+    }
+    
+    // The input is parsed, and the clock set and fixes published, by the
+    // parser and publisher stages (see "gpsPipeline.h"), in this (the
+    // reader's) thread or, with "pipeline", each on a thread of its own
+    publisher_stage.SetDebug(debug);
+    publisher_stage.SetStats(gps_stats);
+    publisher_stage.SetClock(setTime, use_pps, forceClock, clockLoop, clockTimeConstant);
+    parser_stage.SetDebug(debug);
+    parser_stage.SetStats(gps_stats);
+    parser_stage.SetRequireChecksum(requireChecksum);
+    parser_stage.SetEpochTimeout(EpochAssembler::DefaultTimeout(isSerialDevice ? baud : 0));
+    if (!publisher_stage.Open(gps_handle, logging ? &log_writer : NULL) ||
+        !parser_stage.Open(&publisher_stage, nmeaParse))
+    {
+        close(input_fd);
+        Cleanup();
+        return false;
+    }
+    // Serial input is read in chunks and buffered
+    SerialInput serialInput;
+    serialInput.SetDescriptor(input_fd);
+    serialInput.SetBaud(isSerialDevice ? baud : 0);
     
-    memset(&p, 0, sizeof(GPSPosition));
-    p.stale = true;
-    GPSPublishUpdate(gps_handle, &p);
     // Flush input to make sure we're getting a fresh sentence
     if (isSerialDevice) tcflush(input_fd, TCIFLUSH);
     running = true;
     
-    enum LineStatus {LOW, HI};
-    
-    while (running)
+    // PPS edges are captured (and timestamped) by a separate thread
+    // and paired with sentences by the parser
+    // (from the serial port modem line, a kernel PPS device or fake)
+    bool ppsCapture = use_pps && (isSerialDevice || ppsDevice || ppsFake);
+    bool ppsModemLine = ppsCapture && !ppsDevice && !ppsFake;  // (restarted upon reconnect)
+    if (ppsCapture)
     {
-        LineStatus dcdCurrent;
-        struct timeval pulseTime;
-        struct timezone tz;
-#ifdef LINUX
-        if (use_pps  && isSerialDevice)
-        {
-            tcflush(input_fd, TCIFLUSH);
-            struct itimerval timer;
-            timer.it_interval.tv_sec = 10;
-            timer.it_interval.tv_usec = 0;
-            timer.it_value.tv_sec = 10;
-            timer.it_value.tv_usec = 0;
-            if (setitimer(ITIMER_REAL, &timer, 0))
-            {
-                perror("gpsLogger: setitimer() error");      
-            }
-            // Wait for pulse (change low->hi in DCD)
-            if (ioctl(input_fd, TIOCMIWAIT, ppsSignal) < 0)
-            {
-                perror("gpsLogger: ioctl(TIOCMIWAIT) error");
-                continue; 
-            }
-            gettimeofday(&pulseTime, &tz);
-            // Cancel itimer
-            timer.it_interval.tv_sec = 0;
-            timer.it_interval.tv_usec = 0;
-            timer.it_value.tv_sec = 0;
-            timer.it_value.tv_usec = 0;
-            if (setitimer(ITIMER_REAL, &timer, 0))
-            {
-                perror("gpsLogger: setitimer() error");      
-            }
-            // Make sure we caught a low->hi transition
-            int status;
-            if (ioctl(input_fd, TIOCMGET, &status) < 0)
-            {
-                perror("gpsLogger: ioctl(TIOCMGET) error");
-                continue;   
-            }
-            dcdCurrent = (0 != (status & ppsSignal)) ? HI : LOW;
-            if (doInvert) dcdCurrent = (HI == dcdCurrent) ? LOW : HI;
-            if (LOW == dcdCurrent) continue;
-            // Flush input to make sure we're getting a 
-            // fresh sentence after the pulse
-            tcflush(input_fd, TCIFLUSH);
-            if (debug) fprintf(stderr, "gpsLogger: caught PPS\n");
+        PPSSource* ppsSource = &pps_line;
+        if (ppsFake)
+        {
+            ppsSource = &pps_fake;
+        }
+        else if (ppsDevice)
+        {
+            if (!pps_kernel.Open(ppsDevice, doInvert))
+            {
+                fprintf(stderr, "gpsLogger: Error opening <ppsDevice>!\n");
+                Cleanup();
+                return false;
+            }
+            ppsSource = &pps_kernel;
         }
         else
-#endif // LINUX
         {
-            dcdCurrent = HI;
+            pps_line.Init(input_fd, ppsSignal, doInvert);
         }
-
-        // OK, DCD just went high, try to read a sentence while
-        // before it goes low and high again.
-        bool dcdGood = true;
-        LineStatus dcdPrevious = dcdCurrent;
-        // Do only one settimeofday() or adjtime() per pulse
-        bool setTimePending = setTime;
-        // Variables used for NMEA sentence seeking/reading
-        enum NmeaState 
-        {
-            SEEKING_SENTENCE, 
-            READING_SENTENCE,
-            READING_CHECKSUM,
-            SENTENCE_COMPLETE
-        };
-        const unsigned int MAX_SENTENCE_LENGTH = 80;    
-        char sentenceBuffer[256];
-        unsigned int sentenceLength = 0;
-        char checksumBuffer[8];
-        unsigned int checksumLength = 0;
-        struct timeval sentenceStartTime;
-        NmeaState state = SEEKING_SENTENCE;
-        
-        unsigned int sentenceCount = 0;
-        
-        while (dcdGood)
-        {
-            char character;
-            int result = read(input_fd, &character, 1);
-            struct timeval currentTime;
-            gettimeofday(&currentTime, &tz);
-            switch (result)
-            {
-                case -1:  // error
-                    if (EINTR != errno)
-                    {
-                        perror("gpsLogger: Serial port read error");
-                        Cleanup();
-                        return false;   
-                    }
-                    dcdGood = false;  // reset seek for PPS
-                    largeTimeChangeFlag = false;  // reset large time change criteria
-                    continue;
-                    
-                case 0:   // eof
-                {
-                    struct timeval currentTime;
-                    struct timezone tz;
-                    gettimeofday(&currentTime, &tz);
-                    struct tm* theTime = gmtime((time_t*)&currentTime.tv_sec);
-                    fprintf(stderr, "gpsLogger: Serial port read timed out! (time>%02d:%02d:%02d.%06lu)\n",
-			                                     theTime->tm_hour, 
-			                                     theTime->tm_min,
-			                                     theTime->tm_sec,
-			                                     (unsigned long)currentTime.tv_usec);
-                    SetStale();
-                    dcdGood = false;  // reset seek for PPS
-                    largeTimeChangeFlag = false;  // reset large time change criteria
-                    break;
-                }
-                    
-                default:
-                    break;
+        if (!pps_capture.Start(ppsSource))
+        {
+            fprintf(stderr, "gpsLogger: Error starting PPS capture!\n");
+            Cleanup();
+            return false;
+        }
+        if (debug) fprintf(stderr, "gpsLogger: PPS source>%s\n", ppsSource->GetName());
+    }
+    parser_stage.SetTime(setTime, ppsCapture ? &pps_capture : NULL,
+                         ppsModemLine ? &pps_line : NULL, ppsSignal, doInvert);
+    
+    if (pipeline)
+    {
+        if (!publisher_stage.StartThread("gpsPublisher", pipelineCpus[2]) ||
+            !parser_stage.StartThread("gpsParser", pipelineCpus[1]))
+        {
+            Cleanup();
+            return false;
+        }
+        if (pipelineCpus[0] >= 0) PipelineStage::PinThread(pthread_self(), pipelineCpus[0]);
+    }
+    
+    struct timeval inputTime;  // (of the latest input wait that ended with input)
+    gettimeofday(&inputTime, NULL);
+    InputEvent event;
+    while (running)
+    {
+        // Input is waited for (when none is buffered) together with
+        // shutdown signals and the tick timer, and while an epoch is
+        // being assembled (by the parser in this thread), only until it
+        // times out (and then its fix is published).  Each tick (every
+        // GPS_HEARTBEAT_INTERVAL msec) beats the publication's heartbeat,
+        // fix or not (see GPSSubscriptionIsValid()), has the publisher
+        // mark a fix over 30 seconds old stale, and makes no input for the
+        // serial read timeout a read timeout, as before.
+        int result = 1;
+        bool inputReady = false;  // (poll() said so, i.e. 0 is a hang up)
+        if (serialInput.IsEmpty())
+        {
+            int timeout = parser_stage.GetWaitTimeout();
+            int tickTimeout = tick_timer.GetTimeout();
+            if ((tickTimeout >= 0) && ((timeout < 0) || (tickTimeout < timeout)))
+                timeout = tickTimeout;
+            struct pollfd pfd[3];
+            pfd[0].fd = input_fd;
+            pfd[1].fd = signal_event.GetDescriptor();
+            pfd[2].fd = tick_timer.GetDescriptor();  // (-1 is ignored)
+            for (int i = 0; i < 3; i++)
+            {
+                pfd[i].events = POLLIN;
+                pfd[i].revents = 0;
             }
-            
-            if (use_pps && isSerialDevice)
+            result = (0 == timeout) ? 0 : poll(pfd, 3, timeout);
+            if (result < 0)
             {
-                // Check DCD to make sure we haven't missed a transition
-                // (we're polling DCD after each character read)
-                int status;
-                if (ioctl(input_fd, TIOCMGET, &status) < 0)
-                {
-                    perror("gpsLogger: ioctl(TIOCMGET) error");
-                    dcdGood = false;  // reset seek for PPS
-                    largeTimeChangeFlag = false;  // reset large time change criteria
-
-                }
-                else
+                if (EINTR == errno) continue;
+                perror("gpsLogger: poll() error");
+                Cleanup();
+                return false;
+            }
+            if (0 != pfd[1].revents)
+            {
+                signal_event.Read();
+                running = false;  // (shut down)
+                break;
+            }
+            bool readTimedOut = false;
+            if (((pfd[2].fd < 0) || (0 != pfd[2].revents)) && (tick_timer.Read() > 0))
+            {
+                GPSPublishHeartbeat(gps_handle);
+                event.type = InputEvent::TICK;
+                parser_stage.Put(event);
+                struct timeval currentTime;
+                gettimeofday(&currentTime, NULL);
+                readTimedOut = ((currentTime.tv_sec - inputTime.tv_sec) >= SerialInput::READ_TIMEOUT);
+            }
+            if (0 != pfd[0].revents)
+            {
+                gettimeofday(&inputTime, NULL);
+                inputReady = true;
+                result = 1;
+            }
+            else
+            {
+                parser_stage.Poll();  // (publishes a timed out epoch)
+                if (!readTimedOut) continue;  // (wait again)
+                result = 0;
+            }
+        }
+        if (result > 0)
+        {
+            // The input buffered (with each byte's estimated arrival time)
+            // is handed to the parser
+            event.type = InputEvent::INPUT;
+            event.count = 0;
+            do
+            {
+                result = serialInput.GetByte(event.data[event.count], event.arrival[event.count]);
+                if (result <= 0) break;
+                event.count++;
+            } while (!serialInput.IsEmpty() && (event.count < InputEvent::MAX_BYTES));
+            if (event.count > 0) parser_stage.Put(event);
+        }
+        if (reconnectable && (((result < 0) && (EINTR != errno)) || ((0 == result) && inputReady)))
+        {
+            // The device was lost (e.g. unplugged):  the publication
+            // stays (stale, with its heartbeat) while it is reopened
+            fprintf(stderr, "gpsLogger: Lost input device (%s), reconnecting ...\n",
+                            (result < 0) ? strerror(errno) : "hang up");
+            GPSStatsCount(gps_stats, GPS_STATS_READ_ERRORS);
+            parser_stage.PutLost(input_fd);  // (closed by the parser)
+            input_fd = ReopenInput(inputDevice, flags, isSerialDevice, baud, 
+                                   haveInputAttr ? &inputAttr : NULL);
+            if (input_fd < 0) break;  // (stopped)
+            GPSStatsCount(gps_stats, GPS_STATS_RECONNECTS);
+            serialInput.SetDescriptor(input_fd);
+            serialInput.Flush();
+            event.type = InputEvent::RECONNECTED;
+            event.descriptor = input_fd;
+            parser_stage.Put(event);
+            gettimeofday(&inputTime, NULL);
+            continue;
+        }
+        switch (result)
+        {
+            case -1:  // error
+                if (EINTR != errno)
                 {
-                    dcdCurrent = (status & ppsSignal) ? HI : LOW;
-                    bool pulseRedect;
-                    if (doInvert) dcdCurrent = (HI == dcdCurrent) ? LOW : HI;
-                    if ((LOW == dcdPrevious) && (HI == dcdCurrent))
-                    {
-                        if (setTimePending)
-                            fprintf(stderr, "gpsLogger: Didn't read sentence in time!\n");
-                        dcdGood = false;  // reset seek for PPS
-                        largeTimeChangeFlag = false;  // reset large time change criteria
-                        
-                    }
-                    else
-                    {
-                        dcdPrevious = dcdCurrent;
-                    }
+                    perror("gpsLogger: Serial port read error");
+                    Cleanup();
+                    return false;   
                 }
-            }  // end if (use_pps)
-            
-            // Check published position for "freshness"
-            if (!p.stale)
+                event.type = InputEvent::RESTART;  // reset seek for PPS
+                parser_stage.Put(event);
+                break;
+                
+            case 0:   // eof
             {
-                int deltaTime = currentTime.tv_sec - p.sys_time.tv_sec;
-                if (deltaTime > 30) 
-                {
-                    p.stale = true; 
-                    GPSPublishUpdate(gps_handle, &p); 
-                } 
+                struct timeval currentTime;
+                struct timezone tz;
+                gettimeofday(&currentTime, &tz);
+                inputTime = currentTime;
+                struct tm* theTime = gmtime((time_t*)&currentTime.tv_sec);
+                fprintf(stderr, "gpsLogger: Serial port read timed out! (time>%02d:%02d:%02d.%06lu)\n",
+		                                 theTime->tm_hour, 
+		                                 theTime->tm_min,
+		                                 theTime->tm_sec,
+		                                 (unsigned long)currentTime.tv_usec);
+                GPSStatsCount(gps_stats, GPS_STATS_READ_TIMEOUTS);
+                event.type = InputEvent::STALE;
+                parser_stage.Put(event);
+                event.type = InputEvent::RESTART;  // reset seek for PPS
+                parser_stage.Put(event);
+                break;
             }
-
-            if (dcdGood)
-            {
-                if (nmeaParse)
-                {   
-                    // '$' always triggers NMEA sentence start
-                    // regardless of current state
-                    if ('$' == character)
-                    {   
-                        if (SEEKING_SENTENCE != state)
-                        {
-                            fprintf(stderr, "gpsLogger: Warning! prematurely detected new sentence\n");
-                            dcdGood = false;  // reset seek for PPS
-                            largeTimeChangeFlag = false;  // reset large time change criteria
-                        }
-                        sentenceStartTime = currentTime;            
-                        state = READING_SENTENCE;
-                        sentenceLength = 0; 
-                    }
-                    else if (READING_SENTENCE == state)
-                    {
-                        if (('*' == character))
-                        {
-                            state = READING_CHECKSUM;
-                            checksumLength = 0;
-                        }
-                        else if (('\n' == character) ||
-                                 ('\r' == character))
-                        {
-                            if (requireChecksum)
-                            {
-                                // No checksum when it was required. Complain and throw sentence out.
-                                if (debug)
-                                {
-                                    sentenceBuffer[sentenceLength] = '\0';
-                                    fprintf(stderr, "%s\n", sentenceBuffer);
-                                }
-                                fprintf(stderr, "gpsLogger: Warning! missing expected NMEA checksum.\n");
-                                dcdGood = false;  // reset seek for PPS
-                                largeTimeChangeFlag = false;  // reset large time change criteria
-                                state = SEEKING_SENTENCE;
-                            }
-                            else
-                            {
-                                // Checksum may be optional?
-                                state = SENTENCE_COMPLETE;   
-                            }
-                        }
-                        else
-                        {
-                            sentenceBuffer[sentenceLength++] = character;
-                            if (sentenceLength > MAX_SENTENCE_LENGTH)
-                            {
-                                if (debug)
-                                {
-                                    sentenceBuffer[MAX_SENTENCE_LENGTH] = '\0';
-                                    fprintf(stderr, "%s\n", sentenceBuffer);
-                                }
-                                fprintf(stderr, "gpsLogger: Maximum NMEA sentence length exceeded?\n");
-                                dcdGood = false;  // reset seek for PPS
-                                largeTimeChangeFlag = false;  // reset large time change criteria
-                                state = SEEKING_SENTENCE;   
-                            }
-                        }                
-                    }
-                    else if (READING_CHECKSUM == state)
-                    {
-                        checksumBuffer[checksumLength++] = character;
-                        if ((checksumLength > 2) ||
-                            ('\n' == character) ||
-                            ('\r' == character))
-                        {
-                            // Try to read checksum and check sentence
-                            checksumBuffer[checksumLength] = '\0';
-                            int inputChecksum;
-                            if (1 == sscanf(checksumBuffer, "%x", &inputChecksum))
-                            {
-                                unsigned char calculatedChecksum = 0;
-                                for (unsigned int i = 0; i < sentenceLength; i++)
-                                    calculatedChecksum ^= (unsigned char)sentenceBuffer[i];
-                                if (inputChecksum != calculatedChecksum)
-                                {
-                                    if (debug)
-                                    {
-                                        sentenceBuffer[sentenceLength] = '\0';
-                                        fprintf(stderr, "%s*%s\n", sentenceBuffer, checksumBuffer);
-                                    }
-                                    fprintf(stderr, "gpsLogger: Bad NMEA checksum!\n");
-                                    dcdGood = false;  // reset seek for PPS
-                                    largeTimeChangeFlag = false;  // reset large time change criteria
-                                    state = SEEKING_SENTENCE;
-                                }
-                                else
-                                {
-                                    state = SENTENCE_COMPLETE;
-                                }
-                            }
-                            else
-                            {
-                                if (debug)
-                                {
-                                    sentenceBuffer[sentenceLength] = '\0';
-                                    fprintf(stderr, "%s*%s\n", sentenceBuffer, checksumBuffer);
-                                }
-                                fprintf(stderr, "gpsLogger: Bad checksum field!\n");
-                                dcdGood = false;  // reset seek for PPS
-                                largeTimeChangeFlag = false;  // reset large time change criteria
-                                state = SEEKING_SENTENCE;   
-                            }
-                        }
-                    }  // end if/else/else ('$'/READING_SENTENCE/READING_CHECKSUM)
-
-                    // Parse completed NMEA sentence
-                    if (SENTENCE_COMPLETE == state)
-                    {
-                        sentenceCount++;
-                        sentenceBuffer[sentenceLength] = '\0';
-                        if (debug) fprintf(stderr, "%s\n", sentenceBuffer);
-                        
-                        // (TBD) We need to age altitude separately
-                        // (For now, we save last valid altitude, if applicable
-                        //  i.e., not all NMEA sentences contain an altitude so
-                        //  we stick with whatever was given (providing the 
-                        //  
-                        bool oldAltitudeIsValid = p.zvalid;
-                        double oldAltitude = (oldAltitudeIsValid) ? p.z : 0.0;
-                        
-                        if (NMEAParser::GetTimeAndPosition(sentenceBuffer, &p))
-                        {
-                            gettimeofday(&currentTime, &tz);
-                            // OK, Got an ACTIVE GPRMC or GPGGA sentence
-                            // now set time, log position, etc
-                            if (setTimePending && p.tvalid)
-                            {
-                                setTimePending = false;  // ensures one time adjustment per pulse
-                                                         // even with multiple sentences per pulse
-                                // Compute current time of day adjustment based on
-                                // previously received GPS time (at system time "refTime")
-                                // (accounts for serial I/O sentence transmission delay, etc)
-                                struct timeval* refTime;
-                                if (use_pps)
-                                    refTime = &pulseTime;
-                                else
-                                    refTime = &sentenceStartTime;
-                                
-                                // Calculate deltaTime using gpsTime and refTime
-                                // (note that this trashes the refTime
-                                struct timeval deltaTime;
-                                // Perform the carry for the later subtraction by updating y
-                                if (p.gps_time.tv_usec < refTime->tv_usec) 
-                                {
-                                    int nsec = (refTime->tv_usec - p.gps_time.tv_usec) / 1000000 + 1;
-                                    refTime->tv_usec -= 1000000 * nsec;
-                                    refTime->tv_sec += nsec;
-                                }
-                                if (p.gps_time.tv_usec - refTime->tv_usec > 1000000) 
-                                {
-                                    int nsec = (refTime->tv_usec - p.gps_time.tv_usec) / 1000000;
-                                    refTime->tv_usec += 1000000 * nsec;
-                                    refTime->tv_sec -= nsec;
-                                }
-                                deltaTime.tv_sec = p.gps_time.tv_sec - refTime->tv_sec;
-                                deltaTime.tv_usec = p.gps_time.tv_usec - refTime->tv_usec;
-                                
-                                if (debug) 
-                                {
-                                    fprintf(stderr, "gpsLogger: currentTime>%lu.%06lu deltaTime>%ld.%06lu\n",
-                                                    (unsigned long)currentTime.tv_sec, 
-                                                    (unsigned long)currentTime.tv_usec,
-                                                    (long)deltaTime.tv_sec < 0 ? ((long)deltaTime.tv_sec) + 1 :
-                                                     (unsigned long)deltaTime.tv_sec,
-                                                    ((long)deltaTime.tv_sec < 0 ? (1000000-deltaTime.tv_usec) :
-                                                    (unsigned long)deltaTime.tv_usec));
-                                }
-                                
-                                bool smallDeltaTime = (0 == deltaTime.tv_sec) || 
-                                                      ((long)0xffffffff == deltaTime.tv_sec);
-                                
-                                if (smallDeltaTime && !forceClock)
-                                {
-                                    // deltaTime small (i.e. labs(deltaTime) < 1 sec), so use adjtime()  
-                                    if (-1 == adjtime(&deltaTime, NULL)) 
-                                            perror("gpsLogger: adjtime() error"); 
-                                    largeTimeChangeFlag = false;
-                                    if (!use_pps) setTime = false;  // only set once if not using PPS
-                                }
-                                else
-                                {
-                                    // deltaTime large (i.e. labs(deltaTime) >= 1 second) or (forceClock == true)
-                                    forceClock = false;  // we only _force_ settimeofday() use once
-                                            
-                                    bool changeTime;
-                                    
-                                    if (smallDeltaTime)
-                                    {
-                                        largeTimeChangeFlag = 0;
-                                        changeTime = true;
-                                    }
-                                    else
-                                    {
-                                        // We only call settimeodday() if we get 2 consecutive readings
-                                        // from the GPS device with a similar large delta between the
-                                        // GPS time and the system time
-                                        // The "largeTimeChangeFlag" marks the first large delta reading
-                                        if (largeTimeChangeFlag)
-                                        {
-                                            if (labs(largeTimeChangeDelta - deltaTime.tv_sec) < 10)
-                                            {
-                                                // Consistent large delta from GPS
-                                                changeTime = true;
-                                                fprintf(stderr, "gpsLogger: Warning: attempting time change of 1 second or more ...\n");
-
-                                            }
-                                            else
-                                            {
-                                                // Inconsistent delta, possibly corrupt GPS data
-                                                changeTime = false;
-                                            }
-                                            largeTimeChangeFlag = false;
-                                        }
-                                        else
-                                        {
-                                            fprintf(stderr, "gpsLogger: Warning: delaying time change of 1 second or more ...\n");
-                                            largeTimeChangeFlag = true; 
-                                            largeTimeChangeDelta = deltaTime.tv_sec;
-                                            changeTime = false;
-                                        }
-                                    }
-                                    
-                                    if (changeTime)
-                                    {
-                                        if (!use_pps) setTime = false;  // only set once if not using PPS
-                                        long offsetSec = currentTime.tv_sec - refTime->tv_sec;
-                                        long offsetUsec = currentTime.tv_usec - refTime->tv_usec;
-                                        if (offsetUsec < 0)
-                                        {
-                                            offsetSec--;
-                                            offsetUsec += 1000000;
-                                        }
-                                        currentTime.tv_sec = p.gps_time.tv_sec + offsetSec;
-                                        currentTime.tv_usec = p.gps_time.tv_usec + offsetUsec;
-                                        if (currentTime.tv_usec > 999999)
-                                        {                           
-                                            currentTime.tv_sec++;   
-                                            currentTime.tv_usec -= 1000000;
-                                        }
-                                        if (-1 == settimeofday(&currentTime, &tz)) 
-                                            perror("gpsLogger: settimeofday() error");
-                                    }  // end if (changeTime)
-                                }  // end if/else (smallDeltaTime)
-                            }  // end if (setTime && p.tvalid)
-                            
-                            if (!p.zvalid && oldAltitudeIsValid && p.xyvalid)
-                            {
-                                p.z = oldAltitude;
-                                p.zvalid = true;
-                            }
-                            
-                            if (logging)
-                            {
-                                struct tm* theTime = gmtime((time_t*)&currentTime.tv_sec);
-                                fprintf(log_ptr, "time>%02d:%02d:%02d.%06lu position>%f,%f,%f\n",
-			                                     theTime->tm_hour, 
-			                                     theTime->tm_min,
-			                                     theTime->tm_sec,
-			                                     (unsigned long)currentTime.tv_usec,
-                                                 p.y, p.x, p.z);
-                            }
-                            p.sys_time = currentTime;
-                            p.stale = false;
-                            GPSPublishUpdate(gps_handle, &p);
-                        }
-                        else
-                        {
-                            // Non-useful sentence for whatever reason
-                            // (e.g. non-GPRMC or non-GPGGA sentence, VOID sentence, etc)
-                        }  // end if/else NMEAParser::GetTimeAndPosition()
-                        if(sentenceCount > 3) dcdGood = false;
-                        state = SEEKING_SENTENCE;
-                    }  // end if (SENTENCE_COMPLETE)
-                }  
-                else
-                {
-                    // (TBD) "binary" parsing goes here   
-                }  // end if/else (nmeaParse)
-            }  // end if (dcdGood)
-        }  // end while(dcdGood)
+                
+            default:
+                break;
+        }
     }  // end while(running)
     Cleanup();
     return true;
 }  // end GPSLogger::Main()
 
-void GPSLogger::SignalHandler(int sigNum)
+// Reopens the lost input "device", retrying with backoff (see
+// ReconnectBackoff) and beating the publication's heartbeat meanwhile,
+// until it succeeds or a shutdown signal arrives, and restores its serial
+// port settings ("attr", if non-NULL).  Returns the new descriptor
+// (or -1 if shut down).
+int GPSLogger::ReopenInput(const char* device, int flags, bool isSerialDevice,
+                           unsigned int baud, const struct termios* attr)
 {
-    switch(sigNum)
+    ReconnectBackoff backoff;
+    struct timeval lostTime;
+    gettimeofday(&lostTime, NULL);
+    while (running)
     {
-        case SIGTERM:
-        case SIGINT:
-            theApp.Stop();
+        GPSPublishHeartbeat(gps_handle);
+        // (MAX_DELAY is no longer than the heartbeat interval, and a
+        // shutdown signal ends the wait)
+        unsigned int delay = backoff.NextDelay();
+        struct pollfd pfd;
+        pfd.fd = signal_event.GetDescriptor();
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if (delay && (poll(&pfd, 1, delay) > 0))
+        {
+            signal_event.Read();
+            running = false;
             break;
-            
-        case SIGALRM:
-        {
-            theApp.SetStale();
-            struct timeval currentTime;
-            struct timezone tz;
-            gettimeofday(&currentTime, &tz);
-            struct tm* theTime = gmtime((time_t*)&currentTime.tv_sec);
-            fprintf(stderr, "gpsLogger: Serial port PPS timed out! (time>%02d:%02d:%02d.%06lu)\n",
-			                             theTime->tm_hour, 
-			                             theTime->tm_min,
-			                             theTime->tm_sec,
-			                             (unsigned long)currentTime.tv_usec);
-        }
-        break;
-            
-        default:
-            fprintf(stderr, "gpsLogger: Unexpected signal: %d\n", sigNum);
-            break; 
-    }  
-}  // end GPSLogger::SignalHandler()
+        }
+        int fd = open(device, flags);
+        if (fd < 0) continue;
+        if (isSerialDevice)
+        {
+            if (!SerialInput::Configure(fd, baud) ||
+                (attr && (tcsetattr(fd, TCSANOW, attr) < 0)))
+            {
+                close(fd);
+                continue;
+            }
+            tcflush(fd, TCIFLUSH);
+        }
+        struct timeval openTime;
+        gettimeofday(&openTime, NULL);
+        double msec = 1.0e+03 * (openTime.tv_sec - lostTime.tv_sec) +
+                      1.0e-03 * ((long)openTime.tv_usec - (long)lostTime.tv_usec);
+        fprintf(stderr, "gpsLogger: Reconnected input after %.1f msec (%u attempts)\n",
+                        msec, backoff.GetAttempts());
+        return fd;
+    }
+    return -1;
+}  // end GPSLogger::ReopenInput()
 
-void GPSLogger::SetStale()
+bool GPSLogger::AddDevice(const char* name, bool isSerial)
 {
-    p.stale = true;
-    GPSPublishUpdate(gps_handle, &p);
-}  // end GPSLogger::SetStale()
+    if (device_count >= MAX_DEVICES)
+    {
+        fprintf(stderr, "gpsLogger: Too many devices (maximum %d)!\n", MAX_DEVICES);
+        return false;
+    }
+    device_names[device_count] = name;
+    device_is_serial[device_count] = isSerial;
+    device_count++;
+    return true;
+}  // end GPSLogger::AddDevice()
 
-void GPSLogger::Stop()
+// Multiple device mode:  all devices are read (without blocking) by one
+// epoll() loop, and each device's position is published to its own slot
+bool GPSLogger::MainMulti(const char* pubFile, unsigned int baud, bool requireChecksum,
+                          bool logging)
 {
-    running = false;
+    // 3) Init GPS shared memory publishing (one slot per device)
+    if (!(gps_handle = GPSPublishInitSlots(pubFile, device_count)))
+    {
+        fprintf(stderr, "gpsLogger: Error creating shared memory!\n");
+        Cleanup();
+        return false;   
+    }
+    
+    // 4) Open up devices for reading
+    if (!receiver_loop.Open())
+    {
+        Cleanup();
+        return false;
+    }
+    receivers = new GPSReceiver[device_count];
+    for (unsigned int i = 0; i < device_count; i++)
+    {
+        GPSReceiver& receiver = receivers[i];
+        if (!receiver.Open(device_names[i], device_is_serial[i], baud))
+        {
+            fprintf(stderr, "gpsLogger: Error opening input %s!\n", device_names[i]);
+            Cleanup();
+            return false;
+        }
+        receiver.SetRequireChecksum(requireChecksum);
+        receiver.SetDebug(debug);
+        receiver.SetStats(gps_stats);
+        receiver.SetLog(logging ? &log_writer : NULL, i);
+        receiver.SetPublication(GPSGetSlot(gps_handle, i));
+        if (!receiver_loop.Add(&receiver))
+        {
+            Cleanup();
+            return false;
+        }
+        if (debug) fprintf(stderr, "gpsLogger: device>%s slot>%u\n", device_names[i], i);
+    }
+    
+    // Shutdown signals and the tick timer (see Main()) are waited
+    // for with the devices
+    bool signalReady = false;
+    bool tickReady = false;
+    if (!tick_timer.Open(GPS_HEARTBEAT_INTERVAL) ||
+        !receiver_loop.Watch(signal_event.GetDescriptor(), &signalReady) ||
+        ((tick_timer.GetDescriptor() >= 0) && 
+         !receiver_loop.Watch(tick_timer.GetDescriptor(), &tickReady)))
+    {
+        Cleanup();
+        return false;
+    }
+    
+    running = true;
+    struct timeval currentTime;
+    gettimeofday(&currentTime, NULL);
+    while (running)
+    {
+        // (wait no longer than the next epoch assembly timeout or
+        // reconnection attempt)
+        int timeout = tick_timer.GetTimeout();
+        for (unsigned int i = 0; i < device_count; i++)
+        {
+            int t = receivers[i].GetTimeout(currentTime);
+            if ((t >= 0) && ((timeout < 0) || (t < timeout))) timeout = t;
+        }
+        signalReady = tickReady = false;
+        if (receiver_loop.Poll(timeout) < 0)
+        {
+            Cleanup();
+            return false;
+        }
+        if (signalReady)
+        {
+            signal_event.Read();
+            break;  // (shut down)
+        }
+        // Publish timed out epochs, check published positions for
+        // "freshness", and reconnect lost devices (that are due)
+        gettimeofday(&currentTime, NULL);
+        for (unsigned int i = 0; i < device_count; i++)
+        {
+            GPSReceiver& receiver = receivers[i];
+            receiver.CheckStale(currentTime, 30);
+            if (receiver.Reconnect(currentTime) && !receiver_loop.Add(&receiver))
+                receiver.Close();  // (and it is done)
+        }
+        // Each tick beats the publication's heartbeat (see
+        // GPSSubscriptionIsValid()) and checks there are devices left
+        if (((tick_timer.GetDescriptor() >= 0) && !tickReady) || (0 == tick_timer.Read()))
+            continue;
+        GPSPublishHeartbeat(gps_handle);
+        unsigned int openCount = 0;
+        for (unsigned int i = 0; i < device_count; i++)
+        {
+            if (receivers[i].IsOpen() || receivers[i].IsLost()) openCount++;
+        }
+        if (0 == openCount)
+        {
+            fprintf(stderr, "gpsLogger: No devices left open!\n");
+            Cleanup();
+            return false;
+        }
+    }
     Cleanup();
-    fprintf(stderr, "gpsLogger: Done.\n");
-    exit(0);
-}  // end GPSLogger::Stop()
+    return true;
+}  // end GPSLogger::MainMulti()
 
 void GPSLogger::Cleanup()
 {
+    // (the stages, e.g. the parser restarting PPS capture, stop first)
+    parser_stage.StopThread();
+    publisher_stage.StopThread();
+    if (pps_capture.IsRunning())
+    {
+        pps_capture.Stop();
+        if (debug || (0 != pps_capture.GetDropCount()))
+            fprintf(stderr, "gpsLogger: PPS edges>%lu dropped>%lu\n",
+                            pps_capture.GetEdgeCount(), pps_capture.GetDropCount());
+    }
+    pps_kernel.Close();
+    if (receivers)
+    {
+        for (unsigned int i = 0; i < device_count; i++)
+        {
+            if (debug)
+                fprintf(stderr, "gpsLogger: device>%s sentences>%lu fixes>%lu errors>%lu reads>%lu\n",
+                                receivers[i].GetName(), receivers[i].GetSentenceCount(),
+                                receivers[i].GetFixCount(), receivers[i].GetErrorCount(),
+                                receivers[i].GetReadCount());
+            receivers[i].Close();
+        }
+        delete[] receivers;
+        receivers = NULL;
+    }
+    receiver_loop.Close();
+    tick_timer.Close();
     if (input_fd >= 0)
     {
         close(input_fd);
         input_fd = -1;
     }
+    if (log_writer.IsOpen())
+    {
+        log_writer.Close();
+        LogWriter::Stats stats;
+        log_writer.GetStats(stats);
+        if (debug || (0 != stats.dropped))
+        {
+            fprintf(stderr, "gpsLogger: log entries>%lu written>%lu dropped>%lu maxQueueDepth>%u\n"
+                            "gpsLogger: log enqueue time (usec) mean>%.3f max>%.3f "
+                            "write time (usec) mean>%.3f max>%.3f\n",
+                            stats.logged, stats.written, stats.dropped, stats.max_depth,
+                            stats.logged ? (stats.enqueue_nsec / 1.0e03 / stats.logged) : 0.0,
+                            stats.enqueue_max_nsec / 1.0e03,
+                            stats.written ? (stats.write_nsec / 1.0e03 / stats.written) : 0.0,
+                            stats.write_max_nsec / 1.0e03);
+        }
+    }
     if (log_ptr)
     {
         fclose(log_ptr);
@@ -974,16 +1120,28 @@ void GPSLogger::Cleanup()
     }
     if (gps_handle)
     {
-         GPSPublishShutdown(gps_handle, NULL);
+         GPSPublishShutdown(gps_handle, pub_file);
          gps_handle = NULL;   
     }
+    if (gps_stats)
+    {
+        GPSStatsShutdown(gps_stats, pub_file);
+        gps_stats = NULL;
+    }
 }  // end GPSLogger::Cleanup()
 
 void GPSLogger::Usage()
 {
     fprintf(stderr, "gpsLogger Version %s\n", VERSION);
     fprintf(stderr, "Usage: gpsLogger [setTime][pps][noLog][log <logFile>]\n"
-                    "                 [device <serialDevice>][speed <baud>][gps35]\n"
+                    "                 [device <serialDevice>]...[speed <baud>][gps35]\n"
                     "                  [cts][invert]\n"
-                    "                 [input <inputName][pubFile <pubFile>]\n");
+                    "                 [input <inputName][pubFile <pubFile>][pubLock]\n"
+                    "                 [logQueue <queueSize>][logPolicy {drop|block}]\n"
+                    "                 [logFormat {text|binary}]\n"
+                    "                 [adjtime][clockTC <seconds>]\n"
+                    "                 [ppsDevice <ppsDevice>][ppsFake]\n"
+                    "                 [pipeline [<readerCpu>,<parserCpu>,<publisherCpu>,<loggerCpu>]]\n"
+                    "                 [priority {<priority>|none}][cpus <cpuList>]\n"
+                    "                 [memLock [<stackKbytes>]][jitterTest [<seconds>]]\n");
 }
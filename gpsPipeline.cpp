@@ -0,0 +1,715 @@
+
+#include "gpsPipeline.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include <sched.h>
+#include <unistd.h>
+
+// (glibc 2.30 added sem_clockwait(), so timeouts needn't follow the
+// system clock)
+#ifdef __GLIBC__
+#if __GLIBC_PREREQ(2, 30)
+#define HAVE_SEM_CLOCKWAIT
+#endif
+#endif // __GLIBC__
+
+PipelineStage::PipelineStage()
+ : thread_started(false), stopping(false)
+{
+}
+
+PipelineStage::~PipelineStage()
+{
+    // (derived stages stop their thread, Service() being theirs)
+}
+
+bool PipelineStage::StartThread(const char* name, int cpu)
+{
+    if (thread_started) return true;
+    if (sem_init(&ready, 0, 0))
+    {
+        perror("PipelineStage::StartThread() sem_init() error");
+        return false;
+    }
+    // The thread is created with the caller's policy, one priority level
+    // below a real-time caller's, so it never runs at the caller's level
+    // (it inherits the caller's signal mask)
+    int policy;
+    struct sched_param schp;
+    int result = pthread_getschedparam(pthread_self(), &policy, &schp);
+    if (0 != result)
+    {
+        fprintf(stderr, "PipelineStage::StartThread() pthread_getschedparam() error: %s\n",
+                        strerror(result));
+        sem_destroy(&ready);
+        return false;
+    }
+    if ((SCHED_OTHER != policy) && (schp.sched_priority > sched_get_priority_min(policy)))
+        schp.sched_priority--;
+    pthread_attr_t attr;
+    if (0 != (result = pthread_attr_init(&attr)))
+    {
+        fprintf(stderr, "PipelineStage::StartThread() pthread_attr_init() error: %s\n",
+                        strerror(result));
+        sem_destroy(&ready);
+        return false;
+    }
+    if ((0 != (result = pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED))) ||
+        (0 != (result = pthread_attr_setschedpolicy(&attr, policy))) ||
+        (0 != (result = pthread_attr_setschedparam(&attr, &schp))))
+    {
+        fprintf(stderr, "PipelineStage::StartThread() error: can't set %s thread policy %d priority %d: %s\n",
+                        name, policy, schp.sched_priority, strerror(result));
+        pthread_attr_destroy(&attr);
+        sem_destroy(&ready);
+        return false;
+    }
+    stopping = false;
+    result = pthread_create(&thread, &attr, ThreadMain, this);
+    pthread_attr_destroy(&attr);
+    if (0 != result)
+    {
+        fprintf(stderr, "PipelineStage::StartThread() pthread_create() error: %s\n",
+                        strerror(result));
+        sem_destroy(&ready);
+        return false;
+    }
+    thread_started = true;
+#ifdef LINUX
+    pthread_setname_np(thread, name);
+#endif // LINUX
+    if (cpu >= 0) PinThread(thread, cpu);
+    return true;
+}  // end PipelineStage::StartThread()
+
+void PipelineStage::StopThread()
+{
+    if (!thread_started) return;
+    __atomic_store_n(&stopping, true, __ATOMIC_RELEASE);
+    sem_post(&ready);
+    pthread_join(thread, NULL);
+    sem_destroy(&ready);
+    thread_started = false;
+}  // end PipelineStage::StopThread()
+
+bool PipelineStage::PinThread(pthread_t thread, int cpu)
+{
+#ifdef LINUX
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    int result = pthread_setaffinity_np(thread, sizeof(cpus), &cpus);
+    if (0 != result)
+    {
+        fprintf(stderr, "PipelineStage::PinThread() warning: can't pin thread to CPU %d: %s\n",
+                        cpu, strerror(result));
+        return false;
+    }
+    return true;
+#else
+    fprintf(stderr, "PipelineStage::PinThread() warning: CPU pinning not supported\n");
+    return false;
+#endif // if/else LINUX
+}  // end PipelineStage::PinThread()
+
+void* PipelineStage::ThreadMain(void* arg)
+{
+    ((PipelineStage*)arg)->Run();
+    return NULL;
+}  // end PipelineStage::ThreadMain()
+
+void PipelineStage::Run()
+{
+    while (!__atomic_load_n(&stopping, __ATOMIC_ACQUIRE))
+    {
+        int timeout = GetTimeout();
+        if (timeout < 0)
+        {
+            sem_wait(&ready);
+        }
+        else if (timeout > 0)
+        {
+            struct timespec deadline;
+#ifdef HAVE_SEM_CLOCKWAIT
+            clock_gettime(CLOCK_MONOTONIC, &deadline);
+#else
+            // (any input ends the wait too, so a system clock step
+            // delays a timeout no longer than that)
+            clock_gettime(CLOCK_REALTIME, &deadline);
+#endif // if/else HAVE_SEM_CLOCKWAIT
+            deadline.tv_sec += timeout / 1000;
+            deadline.tv_nsec += (timeout % 1000) * 1000000;
+            if (deadline.tv_nsec >= 1000000000)
+            {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000;
+            }
+#ifdef HAVE_SEM_CLOCKWAIT
+            sem_clockwait(&ready, CLOCK_MONOTONIC, &deadline);
+#else
+            sem_timedwait(&ready, &deadline);
+#endif // if/else HAVE_SEM_CLOCKWAIT
+        }
+        Service();
+    }
+    Service();  // (anything queued before stopping)
+}  // end PipelineStage::Run()
+
+
+PublisherStage::PublisherStage()
+ : gps_handle(NULL), log_writer(NULL), gps_stats(NULL), debug(false),
+   set_time(false), use_pps(false), force_clock(false), use_clock_loop(false),
+   large_time_change(false), large_time_change_delta(0)
+{
+    memset(&position, 0, sizeof(position));
+}
+
+PublisherStage::~PublisherStage()
+{
+    StopThread();
+}
+
+bool PublisherStage::Open(GPSHandle gpsHandle, LogWriter* logWriter, unsigned int queueSize)
+{
+    if (!queue.Init(queueSize))
+    {
+        fprintf(stderr, "PublisherStage::Open() error: queue allocation failed\n");
+        return false;
+    }
+    gps_handle = gpsHandle;
+    log_writer = logWriter;
+    memset(&position, 0, sizeof(GPSPositionV2));
+    position.version = GPS_POSITION_V2;
+    position.size = sizeof(GPSPositionV2);
+    position.stale = true;
+    GPSPublishUpdateV2(gps_handle, &position);
+    return true;
+}  // end PublisherStage::Open()
+
+void PublisherStage::SetClock(bool setTime, bool usePPS, bool forceClock,
+                              bool clockLoop, double clockTimeConstant,
+                              ClockBackend* clockBackend)
+{
+    set_time = setTime;
+    use_pps = usePPS;
+    force_clock = forceClock;
+    // With "set pps", the clock is steered by a phase/frequency-locked
+    // loop (the "adjtime" option selects per-pulse adjtime() instead)
+    use_clock_loop = setTime && usePPS && clockLoop;
+    if (use_clock_loop && clockBackend)
+    {
+        clock_discipline.Init(clockBackend, clockTimeConstant);
+    }
+    else if (use_clock_loop)
+    {
+        if (!system_clock.Init())
+            fprintf(stderr, "gpsLogger: Warning! Clock frequency can't be set, using adjtime() only\n");
+        clock_discipline.Init(&system_clock, clockTimeConstant);
+    }
+}  // end PublisherStage::SetClock()
+
+bool PublisherStage::Put(FixEvent& event)
+{
+    event.queue_time = gps_stats ? GPSStatsClock() : 0;
+    if (!queue.Push(event))
+    {
+        GPSStatsCount(gps_stats, GPS_STATS_PUBLISHER_DROPS);
+        return false;
+    }
+    Wake();
+    return true;
+}  // end PublisherStage::Put()
+
+void PublisherStage::Service()
+{
+    FixEvent event;
+    while (queue.Pop(event))
+    {
+        if (event.queue_time)
+            GPSStatsRecord(gps_stats, GPS_STATS_PARSER_TO_PUBLISHER, GPSStatsClock() - event.queue_time);
+        switch (event.type)
+        {
+            case FixEvent::FIX:
+                position = event.fix;
+                if (log_writer) log_writer->Log(position);
+                GPSPublishUpdateV2(gps_handle, &position);
+                GPSStatsCount(gps_stats, GPS_STATS_FIXES);
+                if (event.parsed_time)
+                    GPSStatsRecord(gps_stats, GPS_STATS_PARSED_TO_PUBLISHED,
+                                   GPSStatsClock() - event.parsed_time);
+                break;
+
+            case FixEvent::CLOCK:
+                AdjustClock(event);
+                break;
+
+            case FixEvent::RESTART:
+                large_time_change = false;  // reset large time change criteria
+                break;
+
+            case FixEvent::STALE:
+                SetStale();
+                break;
+
+            case FixEvent::TICK:
+            {
+                // (a fix over 30 seconds old is stale)
+                struct timeval currentTime;
+                gettimeofday(&currentTime, NULL);
+                if (!position.stale && ((currentTime.tv_sec - position.sys_time.tv_sec) > 30))
+                    SetStale();
+                break;
+            }
+        }
+    }
+}  // end PublisherStage::Service()
+
+void PublisherStage::SetStale()
+{
+    position.stale = true;
+    GPSPublishUpdateV2(gps_handle, &position);
+}  // end PublisherStage::SetStale()
+
+// Sets or adjusts the system clock to the GPS time of "event.fix" (read at
+// system time "event.ref_time")
+void PublisherStage::AdjustClock(const FixEvent& event)
+{
+    if (!set_time) return;  // (already set once, without PPS)
+    const GPSPositionV2& fix = event.fix;
+    bool clockAdjusted = false;
+    // Compute current time of day adjustment based on
+    // previously received GPS time (at system time "refTime")
+    // (accounts for serial I/O sentence transmission delay, etc)
+    struct timeval refTime = event.ref_time;
+    double refSeconds = refTime.tv_sec + 1.0e-06 * refTime.tv_usec;
+    double offset = (fix.gps_time.tv_sec - refTime.tv_sec) +
+                    1.0e-06 * ((long)fix.gps_time.tv_usec - (long)refTime.tv_usec);
+
+    // Calculate deltaTime using gpsTime and refTime
+    // (note that this trashes the refTime
+    struct timeval deltaTime;
+    // Perform the carry for the later subtraction by updating y
+    if (fix.gps_time.tv_usec < refTime.tv_usec)
+    {
+        int nsec = (refTime.tv_usec - fix.gps_time.tv_usec) / 1000000 + 1;
+        refTime.tv_usec -= 1000000 * nsec;
+        refTime.tv_sec += nsec;
+    }
+    if (fix.gps_time.tv_usec - refTime.tv_usec > 1000000)
+    {
+        int nsec = (refTime.tv_usec - fix.gps_time.tv_usec) / 1000000;
+        refTime.tv_usec += 1000000 * nsec;
+        refTime.tv_sec -= nsec;
+    }
+    deltaTime.tv_sec = fix.gps_time.tv_sec - refTime.tv_sec;
+    deltaTime.tv_usec = fix.gps_time.tv_usec - refTime.tv_usec;
+
+    struct timeval currentTime;
+    struct timezone tz;
+    gettimeofday(&currentTime, &tz);
+    if (debug)
+    {
+        fprintf(stderr, "gpsLogger: currentTime>%lu.%06lu deltaTime>%ld.%06lu\n",
+                        (unsigned long)currentTime.tv_sec,
+                        (unsigned long)currentTime.tv_usec,
+                        (long)deltaTime.tv_sec < 0 ? ((long)deltaTime.tv_sec) + 1 :
+                         (unsigned long)deltaTime.tv_sec,
+                        ((long)deltaTime.tv_sec < 0 ? (1000000-deltaTime.tv_usec) :
+                        (unsigned long)deltaTime.tv_usec));
+    }
+
+    // (a clock less than a second ahead gives deltaTime.tv_sec -1)
+    bool smallDeltaTime = (fabs(offset) < 1.0);
+
+    if (smallDeltaTime && !force_clock)
+    {
+        // deltaTime small (i.e. labs(deltaTime) < 1 sec), so use adjtime()
+        // (or the clock discipline loop with PPS)
+        if (use_clock_loop)
+        {
+            clock_discipline.Update(offset, refSeconds);
+            if (debug)
+                fprintf(stderr, "gpsLogger: clock offset>%.6f freq>%.3f ppm jitter>%.6f%s\n",
+                                offset, clock_discipline.GetFrequency(),
+                                clock_discipline.GetJitter(),
+                                clock_discipline.IsLocked() ? "" : " (acquiring)");
+        }
+        else if (-1 == adjtime(&deltaTime, NULL))
+        {
+                perror("gpsLogger: adjtime() error");
+                GPSStatsCount(gps_stats, GPS_STATS_CLOCK_ERRORS);
+        }
+        clockAdjusted = true;
+        large_time_change = false;
+        if (!use_pps) set_time = false;  // only set once if not using PPS
+    }
+    else
+    {
+        // deltaTime large (i.e. labs(deltaTime) >= 1 second) or (force_clock == true)
+        force_clock = false;  // we only _force_ settimeofday() use once
+
+        bool changeTime;
+
+        if (smallDeltaTime)
+        {
+            large_time_change = false;
+            changeTime = true;
+        }
+        else
+        {
+            // We only call settimeodday() if we get 2 consecutive readings
+            // from the GPS device with a similar large delta between the
+            // GPS time and the system time
+            // The "large_time_change" marks the first large delta reading
+            if (large_time_change)
+            {
+                if (labs(large_time_change_delta - deltaTime.tv_sec) < 10)
+                {
+                    // Consistent large delta from GPS
+                    changeTime = true;
+                    fprintf(stderr, "gpsLogger: Warning: attempting time change of 1 second or more ...\n");
+
+                }
+                else
+                {
+                    // Inconsistent delta, possibly corrupt GPS data
+                    changeTime = false;
+                }
+                large_time_change = false;
+            }
+            else
+            {
+                fprintf(stderr, "gpsLogger: Warning: delaying time change of 1 second or more ...\n");
+                GPSStatsCount(gps_stats, GPS_STATS_TIME_CHANGES_DELAYED);
+                large_time_change = true;
+                large_time_change_delta = deltaTime.tv_sec;
+                changeTime = false;
+            }
+        }
+
+        if (changeTime)
+        {
+            if (!use_pps) set_time = false;  // only set once if not using PPS
+            // (the GPS time "now", i.e. as long after the reading as it
+            // has taken to get here)
+            long offsetSec = currentTime.tv_sec - refTime.tv_sec;
+            long offsetUsec = currentTime.tv_usec - refTime.tv_usec;
+            if (offsetUsec < 0)
+            {
+                offsetSec--;
+                offsetUsec += 1000000;
+            }
+            currentTime.tv_sec = fix.gps_time.tv_sec + offsetSec;
+            currentTime.tv_usec = fix.gps_time.tv_usec + offsetUsec;
+            if (currentTime.tv_usec > 999999)
+            {
+                currentTime.tv_sec++;
+                currentTime.tv_usec -= 1000000;
+            }
+            if (-1 == settimeofday(&currentTime, &tz))
+            {
+                perror("gpsLogger: settimeofday() error");
+                GPSStatsCount(gps_stats, GPS_STATS_CLOCK_ERRORS);
+            }
+            else
+            {
+                GPSStatsCount(gps_stats, GPS_STATS_TIME_CHANGES);
+            }
+            clock_discipline.Reset();  // (start frequency acquisition over)
+        }  // end if (changeTime)
+    }  // end if/else (smallDeltaTime)
+    if (clockAdjusted && event.pps && gps_stats)
+    {
+        // (the pulse's edge to the clock adjusted, if not
+        // stepped by settimeofday())
+        struct timeval adjustTime;
+        gettimeofday(&adjustTime, NULL);
+        GPSStatsRecord(gps_stats, GPS_STATS_PPS_TO_ADJUST,
+                       1000LL * (adjustTime.tv_sec - event.ref_time.tv_sec) * 1000000 +
+                       1000LL * ((long)adjustTime.tv_usec - (long)event.ref_time.tv_usec));
+    }
+}  // end PublisherStage::AdjustClock()
+
+
+ParserStage::ParserStage()
+ : publisher(NULL), nmea_parse(true), gps_stats(NULL), debug(false), restart_pending(false),
+   sentence_count(0), set_time(false), set_time_pending(false), pps_capture(NULL),
+   pps_line(NULL), pps_signal(0), pps_invert(false), pps_timed_out(false)
+{
+    pulse_time.tv_sec = pulse_time.tv_usec = 0;
+    pps_check_time = pulse_time;
+}
+
+ParserStage::~ParserStage()
+{
+    StopThread();
+}
+
+bool ParserStage::Open(PublisherStage* thePublisher, bool nmeaParse, unsigned int queueSize)
+{
+    if (!queue.Init(queueSize))
+    {
+        fprintf(stderr, "ParserStage::Open() error: queue allocation failed\n");
+        return false;
+    }
+    publisher = thePublisher;
+    nmea_parse = nmeaParse;
+    restart_pending = false;
+    epoch_assembler.Reset();
+    Restart();
+    return true;
+}  // end ParserStage::Open()
+
+void ParserStage::SetTime(bool setTime, PPSCapture* ppsCapture,
+                          ModemLinePPS* ppsLine, int ppsSignal, bool ppsInvert)
+{
+    set_time = set_time_pending = setTime;
+    pps_capture = ppsCapture;
+    pps_line = ppsLine;
+    pps_signal = ppsSignal;
+    pps_invert = ppsInvert;
+    pps_timed_out = false;
+    gettimeofday(&pps_check_time, NULL);
+}  // end ParserStage::SetTime()
+
+bool ParserStage::Put(InputEvent& event)
+{
+    event.queue_time = gps_stats ? GPSStatsClock() : 0;
+    if (restart_pending)
+    {
+        // (input was dropped, so the sentence it was part of is too,
+        // and "event" is first queued as a RESTART)
+        InputEvent::Type type = event.type;
+        event.type = InputEvent::RESTART;
+        bool queued = queue.Push(event);
+        event.type = type;
+        if (!queued)
+        {
+            GPSStatsCount(gps_stats, GPS_STATS_PARSER_DROPS);
+            return false;
+        }
+        restart_pending = false;
+    }
+    if (!queue.Push(event))
+    {
+        GPSStatsCount(gps_stats, GPS_STATS_PARSER_DROPS);
+        restart_pending = true;
+        return false;
+    }
+    Wake();
+    return true;
+}  // end ParserStage::Put()
+
+void ParserStage::PutLost(int descriptor)
+{
+    InputEvent event;
+    event.type = InputEvent::LOST;
+    event.count = 0;
+    event.descriptor = descriptor;
+    event.queue_time = gps_stats ? GPSStatsClock() : 0;
+    // (only a threaded parser's queue can be full, and it is draining)
+    while (!queue.Push(event)) usleep(1000);
+    Wake();
+}  // end ParserStage::PutLost()
+
+int ParserStage::GetTimeout() const
+{
+    if (!epoch_assembler.IsPending()) return -1;
+    struct timeval currentTime;
+    gettimeofday(&currentTime, NULL);
+    return epoch_assembler.GetTimeout(currentTime);
+}  // end ParserStage::GetTimeout()
+
+void ParserStage::Service()
+{
+    InputEvent event;
+    while (queue.Pop(event))
+    {
+        if (event.queue_time)
+            GPSStatsRecord(gps_stats, GPS_STATS_READER_TO_PARSER, GPSStatsClock() - event.queue_time);
+        switch (event.type)
+        {
+            case InputEvent::INPUT:
+                // ((TBD) "binary" parsing goes here)
+                if (!nmea_parse) break;
+                for (unsigned int i = 0; i < event.count; i++)
+                    PutByte(event.data[i], event.arrival[i]);
+                break;
+
+            case InputEvent::RESTART:
+                Restart();  // reset seek for PPS
+                Forward(FixEvent::RESTART);
+                break;
+
+            case InputEvent::STALE:
+                Forward(FixEvent::STALE);
+                break;
+
+            case InputEvent::LOST:
+                // (the publication stays, stale, while the input is reopened)
+                Forward(FixEvent::STALE);
+                if (pps_line) pps_capture->Stop();
+                close(event.descriptor);
+                break;
+
+            case InputEvent::RECONNECTED:
+                epoch_assembler.Reset();
+                if (pps_line)
+                {
+                    pps_line->Init(event.descriptor, pps_signal, pps_invert);
+                    if (!pps_capture->Start(pps_line))
+                        fprintf(stderr, "gpsLogger: Error restarting PPS capture!\n");
+                }
+                Restart();
+                Forward(FixEvent::RESTART);
+                break;
+
+            case InputEvent::TICK:
+                Forward(FixEvent::TICK);
+                break;
+        }
+    }
+    // An epoch still missing sentences is published once it times out
+    if (epoch_assembler.IsPending())
+    {
+        struct timeval currentTime;
+        gettimeofday(&currentTime, NULL);
+        if (epoch_assembler.CheckTimeout(currentTime)) PublishEpochs(0);
+    }
+}  // end ParserStage::Service()
+
+// Restarts sentence seeking (and allows one time reading per pulse)
+void ParserStage::Restart()
+{
+    nmea_stream.Reset();
+    sentence_count = 0;
+    set_time_pending = set_time;
+}  // end ParserStage::Restart()
+
+void ParserStage::PutByte(char character, const struct timeval& arrivalTime)
+{
+    NMEAStream::Event event = nmea_stream.PutByte(character, arrivalTime);
+    if (NMEAStream::NONE == event) return;
+    if (NMEAStream::FRAMING_ERROR == event)
+    {
+        if (debug) fprintf(stderr, "%s\n", nmea_stream.GetSentence());
+        fprintf(stderr, "gpsLogger: %s\n", nmea_stream.GetError());
+        GPSStatsCount(gps_stats, (GPSStatsCounter)(GPS_STATS_PREMATURE_SENTENCES +
+                                                   nmea_stream.GetErrorType()));
+        Restart();  // reset seek for PPS
+        Forward(FixEvent::RESTART);  // reset large time change criteria
+        return;
+    }
+    if (NMEAStream::SKIPPED == event)
+    {
+        // (the rest of a sentence type we don't parse was skipped)
+        if (++sentence_count > 3) Restart();
+        return;
+    }
+    // Completed NMEA sentence ("arrivalTime" was the arrival of its last byte)
+    long long completeTime = gps_stats ? GPSStatsClock() : 0;
+    struct timeval currentTime;
+    gettimeofday(&currentTime, NULL);
+    sentence_count++;
+    GPSStatsCount(gps_stats, GPS_STATS_SENTENCES);
+    GPSStatsRecord(gps_stats, GPS_STATS_BYTE_TO_SENTENCE,
+                   1000LL * (currentTime.tv_sec - arrivalTime.tv_sec) * 1000000 +
+                   1000LL * ((long)currentTime.tv_usec - (long)arrivalTime.tv_usec));
+    if (debug) fprintf(stderr, "%s\n", nmea_stream.GetSentence());
+    if (NMEAStream::FIX == event)
+    {
+        OnFix(completeTime, currentTime);
+    }
+    else if (nmea_stream.GetError())
+    {
+        // Non-useful sentence for whatever reason
+        // (e.g. VOID sentence, bad field, etc)
+        fprintf(stderr, "gpsLogger: %s\n", nmea_stream.GetError());
+        GPSStatsCount(gps_stats, GPS_STATS_BAD_FIELDS);
+    }
+    if (sentence_count > 3) Restart();
+}  // end ParserStage::PutByte()
+
+// An ACTIVE sentence (e.g. RMC or GGA) was parsed (and completed at
+// "currentTime"):  pair it with its PPS edge, take a time reading, and
+// add it to its epoch
+void ParserStage::OnFix(long long completeTime, const struct timeval& currentTime)
+{
+    FixEvent clock;
+    clock.fix = nmea_stream.GetFix();
+    const NMEAParser::SentenceInfo& info = nmea_stream.GetInfo();
+    const struct timeval& sentenceStartTime = nmea_stream.GetSentenceStartTime();
+    if (pps_capture)
+    {
+        // Pair the sentence with the pulse that preceded it
+        // (one time reading per pulse)
+        PPSEdge edge;
+        if (pps_capture->GetEdge(sentenceStartTime, 1.0, edge))
+        {
+            pulse_time = edge.time;
+            set_time_pending = set_time;
+            pps_timed_out = false;
+            if (debug) fprintf(stderr, "gpsLogger: caught PPS\n");
+        }
+        else
+        {
+            set_time_pending = false;
+        }
+        if (pps_capture->GetLastEdge(edge)) pps_check_time = edge.time;
+        if (!pps_timed_out && ((sentenceStartTime.tv_sec - pps_check_time.tv_sec) > 10))
+        {
+            struct tm theTime;
+            gmtime_r((time_t*)&sentenceStartTime.tv_sec, &theTime);
+            fprintf(stderr, "gpsLogger: Serial port PPS timed out! (time>%02d:%02d:%02d.%06lu)\n",
+                            theTime.tm_hour,
+                            theTime.tm_min,
+                            theTime.tm_sec,
+                            (unsigned long)sentenceStartTime.tv_usec);
+            GPSStatsCount(gps_stats, GPS_STATS_PPS_TIMEOUTS);
+            pps_timed_out = true;
+        }
+    }
+    long long parsedTime = 0;
+    if (gps_stats)
+    {
+        parsedTime = GPSStatsClock();
+        GPSStatsRecord(gps_stats, GPS_STATS_SENTENCE_TO_PARSED, parsedTime - completeTime);
+    }
+    if (set_time_pending && (0 != (clock.fix.valid & GPS_VALID_TIME)))
+    {
+        // The publisher sets the time from this reading (the GPS time at
+        // the pulse, or else at the sentence start)
+        set_time_pending = false;  // ensures one time adjustment per pulse
+                                   // even with multiple sentences per pulse
+        clock.type = FixEvent::CLOCK;
+        clock.pps = (NULL != pps_capture);
+        clock.ref_time = clock.pps ? pulse_time : sentenceStartTime;
+        clock.parsed_time = parsedTime;
+        publisher->Put(clock);
+    }
+    // The sentences (e.g. GPRMC and GPGGA) of an epoch
+    // are published (and logged) as one fix
+    clock.fix.sys_time = currentTime;
+    if (epoch_assembler.Add(clock.fix, info)) PublishEpochs(parsedTime);
+}  // end ParserStage::OnFix()
+
+void ParserStage::Forward(FixEvent::Type type)
+{
+    FixEvent event;
+    event.type = type;
+    event.parsed_time = 0;
+    publisher->Put(event);
+}  // end ParserStage::Forward()
+
+void ParserStage::PublishEpochs(long long parsedTime)
+{
+    FixEvent event;
+    event.type = FixEvent::FIX;
+    event.parsed_time = parsedTime;
+    while (epoch_assembler.GetFix(event.fix)) publisher->Put(event);
+}  // end ParserStage::PublishEpochs()
@@ -0,0 +1,236 @@
+#ifndef _GPS_PIPELINE
+#define _GPS_PIPELINE
+
+#include "spscQueue.h"
+#include "gpsPub.h"
+#include "gpsStats.h"
+#include "nmeaStream.h"
+#include "epochAssembler.h"
+#include "clockDiscipline.h"
+#include "ppsCapture.h"
+#include "ppsSource.h"
+#include "logWriter.h"
+
+#include <sys/time.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+// The single device gpsLogger loop is a pipeline of stages, each handing
+// its output to the next through a bounded lock-free queue:
+//
+//   reader    - waits for, reads and timestamps the input (and PPS edges
+//               are captured by the PPSCapture thread), GPSLogger::Main()
+//   parser    - frames and parses the NMEA sentences, pairs them with
+//               PPS edges and assembles epochs (ParserStage)
+//   publisher - adjusts the system clock, and publishes and logs each
+//               epoch's fix (PublisherStage)
+//   logger    - formats and writes the log entries (LogWriter)
+//
+// By default the parser and publisher run in the reader's thread as each
+// hand over is made.  Each may instead run on a thread of its own
+// (optionally pinned to a CPU), so the reader never waits on the clock
+// adjustment system calls, publishing or logging.  The time each item
+// waits in each queue is recorded (see "gpsStats.h").
+
+class PipelineStage
+{
+    public:
+        PipelineStage();
+        virtual ~PipelineStage();
+
+        // Runs the stage on a thread of its own, pinned to "cpu" (unless
+        // negative) and, if the caller has a real-time priority, one below
+        // it (so it never preempts the reader)
+        bool StartThread(const char* name, int cpu = -1);
+        // Processes anything still queued and stops the thread
+        void StopThread();
+        bool IsThreaded() const
+            {return thread_started;}
+
+        // When the stage is not threaded, its producer waits no longer
+        // than GetWaitTimeout() msec (-1 for no limit) and then calls Poll()
+        int GetWaitTimeout() const
+            {return thread_started ? -1 : GetTimeout();}
+        void Poll()
+            {if (!thread_started) Service();}
+
+        // Pins thread "thread" to "cpu" (LINUX only)
+        static bool PinThread(pthread_t thread, int cpu);
+
+    protected:
+        // Called by the producer after queueing:  wakes the stage's thread
+        // or (if not threaded) runs the stage now
+        void Wake()
+            {if (thread_started) sem_post(&ready); else Service();}
+        // Processes all queued items (and anything timed out)
+        virtual void Service() = 0;
+        // Msec until Service() is due without input (-1 if never)
+        virtual int GetTimeout() const
+            {return -1;}
+
+    private:
+        static void* ThreadMain(void* arg);
+        void Run();
+
+        sem_t           ready;      // posted for each queued item
+        pthread_t       thread;
+        bool            thread_started;
+        bool            stopping;
+};  // end class PipelineStage
+
+// Reader to parser hand over
+struct InputEvent
+{
+    enum Type
+    {
+        INPUT,          // bytes read
+        RESTART,        // restart sentence seeking (e.g. after a read error)
+        STALE,          // mark the published position stale (read timeout)
+        LOST,           // the input device ("descriptor") was lost (and is reopened)
+        RECONNECTED,    // the input device was reopened ("descriptor")
+        TICK            // heartbeat tick (check published position age)
+    };
+    enum {MAX_BYTES = 64};
+
+    Type            type;
+    unsigned int    count;                  // (INPUT bytes)
+    int             descriptor;             // (LOST, RECONNECTED)
+    long long       queue_time;             // (GPSStatsClock(), with statistics)
+    char            data[MAX_BYTES];
+    struct timeval  arrival[MAX_BYTES];     // (estimated, of each byte)
+};  // end struct InputEvent
+
+// Parser to publisher hand over
+struct FixEvent
+{
+    enum Type
+    {
+        FIX,            // an epoch's fix to publish (and log)
+        CLOCK,          // a time reading to adjust the clock to
+        RESTART,        // reset the large time change criteria
+        STALE,
+        TICK
+    };
+
+    Type            type;
+    GPSPositionV2   fix;            // (FIX: the epoch's, CLOCK: the sentence's)
+    struct timeval  ref_time;       // (CLOCK: system time of "fix.gps_time")
+    bool            pps;            // (CLOCK: "ref_time" is a PPS edge)
+    long long       parsed_time;    // (GPSStatsClock() the fix was parsed)
+    long long       queue_time;
+};  // end struct FixEvent
+
+class PublisherStage : public PipelineStage
+{
+    public:
+        PublisherStage();
+        ~PublisherStage();
+
+        // Publishes to "gpsHandle" (and logs to "logWriter" if non-NULL)
+        bool Open(GPSHandle gpsHandle, LogWriter* logWriter, unsigned int queueSize = 64);
+        // Clock setting ("setTime"), once unless "usePPS", by adjtime()
+        // or, with PPS and "clockLoop", the clock discipline loop (see
+        // "clockDiscipline.h"), and with settimeofday() first if
+        // "forceClock".  The loop steers "clockBackend" if given (e.g. a
+        // SimulatedClock), else the system clock.
+        void SetClock(bool setTime, bool usePPS, bool forceClock,
+                      bool clockLoop, double clockTimeConstant,
+                      ClockBackend* clockBackend = NULL);
+        void SetDebug(bool state)
+            {debug = state;}
+        void SetStats(GPSStats* gpsStats)
+            {gps_stats = gpsStats;}
+
+        // Producer (parser) side (false if the queue is full, and "event"
+        // is dropped and counted)
+        bool Put(FixEvent& event);
+
+    protected:
+        void Service();
+
+    private:
+        void AdjustClock(const FixEvent& event);
+        void SetStale();
+
+        GPSHandle               gps_handle;
+        LogWriter*              log_writer;
+        GPSStats*               gps_stats;
+        bool                    debug;
+        SPSCQueue<FixEvent>     queue;
+        GPSPositionV2           position;   // (latest published)
+        // (clock setting)
+        bool                    set_time;
+        bool                    use_pps;
+        bool                    force_clock;
+        bool                    use_clock_loop;
+        SystemClock             system_clock;
+        ClockDiscipline         clock_discipline;
+        bool                    large_time_change;  // (first of two readings seen)
+        long                    large_time_change_delta;
+};  // end class PublisherStage
+
+class ParserStage : public PipelineStage
+{
+    public:
+        ParserStage();
+        ~ParserStage();
+
+        // Parses into "publisher" ("nmeaParse" false only reads the input)
+        bool Open(PublisherStage* publisher, bool nmeaParse, unsigned int queueSize = 64);
+        void SetRequireChecksum(bool state)
+            {nmea_stream.SetRequireChecksum(state);}
+        void SetEpochTimeout(unsigned int msec)
+            {epoch_assembler.SetTimeout(msec);}
+        // Time readings (FixEvent::CLOCK) are made with "setTime", one
+        // per PPS edge if "ppsCapture" is non-NULL (a modem line
+        // "ppsLine" is restarted when the input is reconnected)
+        void SetTime(bool setTime, PPSCapture* ppsCapture = NULL,
+                     ModemLinePPS* ppsLine = NULL, int ppsSignal = 0, bool ppsInvert = false);
+        void SetDebug(bool state)
+            {debug = state;}
+        void SetStats(GPSStats* gpsStats)
+            {gps_stats = gpsStats;}
+
+        // Producer (reader) side (false if the queue is full, and "event"
+        // is dropped and counted, and sentence seeking is restarted once
+        // there is room again)
+        bool Put(InputEvent& event);
+        // The input "descriptor" was lost:  the parser stops any modem line
+        // PPS capture waiting on it before closing it, so the capture never
+        // waits on the descriptor number reused by the reopened device
+        // (queued even when the queue is full)
+        void PutLost(int descriptor);
+
+    protected:
+        void Service();
+        int GetTimeout() const;
+
+    private:
+        void Restart();
+        void PutByte(char character, const struct timeval& arrivalTime);
+        void OnFix(long long completeTime, const struct timeval& completeSysTime);
+        void Forward(FixEvent::Type type);
+        void PublishEpochs(long long parsedTime);
+
+        PublisherStage*         publisher;
+        bool                    nmea_parse;
+        GPSStats*               gps_stats;
+        bool                    debug;
+        SPSCQueue<InputEvent>   queue;
+        bool                    restart_pending;    // (producer side, after a drop)
+        NMEAStream              nmea_stream;
+        EpochAssembler          epoch_assembler;
+        unsigned int            sentence_count;     // (since restart)
+        // (time readings)
+        bool                    set_time;
+        bool                    set_time_pending;   // (one per PPS edge)
+        PPSCapture*             pps_capture;
+        ModemLinePPS*           pps_line;
+        int                     pps_signal;
+        bool                    pps_invert;
+        struct timeval          pulse_time;
+        struct timeval          pps_check_time;
+        bool                    pps_timed_out;
+};  // end class ParserStage
+
+#endif // _GPS_PIPELINE
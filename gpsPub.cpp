@@ -2,124 +2,550 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/ipc.h>
-#include <sys/shm.h>
+#include <sys/mman.h> // for shm_open(), mmap()
 #include <sys/stat.h> // for permissions flags
+#include <fcntl.h>
+#include <sched.h>    // for sched_yield()
+#include <time.h>
+#include <errno.h>
+#include <limits.h>
+#ifdef LINUX
+#include <linux/futex.h>
+#include <linux/magic.h>  // for HUGETLBFS_MAGIC
+#include <sys/syscall.h>
+#include <sys/vfs.h>      // for statfs()
+#endif // LINUX
 
 #include <unistd.h>  // for unlink()
 
 static const char* GPS_DEFAULT_KEY_FILE = "/tmp/gpskey";
 
+// The segment is a POSIX shared memory object named for the "keyFile"
+// path (e.g. "/tmp/gpskey" is "/tmp.gpskey", i.e. "/dev/shm/tmp.gpskey"
+// on Linux), so attaching is one shm_open() and mmap() and a segment
+// never outlives its name.  A "keyFile" on a hugetlbfs mount is instead
+// the segment itself (a file there, backed by huge pages).
+
+// The shared memory segment begins with a GPSHeader, and the
+// GPSHandle points at the published data that follows it.
+// The "size" field must remain last so it immediately precedes
+// the published data (as it did in the original layout).
+// A segment may hold several publications ("slots", e.g. one per GPS
+// receiver of a multi-device gpsLogger), each with its own GPSHeader,
+// at a cache-line aligned stride.  Each slot header tells its slot
+// number and the segment's slot count (both zero in segments from
+// before slots, i.e. slot 0 of 1).
+// Updates are protected by a sequence lock ("seqlock"):  the
+// single writer makes "sequence" odd while it modifies the data
+// and even again when done, so readers never block and simply
+// retry if the sequence was odd or changed during their copy.
+// The publisher's liveness (its "pid", "start_token" and "heartbeat")
+// is kept in the slot 0 header for the whole segment.
+static const unsigned int GPS_PUB_VERSION = 0x47505304;  // "GPS" + layout 4
+
+typedef struct GPSHeader
+{
+    unsigned int        version;
+    unsigned int        sequence;   // odd while an update is in progress
+    unsigned int        map_size;   // size of the segment's mapping
+    unsigned int        options;    // GPS_PUBLISH_* options (and GPS_SEGMENT_HUGETLB)
+    int                 pid;        // publisher process ID (0 after shutdown)
+    unsigned int        heartbeat_timeout;  // msec
+    unsigned long long  start_token;        // publisher start time (usec since 1970)
+    unsigned long long  heartbeat;          // msec (monotonic clock) of last heartbeat
+    unsigned short      slot;       // slot number of this publication
+    unsigned short      slots;      // number of slots in segment (0 means 1)
+    unsigned int        size;       // size of published data (per slot)
+} GPSHeader;
+
+static const unsigned int GPS_SEGMENT_HUGETLB = 0x8000;  // (segment is a hugetlbfs file)
+
+static const unsigned int GPS_MAX_SLOTS = 0xffff;
+static const unsigned int GPS_SLOT_ALIGN = 64;  // (cache line)
+
+static inline GPSHeader* GPSGetHeader(GPSHandle gpsHandle)
+    {return (GPSHeader*)((char*)gpsHandle - sizeof(GPSHeader));}
+
+static inline unsigned int GPSSlotStride(unsigned int size)
+    {return (sizeof(GPSHeader) + size + GPS_SLOT_ALIGN - 1) & ~(GPS_SLOT_ALIGN - 1);}
+
+static inline unsigned int GPSSegmentSize(unsigned int size, unsigned int slots)
+    {return (slots - 1)*GPSSlotStride(size) + sizeof(GPSHeader) + size;}
+
+// Returns the start of the segment (i.e. slot 0 header) holding "gpsHandle"
+static inline char* GPSGetSegment(GPSHandle gpsHandle)
+{
+    const GPSHeader* h = GPSGetHeader(gpsHandle);
+    return ((char*)h - h->slot*GPSSlotStride(h->size));
+}  // end GPSGetSegment()
+
+// Waiter counts:  the writer only issues a FUTEX_WAKE (a syscall) when a
+// GPSWaitForUpdate() caller is asleep on the slot's "sequence".  As
+// subscribers map the segment read-only, each slot's count of sleeping
+// waiters is kept in a companion POSIX shared memory object (the segment's
+// object name plus ".waiters", writable by all, so the worst another user
+// can do is cause spurious or late wakeups) that is mapped directly after
+// the segment, so it is found from any handle.  (A waiter that dies asleep
+// leaves its count behind, and the writer then wakes on every update)
+static const char* GPS_WAITERS_SUFFIX = ".waiters";
+
+static inline unsigned int GPSWaitersSize(unsigned int slots)
+{
+    unsigned long pageSize = (unsigned long)sysconf(_SC_PAGESIZE);
+    return (unsigned int)((slots*sizeof(unsigned int) + pageSize - 1) / pageSize * pageSize);
+}  // end GPSWaitersSize()
+
+static inline unsigned int* GPSGetWaiters(const GPSHeader* h)
+{
+    const char* segment = GPSGetSegment((const char*)h + sizeof(GPSHeader));
+    return ((unsigned int*)(segment + ((const GPSHeader*)segment)->map_size) + h->slot);
+}  // end GPSGetWaiters()
+
+// (set once a subscription's waiter counts can't be mapped writable, as
+// this process' GPSWaitForUpdate() calls then can't be woken, and poll)
+static bool gps_wait_polls = false;
+
+// Returns NULL if the publication has no fix history (e.g. it was created
+// using GPSMemoryInit() with a different size)
+static inline GPSHistory* GPSGetHistory(GPSHandle gpsHandle)
+{
+    if (GPSGetHeader(gpsHandle)->size < (sizeof(GPSPosition) + sizeof(GPSHistory)))
+        return NULL;
+    return (GPSHistory*)((char*)gpsHandle + sizeof(GPSPosition));
+}  // end GPSGetHistory()
+
+// The GPSPositionV2 follows the GPSHistory, at the next cache line
+// boundary of the slot (the GPSHeader begins the slot)
+static inline unsigned int GPSPositionV2Offset()
+{
+    unsigned int end = sizeof(GPSHeader) + sizeof(GPSPosition) + sizeof(GPSHistory);
+    return ((end + GPS_SLOT_ALIGN - 1) & ~(GPS_SLOT_ALIGN - 1)) - sizeof(GPSHeader);
+}  // end GPSPositionV2Offset()
+
+// Returns NULL if the publication has no GPSPositionV2 (e.g. it was created
+// by an older publisher)
+static inline GPSPositionV2* GPSGetPositionV2(GPSHandle gpsHandle)
+{
+    if (GPSGetHeader(gpsHandle)->size < (GPSPositionV2Offset() + sizeof(GPSPositionV2)))
+        return NULL;
+    return (GPSPositionV2*)((char*)gpsHandle + GPSPositionV2Offset());
+}  // end GPSGetPositionV2()
+
+extern "C" unsigned int GPSGetPublishSize()
+{
+    return (GPSPositionV2Offset() + sizeof(GPSPositionV2));
+}  // end GPSGetPublishSize()
+
+extern "C" void GPSPositionToV2(const GPSPosition* position, GPSPositionV2* positionV2)
+{
+    memset(positionV2, 0, sizeof(GPSPositionV2));
+    positionV2->version = GPS_POSITION_V2;
+    positionV2->size = sizeof(GPSPositionV2);
+    if (position->xyvalid) positionV2->valid |= GPS_VALID_XY;
+    if (position->zvalid) positionV2->valid |= GPS_VALID_Z;
+    if (position->tvalid) positionV2->valid |= GPS_VALID_TIME;
+    positionV2->stale = position->stale;
+    positionV2->x = position->x;
+    positionV2->y = position->y;
+    positionV2->z = position->z;
+    positionV2->gps_time = position->gps_time;
+    positionV2->sys_time = position->sys_time;
+}  // end GPSPositionToV2()
+
+extern "C" void GPSPositionFromV2(const GPSPositionV2* positionV2, GPSPosition* position)
+{
+    position->x = positionV2->x;
+    position->y = positionV2->y;
+    position->z = positionV2->z;
+    position->gps_time = positionV2->gps_time;
+    position->sys_time = positionV2->sys_time;
+    position->xyvalid = (0 != (positionV2->valid & GPS_VALID_XY));
+    position->zvalid = (0 != (positionV2->valid & GPS_VALID_Z));
+    position->tvalid = (0 != (positionV2->valid & GPS_VALID_TIME));
+    position->stale = positionV2->stale;
+}  // end GPSPositionFromV2()
+
+// The heartbeat clock (msec), read without a syscall (i.e. the vDSO,
+// at the coarse clock's few msec resolution where available)
+static inline unsigned long long GPSHeartbeatClock()
+{
+    struct timespec now;
+#ifdef CLOCK_MONOTONIC_COARSE
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &now);
+#endif // if/else CLOCK_MONOTONIC_COARSE
+    return ((unsigned long long)now.tv_sec * 1000 + now.tv_nsec / 1000000);
+}  // end GPSHeartbeatClock()
+
+// Writer side of the sequence lock
+static inline void GPSWriteBegin(GPSHeader* h)
+{
+    unsigned int seq = __atomic_load_n(&h->sequence, __ATOMIC_RELAXED);
+    __atomic_store_n(&h->sequence, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);  // odd sequence visible before data
+}  // end GPSWriteBegin()
+
+// The "sequence" word also serves as a futex so that GPSWaitForUpdate()
+// callers sleep in the kernel until the next update, counted as waiters
+// (see GPSGetWaiters()) so the writer skips the wake when there are none
+#ifdef LINUX
+static inline long GPSFutex(const unsigned int* addr, int op, unsigned int val,
+                            const struct timespec* timeout)
+    {return syscall(SYS_futex, addr, op, val, timeout, NULL, 0);}
+
+// Sleeps (for at most "timeout") unless "sequence" has changed from "seq".
+// The waiter count increment is ordered before the futex's check of
+// "sequence", and the writer's "sequence" store before its check of the
+// count, so either the waiter sees the update or the writer sees the
+// waiter.  Returns the futex error (e.g. ETIMEDOUT), or zero if woken.
+static int GPSFutexWait(const GPSHeader* h, unsigned int seq, const struct timespec* timeout)
+{
+    unsigned int* waiters = GPSGetWaiters(h);
+    __atomic_fetch_add(waiters, 1, __ATOMIC_SEQ_CST);
+    int error = (GPSFutex(&h->sequence, FUTEX_WAIT, seq, timeout) < 0) ? errno : 0;
+    __atomic_fetch_sub(waiters, 1, __ATOMIC_RELAXED);
+    return error;
+}  // end GPSFutexWait()
+#endif // LINUX
+
+// (every update is also a heartbeat)
+static inline void GPSWriteEnd(GPSHeader* h)
+{
+    unsigned int seq = __atomic_load_n(&h->sequence, __ATOMIC_RELAXED);
+    __atomic_store_n(&h->sequence, seq + 1, __ATOMIC_RELEASE);
+#ifdef LINUX
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);  // (see GPSFutexWait())
+    if (0 != __atomic_load_n(GPSGetWaiters(h), __ATOMIC_RELAXED))
+        GPSFutex(&h->sequence, FUTEX_WAKE, INT_MAX, NULL);
+#endif // LINUX
+    GPSHeader* h0 = (GPSHeader*)GPSGetSegment((char*)h + sizeof(GPSHeader));
+    __atomic_store_n(&h0->heartbeat, GPSHeartbeatClock(), __ATOMIC_RELEASE);
+}  // end GPSWriteEnd()
+
+// True while the segment's publisher hasn't shut down and has beaten its
+// heartbeat within its timeout ("h0" is the slot 0 header)
+static inline bool GPSPublisherIsLive(const GPSHeader* h0)
+{
+    if (0 == __atomic_load_n(&h0->pid, __ATOMIC_ACQUIRE)) return false;
+    unsigned long long heartbeat = __atomic_load_n(&h0->heartbeat, __ATOMIC_ACQUIRE);
+    // (a heartbeat "ahead" of this clock is a fresh one seen first)
+    unsigned long long now = GPSHeartbeatClock();
+    return ((now < heartbeat) || ((now - heartbeat) <= h0->heartbeat_timeout));
+}  // end GPSPublisherIsLive()
+
+// Reader side of the sequence lock.  While an update is in progress
+// readers spin briefly, then yield and then sleep on the "sequence" futex
+// (a msec at a time), so a preempted writer (even one of lower priority,
+// on the same CPU) gets to finish it, for as long as it takes.  Only a
+// publisher that died mid-update (see GPSPublisherIsLive()) makes
+// GPSReadBegin() give up and return false, as no consistent copy can
+// be had until a new publisher takes the segment over.
+static const unsigned int GPS_READ_SPIN_MAX = 1000;
+static const unsigned int GPS_READ_YIELD_MAX = 100;
+
+static bool GPSReadBegin(const GPSHeader* h, unsigned int& seq)
+{
+    unsigned int waits = 0;
+    while (0 != ((seq = __atomic_load_n(&h->sequence, __ATOMIC_ACQUIRE)) & 1))
+    {
+        if (++waits <= GPS_READ_SPIN_MAX) continue;
+        if (waits <= (GPS_READ_SPIN_MAX + GPS_READ_YIELD_MAX))
+        {
+            sched_yield();
+            continue;
+        }
+        if (!GPSPublisherIsLive((const GPSHeader*)GPSGetSegment((char*)h + sizeof(GPSHeader))))
+            return false;
+#ifdef LINUX
+        struct timespec pause = {0, 1000000};
+        GPSFutexWait(h, seq, &pause);
+#else
+        struct timespec pause = {0, 1000000};
+        nanosleep(&pause, NULL);
+#endif // if/else LINUX
+    }
+    return true;
+}  // end GPSReadBegin()
+
+// True if an update began during the copy (which is then retried)
+static inline bool GPSReadRetry(const GPSHeader* h, unsigned int seq)
+{
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);  // data copy completes before re-check
+    return (seq != __atomic_load_n(&h->sequence, __ATOMIC_RELAXED));
+}  // end GPSReadRetry()
+
+static unsigned int gps_publish_options = GPS_PUBLISH_PREFAULT;
+
+extern "C" void GPSSetPublishOptions(unsigned int options)
+{
+    gps_publish_options = options;
+}  // end GPSSetPublishOptions()
+
+// Makes the POSIX shared memory object "name" for "keyFile" (false if too
+// long, leaving room for the waiter counts' suffix)
+static bool GPSGetObjectName(const char* keyFile, char* name, unsigned int len)
+{
+    while ('/' == *keyFile) keyFile++;
+    if ((strlen(keyFile) + 2 + strlen(GPS_WAITERS_SUFFIX)) > len) 
+    {
+        fprintf(stderr, "GPSPub: keyFile name too long\n");
+        return false;
+    }
+    name[0] = '/';
+    for (unsigned int i = 0; ; i++)
+    {
+        name[i+1] = ('/' == keyFile[i]) ? '.' : keyFile[i];
+        if ('\0' == keyFile[i]) break;
+    }
+    return true;
+}  // end GPSGetObjectName()
+
+// Makes the waiter counts object's name from the segment's object "name"
+static inline void GPSGetWaitersName(const char* name, char* waitersName)
+{
+    strcpy(waitersName, name);
+    strcat(waitersName, GPS_WAITERS_SUFFIX);
+}  // end GPSGetWaitersName()
+
+// Returns the huge page size if "keyFile" (or, if it doesn't exist yet,
+// its directory) is on a hugetlbfs mount, or else zero
+static unsigned long GPSGetHugePageSize(const char* keyFile)
+{
+#ifdef LINUX
+    struct statfs fs;
+    if (0 != statfs(keyFile, &fs))
+    {
+        char dir[PATH_MAX];
+        strncpy(dir, keyFile, PATH_MAX - 1);
+        dir[PATH_MAX - 1] = '\0';
+        char* slash = strrchr(dir, '/');
+        if (NULL == slash) 
+            strcpy(dir, ".");
+        else if (slash == dir)
+            dir[1] = '\0';
+        else
+            *slash = '\0';
+        if (0 != statfs(dir, &fs)) return 0;
+    }
+    if (HUGETLBFS_MAGIC == (unsigned long)fs.f_type) return (unsigned long)fs.f_bsize;
+#endif // LINUX
+    return 0;
+}  // end GPSGetHugePageSize()
+
+// Maps "mapSize" bytes of segment "fd" (at a multiple of "pageSize", its
+// page size) and right after it the "waitersSize" bytes of its waiter
+// counts "waitersFd" (or, if negative, private memory standing in for
+// them), with their pages present, so the first accesses don't fault,
+// and locked in memory if "lock"
+static char* GPSMapSegment(int fd, unsigned int mapSize, unsigned long pageSize,
+                           int waitersFd, unsigned int waitersSize, bool writable, bool lock)
+{
+    int flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+    if (!writable || (0 != (gps_publish_options & GPS_PUBLISH_PREFAULT)))
+        flags |= MAP_POPULATE;
+#endif // MAP_POPULATE
+    // (address space for both is reserved first, aligned for the segment)
+    size_t reserveSize = (size_t)mapSize + waitersSize + pageSize;
+    void* reserve = mmap(NULL, reserveSize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (MAP_FAILED == reserve) return NULL;
+    char* ptr = (char*)(((unsigned long)reserve + pageSize - 1) / pageSize * pageSize);
+    bool mapped = (MAP_FAILED != mmap(ptr, mapSize, writable ? (PROT_READ | PROT_WRITE) : PROT_READ,
+                                      flags | MAP_FIXED, fd, 0));
+    if (mapped && (waitersFd >= 0))
+        mapped = (MAP_FAILED != mmap(ptr + mapSize, waitersSize, PROT_READ | PROT_WRITE,
+                                     flags | MAP_FIXED, waitersFd, 0));
+    else if (mapped)
+        mapped = (MAP_FAILED != mmap(ptr + mapSize, waitersSize, PROT_READ | PROT_WRITE,
+                                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0));
+    if (!mapped)
+    {
+        munmap(reserve, reserveSize);
+        return NULL;
+    }
+    // (and the rest of the reservation released)
+    char* end = ptr + mapSize + waitersSize;
+    if (ptr > (char*)reserve) munmap(reserve, ptr - (char*)reserve);
+    if (end < ((char*)reserve + reserveSize)) munmap(end, (char*)reserve + reserveSize - end);
+    if (lock && (0 != mlock(ptr, mapSize + waitersSize)))
+        perror("GPSPub: mlock() warning");
+    return ptr;
+}  // end GPSMapSegment()
+
+// Unmaps the segment (and its waiter counts) at "ptr"
+static inline int GPSUnmapSegment(char* ptr)
+{
+    const GPSHeader* h = (const GPSHeader*)ptr;
+    return munmap(ptr, h->map_size + GPSWaitersSize(h->slots ? h->slots : 1));
+}  // end GPSUnmapSegment()
+
+// Removes the segment's (and its waiter counts') name (existing mappings remain)
+static void GPSRemoveSegment(const char* keyFile, const char* name, bool hugetlb)
+{
+    if (hugetlb ? unlink(keyFile) : shm_unlink(name))
+        perror(hugetlb ? "GPSPub: unlink() error" : "GPSPub: shm_unlink() error");
+    char waitersName[NAME_MAX + 1];
+    GPSGetWaitersName(name, waitersName);
+    if (shm_unlink(waitersName) && (ENOENT != errno))
+        perror("GPSPub: shm_unlink() error");
+}  // end GPSRemoveSegment()
+
+// Marks this process as the segment's (live) publisher
+static void GPSSetPublisher(GPSHeader* h0)
+{
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    __atomic_store_n(&h0->start_token, (unsigned long long)now.tv_sec * 1000000 + now.tv_usec,
+                     __ATOMIC_RELAXED);
+    h0->heartbeat_timeout = GPS_HEARTBEAT_TIMEOUT;
+    __atomic_store_n(&h0->heartbeat, GPSHeartbeatClock(), __ATOMIC_RELAXED);
+    __atomic_store_n(&h0->pid, (int)getpid(), __ATOMIC_RELEASE);
+}  // end GPSSetPublisher()
+
 /**
  * Upon success, this returns a pointer for
  * storage of published GPS position
  */
 extern "C" char* GPSMemoryInit(const char* keyFile, unsigned int size)
+{
+    return GPSMemoryInitSlots(keyFile, size, 1);
+}  // end GPSMemoryInit()
+
+/**
+ * As GPSMemoryInit(), for a segment of "slots" publications of
+ * "size" bytes each (returns slot 0, see GPSGetSlot())
+ */
+extern "C" char* GPSMemoryInitSlots(const char* keyFile, unsigned int size, unsigned int slots)
 {
     if (!keyFile) keyFile = GPS_DEFAULT_KEY_FILE;
-    char* posPtr = ((char*)-1);
-    int id = -1;
-    
-    // First read file to see if shared memory already active
-    // If active, try to use it
-    FILE* filePtr = fopen(keyFile, "r");
+    if ((0 == slots) || (slots > GPS_MAX_SLOTS))
+    {
+        fprintf(stderr, "GPSPublishInit() error: invalid slot count %u\n", slots);
+        return NULL;
+    }
+    char name[NAME_MAX + 1];
+    if (!GPSGetObjectName(keyFile, name, NAME_MAX + 1)) return NULL;
+    char waitersName[NAME_MAX + 1];
+    GPSGetWaitersName(name, waitersName);
+    unsigned long hugePageSize = GPSGetHugePageSize(keyFile);
+    bool hugetlb = (0 != hugePageSize);
+    unsigned long pageSize = hugetlb ? hugePageSize : (unsigned long)sysconf(_SC_PAGESIZE);
+    unsigned int segmentSize = GPSSegmentSize(size, slots);
+    unsigned int mapSize = (unsigned int)((segmentSize + pageSize - 1) / pageSize * pageSize);
+    unsigned int waitersSize = GPSWaitersSize(slots);
+    bool lock = (0 != (gps_publish_options & GPS_PUBLISH_MLOCK));
+    char* posPtr = NULL;
     
-    if (filePtr)
+    // First see if the segment (and its waiter counts) already exists (e.g.
+    // the previous publisher died) and, if it's compatible, use it
+    int fd = hugetlb ? open(keyFile, O_RDWR) : shm_open(name, O_RDWR, 0);
+    if (fd >= 0)
     {
-        if (1 == fscanf(filePtr, "%d", &id))
+        struct stat st;
+        int waitersFd = shm_open(waitersName, O_RDWR, 0);
+        if ((waitersFd >= 0) && (0 == fstat(waitersFd, &st)) && (st.st_size == (off_t)waitersSize) &&
+            (0 == fstat(fd, &st)) && (st.st_size == (off_t)mapSize) &&
+            (NULL != (posPtr = GPSMapSegment(fd, mapSize, pageSize, waitersFd, waitersSize, true, lock))))
         {
-            if (((char*)-1) != (posPtr = (char*)shmat(id, 0, 0)))
+            // Make sure pre-existing shared memory is right version and size
+            GPSHeader* h = (GPSHeader*)posPtr;
+            unsigned int oldSlots = h->slots ? h->slots : 1;
+            if ((GPS_PUB_VERSION != h->version) || (size != h->size) || (slots != oldSlots) ||
+                (mapSize != h->map_size))
             {
-                // Make sure pre-existing shared memory is right size
-                unsigned int theSize;
-                memcpy(&theSize, posPtr, sizeof(unsigned int));
-                if (size != theSize)
-                {
-                    GPSPublishShutdown((GPSHandle)posPtr, keyFile);
-                    posPtr = (char*)-1;   
-                }
+                munmap(posPtr, mapSize + waitersSize);
+                posPtr = NULL;
             }
             else
             {
-               perror("GPSPublishInit(): shmat() warning");       
+                // (in case a previous publisher died mid-update)
+                for (unsigned int i = 0; i < slots; i++)
+                {
+                    GPSHeader* sh = (GPSHeader*)(posPtr + i*GPSSlotStride(size));
+                    sh->options = (gps_publish_options & ~GPS_SEGMENT_HUGETLB) | 
+                                  (hugetlb ? GPS_SEGMENT_HUGETLB : 0);
+                    if (0 != (sh->sequence & 1)) sh->sequence++;
+                }
+                GPSSetPublisher((GPSHeader*)posPtr);
             }
         }
-        fclose(filePtr);
+        close(fd);
+        if (waitersFd >= 0) close(waitersFd);
+        // (an incompatible segment is replaced, though its subscribers keep it)
+        if (NULL == posPtr) GPSRemoveSegment(keyFile, name, hugetlb);
     }
     
-    if (((char*)-1) == posPtr)
+    if (NULL == posPtr)
     {
-        // Create new shared memory segment
-        // and advertise its "id" in the keyFile
-        id = shmget(0, (int)(size+sizeof(unsigned int)), IPC_CREAT | 
-                    SHM_R| S_IRGRP | S_IROTH | SHM_W);
-        if (-1 == id)
+        // Create the waiter counts, writable by all, first (so subscribers
+        // finding the segment find them too), replacing any left without
+        // a segment
+        if ((0 != shm_unlink(waitersName)) && (ENOENT != errno))
+            perror("GPSPublishInit(): shm_unlink() warning");
+        int waitersFd = shm_open(waitersName, O_RDWR | O_CREAT | O_EXCL, 0666);
+        if (waitersFd < 0)
         {
-            perror("GPSPublishInit(): shmget() error");
+            perror("GPSPublishInit(): shm_open() error");
             return NULL;
         }
-        if (((char*)-1) ==(posPtr = (char*)shmat(id, 0, 0)))
+        if (0 != fchmod(waitersFd, 0666))  // (regardless of umask)
+            perror("GPSPublishInit(): fchmod() warning");
+        // Create new shared memory segment, readable by all
+        if (hugetlb)
+            fd = open(keyFile, O_RDWR | O_CREAT | O_EXCL, 0644);
+        else
+            fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+        if (fd < 0)
         {
-            perror("GPSPublishInit(): shmat() error");
-            struct shmid_ds ds;
-            if (-1 == shmctl(id, IPC_RMID, &ds))
-            {  
-                perror("GPSPublishInit(): shmctl(IPC_RMID) error");
-            }
+            perror(hugetlb ? "GPSPublishInit(): open() error" : "GPSPublishInit(): shm_open() error");
+            close(waitersFd);
+            shm_unlink(waitersName);
             return NULL;
         }
-        // Write "id" to "keyFile"
-        if ((filePtr = fopen(keyFile, "w+")))
+        if (0 != fchmod(fd, 0644))  // (regardless of umask)
+            perror("GPSPublishInit(): fchmod() warning");
+        if ((0 != ftruncate(waitersFd, waitersSize)) || (0 != ftruncate(fd, mapSize)) ||
+            (NULL == (posPtr = GPSMapSegment(fd, mapSize, pageSize, waitersFd, waitersSize, true, lock))))
         {
-            if (fprintf(filePtr, "%d", id) <= 0)
-                perror("GPSPublishInit() fprintf() error");
-            fclose(filePtr);
-            memset(posPtr+sizeof(unsigned int), 0, size);
-            memcpy(posPtr, &size, sizeof(unsigned int));
-            return (posPtr + sizeof(unsigned int));
+            perror("GPSPublishInit(): ftruncate()/mmap() error");
+            close(fd);
+            close(waitersFd);
+            GPSRemoveSegment(keyFile, name, hugetlb);
+            return NULL;
         }
-        else
+        close(fd);
+        close(waitersFd);
+        memset(posPtr, 0, segmentSize);
+        for (unsigned int i = 0; i < slots; i++)
         {
-            perror("GPSPublishInit() fopen() error");
+            GPSHeader* h = (GPSHeader*)(posPtr + i*GPSSlotStride(size));
+            h->size = size;
+            h->sequence = 0;
+            h->map_size = mapSize;
+            h->options = (gps_publish_options & ~GPS_SEGMENT_HUGETLB) | 
+                         (hugetlb ? GPS_SEGMENT_HUGETLB : 0);
+            h->slot = i;
+            h->slots = slots;
+            __atomic_store_n(&h->version, GPS_PUB_VERSION, __ATOMIC_RELEASE);
         }
-        if (-1 == shmdt(posPtr)) 
-            perror("GPSPublishInit() shmdt() error");
-        struct shmid_ds ds;
-        if (-1 == shmctl(id, IPC_RMID, &ds))
-            perror("GPSPublishInit(): shmctl(IPC_RMID) error");
-        return NULL;
+        GPSSetPublisher((GPSHeader*)posPtr);
     }
-      
-    if (((char*)-1) == posPtr) 
-        return NULL;
-    else
-        return (posPtr + sizeof(unsigned int));
-}  // end GPSPublishInit()
+    return (posPtr + sizeof(GPSHeader));
+}  // end GPSMemoryInitSlots()
 
 extern "C" void GPSPublishShutdown(GPSHandle gpsHandle, const char* keyFile)
 {
-    char* ptr = (char*)gpsHandle - sizeof(unsigned int);
+    char* ptr = GPSGetSegment(gpsHandle);
     if (!keyFile) keyFile = GPS_DEFAULT_KEY_FILE;
-    if (-1 == shmdt(ptr)) 
-        perror("GPSPublishShutdown() shmdt() error");
-    FILE* filePtr = fopen(keyFile, "r");
-    if (filePtr)
-    {
-        int id;
-        if (1 == fscanf(filePtr, "%d", &id))
-        {
-            struct shmid_ds ds;
-            if (-1 == shmctl(id, IPC_RMID, &ds))
-                perror("GPSPublishShutdown(): shmctl(IPC_RMID) error");
-        }
-        fclose(filePtr);
-        if (unlink(keyFile)) 
-            perror("GPSPublishShutdown(): unlink() error");
-    }
-    else
-    {
-        perror("GPSPublishShutdown(): fopen() error");
-    }   
+    GPSHeader* h = (GPSHeader*)ptr;
+    bool hugetlb = (0 != (h->options & GPS_SEGMENT_HUGETLB));
+    __atomic_store_n(&h->pid, 0, __ATOMIC_RELEASE);  // (subscriptions no longer valid)
+    if (-1 == GPSUnmapSegment(ptr)) 
+        perror("GPSPublishShutdown() munmap() error");
+    char name[NAME_MAX + 1];
+    if (GPSGetObjectName(keyFile, name, NAME_MAX + 1))
+        GPSRemoveSegment(keyFile, name, hugetlb);
 }  // end GPSPublishShutdown();
 
 
@@ -129,50 +555,134 @@ extern "C" void GPSPublishShutdown(GPSHandle gpsHandle, const char* keyFile)
  */
 extern "C" GPSHandle GPSSubscribe(const char* keyFile)
 {
-   if (!keyFile) keyFile = GPS_DEFAULT_KEY_FILE;
-    char* posPtr = ((char*)-1);
-    int id = -1;
-    // First read file to see if shared memory already active
-    // If active, try to use it
-    FILE* filePtr = fopen(keyFile, "r");
-    if (filePtr)
+    if (!keyFile) keyFile = GPS_DEFAULT_KEY_FILE;
+    char name[NAME_MAX + 1];
+    if (!GPSGetObjectName(keyFile, name, NAME_MAX + 1)) return NULL;
+    unsigned long pageSize = (unsigned long)sysconf(_SC_PAGESIZE);
+    unsigned long hugePageSize = 0;
+    int fd = shm_open(name, O_RDONLY, 0);
+    if ((fd < 0) && (ENOENT == errno) && (0 != (hugePageSize = GPSGetHugePageSize(keyFile))))
     {
-        if (1 == fscanf(filePtr, "%d", &id))
-        {
-            if (((char*)-1) == (posPtr = (char*)shmat(id, 0, SHM_RDONLY)))
-            {
-               perror("GPSSubscribe(): shmat() error"); 
-               fclose(filePtr);
-               return NULL;      
-            }
-            else
-            {
-                fclose(filePtr);
-                return (posPtr + sizeof(unsigned int));   
-            }
-        }
-        else
-        {
-            perror("GPSSubscribe(): fscanf() error");  
-            fclose(filePtr);
-            return NULL; 
-        }
+        fd = open(keyFile, O_RDONLY);  // (a hugetlbfs segment)
+        pageSize = hugePageSize;
     }
-    else
+    if (fd < 0)
     {
-        //fprintf(stderr, "GPSSubscribe(): Error opening %s.\n", keyFile);
-        perror("GPSSubscribe(): fopen() error"); 
+        perror("GPSSubscribe(): shm_open() error"); 
         return NULL;      
     }
+    // (the header, read first, gives the size of the waiter counts)
+    struct stat st;
+    GPSHeader header;
+    if ((0 != fstat(fd, &st)) || 
+        ((ssize_t)sizeof(header) != pread(fd, &header, sizeof(header), 0)))
+    {
+        perror("GPSSubscribe(): read() error");
+        close(fd);
+        return NULL;
+    }
+    if ((GPS_PUB_VERSION != header.version) || (header.map_size != (unsigned int)st.st_size))
+    {
+        fprintf(stderr, "GPSSubscribe(): incompatible shared memory version\n");
+        close(fd);
+        return NULL;
+    }
+    // Without writable waiter counts, this process' waits can't be woken
+    unsigned int waitersSize = GPSWaitersSize(header.slots ? header.slots : 1);
+    char waitersName[NAME_MAX + 1];
+    GPSGetWaitersName(name, waitersName);
+    int waitersFd = shm_open(waitersName, O_RDWR, 0);
+    struct stat waitersSt;
+    if ((waitersFd >= 0) && 
+        ((0 != fstat(waitersFd, &waitersSt)) || (waitersSt.st_size != (off_t)waitersSize)))
+    {
+        close(waitersFd);
+        waitersFd = -1;
+        errno = EINVAL;
+    }
+    if (waitersFd < 0)
+    {
+        fprintf(stderr, "GPSSubscribe() warning: no waiter counts \"%s\" (%s), "
+                        "GPSWaitForUpdate() polls\n", waitersName, strerror(errno));
+        gps_wait_polls = true;
+    }
+    char* posPtr = GPSMapSegment(fd, (unsigned int)st.st_size, pageSize, 
+                                 waitersFd, waitersSize, false, false);
+    if (NULL == posPtr)
+    {
+        perror("GPSSubscribe(): mmap() error");
+        close(fd);
+        if (waitersFd >= 0) close(waitersFd);
+        return NULL;
+    }
+    close(fd);
+    if (waitersFd >= 0) close(waitersFd);
+    const GPSHeader* h = (const GPSHeader*)posPtr;
+    if ((GPS_PUB_VERSION != __atomic_load_n(&h->version, __ATOMIC_ACQUIRE)) ||
+        (h->map_size != (unsigned int)st.st_size))
+    {
+        fprintf(stderr, "GPSSubscribe(): incompatible shared memory version\n");
+        munmap(posPtr, st.st_size + waitersSize);
+        return NULL;
+    }
+    // (real-time subscribers of a locked publication are locked, too)
+    if ((0 != (h->options & GPS_PUBLISH_MLOCK)) && (0 != mlock(posPtr, h->map_size + waitersSize)))
+        perror("GPSSubscribe(): mlock() warning");
+    return (posPtr + sizeof(GPSHeader));
 }  // end GPSSubscribe()
 
+extern "C" GPSHandle GPSSubscribeSlot(const char* keyFile, unsigned int slot)
+{
+    GPSHandle gpsHandle = GPSSubscribe(keyFile);
+    if (!gpsHandle) return NULL;
+    GPSHandle slotHandle = GPSGetSlot(gpsHandle, slot);
+    if (!slotHandle)
+    {
+        fprintf(stderr, "GPSSubscribeSlot(): no slot %u (publication has %u)\n",
+                        slot, GPSGetSlotCount(gpsHandle));
+        GPSUnsubscribe(gpsHandle);
+    }
+    return slotHandle;
+}  // end GPSSubscribeSlot()
+
+extern "C" unsigned int GPSGetSlotCount(GPSHandle gpsHandle)
+{
+    unsigned int slots = GPSGetHeader(gpsHandle)->slots;
+    return slots ? slots : 1;
+}  // end GPSGetSlotCount()
+
+extern "C" GPSHandle GPSGetSlot(GPSHandle gpsHandle, unsigned int slot)
+{
+    if (slot >= GPSGetSlotCount(gpsHandle)) return NULL;
+    unsigned int stride = GPSSlotStride(GPSGetHeader(gpsHandle)->size);
+    return (GPSHandle)(GPSGetSegment(gpsHandle) + slot*stride + sizeof(GPSHeader));
+}  // end GPSGetSlot()
+
 extern "C" void GPSUnsubscribe(GPSHandle gpsHandle)
 {
-    char* ptr = (char*)gpsHandle - sizeof(unsigned int);
-    if (-1 == shmdt(ptr)) 
-        perror("GPSUnsubscribe() shmdt() error");
+    if (-1 == GPSUnmapSegment(GPSGetSegment(gpsHandle))) 
+        perror("GPSUnsubscribe() munmap() error");
 }  // end GPSUnsubscribe()
 
+extern "C" void GPSPublishHeartbeat(GPSHandle gpsHandle)
+{
+    GPSHeader* h0 = (GPSHeader*)GPSGetSegment(gpsHandle);
+    __atomic_store_n(&h0->heartbeat, GPSHeartbeatClock(), __ATOMIC_RELEASE);
+}  // end GPSPublishHeartbeat()
+
+extern "C" int GPSSubscriptionIsValid(GPSHandle gpsHandle)
+{
+    return GPSPublisherIsLive((const GPSHeader*)GPSGetSegment(gpsHandle));
+}  // end GPSSubscriptionIsValid()
+
+extern "C" int GPSGetPublisher(GPSHandle gpsHandle, unsigned long long* startToken)
+{
+    const GPSHeader* h0 = (const GPSHeader*)GPSGetSegment(gpsHandle);
+    int pid = __atomic_load_n(&h0->pid, __ATOMIC_ACQUIRE);
+    if (startToken) *startToken = __atomic_load_n(&h0->start_token, __ATOMIC_RELAXED);
+    return pid;
+}  // end GPSGetPublisher()
+
 extern "C" void GPSPublishPos(GPSHandle gpsHandle, double x, double y, double z)
 {
   GPSPosition pos;
@@ -190,27 +700,211 @@ extern "C" void GPSPublishPos(GPSHandle gpsHandle, double x, double y, double z)
   memcpy(&pos.gps_time, &time, sizeof(struct timeval));
   memcpy(&pos.sys_time, &time, sizeof(struct timeval));
   
-  memcpy((char*)gpsHandle, &pos, sizeof(GPSPosition));   
+  GPSPublishUpdate(gpsHandle, &pos);
 }
 
+// Writes both records (and the history) within one sequence lock update
+static void GPSWriteUpdate(GPSHandle gpsHandle, const GPSPosition* position,
+                           const GPSPositionV2* positionV2)
+{
+    GPSHeader* h = GPSGetHeader(gpsHandle);
+    GPSHistory* history = GPSGetHistory(gpsHandle);
+    GPSPositionV2* publishedV2 = GPSGetPositionV2(gpsHandle);
+    GPSWriteBegin(h);
+    memcpy((char*)gpsHandle, (char*)position, sizeof(GPSPosition));   
+    if (history && !position->stale)
+    {
+        if (0 == history->depth) history->depth = GPS_HISTORY_DEPTH;  // (new segment)
+        unsigned int index = history->count % history->depth;
+        memcpy(&history->fix[index], position, sizeof(GPSPosition));
+        history->count++;
+    }
+    if (publishedV2) memcpy(publishedV2, positionV2, sizeof(GPSPositionV2));
+    GPSWriteEnd(h);
+}  // end GPSWriteUpdate()
+
 extern "C" void GPSPublishUpdate(GPSHandle gpsHandle, const GPSPosition* currentPosition)
 {
   //  fprintf(stderr, "GPSPublishUpdate %f,%f\n",currentPosition->x,currentPosition->y);
-
-    memcpy((char*)gpsHandle, (char*)currentPosition, sizeof(GPSPosition));   
+    GPSPositionV2 positionV2;
+    GPSPositionToV2(currentPosition, &positionV2);
+    GPSWriteUpdate(gpsHandle, currentPosition, &positionV2);
 }  // end GPSPublishUpdate()
 
-extern "C" void GPSGetCurrentPosition(GPSHandle gpsHandle, GPSPosition* currentPosition)
+extern "C" void GPSPublishUpdateV2(GPSHandle gpsHandle, const GPSPositionV2* currentPosition)
+{
+    GPSPosition position;
+    GPSPositionFromV2(currentPosition, &position);
+    GPSWriteUpdate(gpsHandle, &position, currentPosition);
+}  // end GPSPublishUpdateV2()
+
+extern "C" int GPSGetCurrentPosition(GPSHandle gpsHandle, GPSPosition* currentPosition)
 {
-    memcpy((char*)currentPosition, (char*)gpsHandle, sizeof(GPSPosition));
+    const GPSHeader* h = GPSGetHeader(gpsHandle);
+    unsigned int seq;
+    do
+    {
+        if (!GPSReadBegin(h, seq))
+        {
+            memset(currentPosition, 0, sizeof(GPSPosition));
+            currentPosition->stale = true;
+            return false;
+        }
+        memcpy((char*)currentPosition, (char*)gpsHandle, sizeof(GPSPosition));
+    } while (GPSReadRetry(h, seq));
+    return true;
 }  // end GPSGetCurrentPosition()
 
+extern "C" int GPSGetCurrentPositionV2(GPSHandle gpsHandle, GPSPositionV2* currentPosition)
+{
+    const GPSPositionV2* publishedV2 = GPSGetPositionV2(gpsHandle);
+    if (publishedV2)
+    {
+        const GPSHeader* h = GPSGetHeader(gpsHandle);
+        unsigned int seq;
+        do
+        {
+            if (!GPSReadBegin(h, seq))
+            {
+                memset(currentPosition, 0, sizeof(GPSPositionV2));
+                currentPosition->version = GPS_POSITION_V2;
+                currentPosition->size = sizeof(GPSPositionV2);
+                currentPosition->stale = true;
+                return false;
+            }
+            memcpy(currentPosition, publishedV2, sizeof(GPSPositionV2));
+        } while (GPSReadRetry(h, seq));
+        // (a later version is trusted up to the fields this one knows)
+        if (currentPosition->version >= GPS_POSITION_V2)
+        {
+            currentPosition->version = GPS_POSITION_V2;
+            currentPosition->size = sizeof(GPSPositionV2);
+            return true;
+        }
+    }
+    GPSPosition position;
+    GPSGetCurrentPosition(gpsHandle, &position);
+    GPSPositionToV2(&position, currentPosition);
+    return false;
+}  // end GPSGetCurrentPositionV2()
+
+extern "C" unsigned int GPSGetFixCount(GPSHandle gpsHandle)
+{
+    const GPSHistory* history = GPSGetHistory(gpsHandle);
+    if (!history) return 0;
+    return __atomic_load_n(&history->count, __ATOMIC_ACQUIRE);
+}  // end GPSGetFixCount()
+
+extern "C" unsigned int GPSGetFixHistory(GPSHandle gpsHandle, unsigned int* nextFix,
+                                         GPSPosition* fixes, unsigned int maxFixes,
+                                         unsigned int* lost)
+{
+    const GPSHeader* h = GPSGetHeader(gpsHandle);
+    const GPSHistory* history = GPSGetHistory(gpsHandle);
+    unsigned int copied, skipped, next;
+    unsigned int seq;
+    do
+    {
+        if (!GPSReadBegin(h, seq))
+        {
+            if (lost) *lost = 0;
+            return 0;
+        }
+        copied = skipped = 0;
+        next = *nextFix;
+        if (!history) break;
+        unsigned int count = history->count;
+        unsigned int depth = history->depth;
+        if ((0 == depth) || (depth > GPS_HISTORY_DEPTH)) break;  // (no fixes yet)
+        unsigned int available = count - next;  // (unsigned, so wrap-safe)
+        if (available > count) available = 0;   // (cursor is ahead of publisher)
+        if (available > depth)
+        {
+            skipped = available - depth;
+            next += skipped;
+            available = depth;
+        }
+        if (available > maxFixes) available = maxFixes;
+        for (copied = 0; copied < available; copied++)
+            memcpy(&fixes[copied], &history->fix[(next + copied) % depth], sizeof(GPSPosition));
+    } while (GPSReadRetry(h, seq));
+    *nextFix = next + copied;
+    if (lost) *lost = skipped;
+    return copied;
+}  // end GPSGetFixHistory()
+
+extern "C" unsigned int GPSGetSequence(GPSHandle gpsHandle)
+{
+    const GPSHeader* h = GPSGetHeader(gpsHandle);
+    return (__atomic_load_n(&h->sequence, __ATOMIC_ACQUIRE) & ~1U);
+}  // end GPSGetSequence()
+
+extern "C" unsigned int GPSWaitForUpdate(GPSHandle gpsHandle, unsigned int lastSequence, int timeout)
+{
+    const GPSHeader* h = GPSGetHeader(gpsHandle);
+    struct timespec now, deadline;
+    if (timeout >= 0)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += timeout / 1000;
+        deadline.tv_nsec += (long)(timeout % 1000) * 1000000;
+        if (deadline.tv_nsec >= 1000000000)
+        {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+    }
+    while (true)
+    {
+        unsigned int seq = __atomic_load_n(&h->sequence, __ATOMIC_ACQUIRE);
+        if ((0 == (seq & 1)) && (seq != lastSequence)) return seq;
+        struct timespec remaining;
+        if (timeout >= 0)
+        {
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            remaining.tv_sec = deadline.tv_sec - now.tv_sec;
+            remaining.tv_nsec = deadline.tv_nsec - now.tv_nsec;
+            if (remaining.tv_nsec < 0)
+            {
+                remaining.tv_sec--;
+                remaining.tv_nsec += 1000000000;
+            }
+            if (remaining.tv_sec < 0) return lastSequence;  // timed out
+        }
+#ifdef LINUX
+        // Sleeps only if "sequence" still equals "seq" (shared, not private,
+        // futex), a msec at a time if this process can't be woken, and
+        // otherwise no longer than a heartbeat interval (in case the waiter
+        // counts were tampered with)
+        struct timespec limit = {0, 1000000};
+        if (!gps_wait_polls)
+        {
+            limit.tv_sec = GPS_HEARTBEAT_INTERVAL / 1000;
+            limit.tv_nsec = (long)(GPS_HEARTBEAT_INTERVAL % 1000) * 1000000;
+        }
+        if ((timeout < 0) || (remaining.tv_sec > limit.tv_sec) ||
+            ((remaining.tv_sec == limit.tv_sec) && (remaining.tv_nsec > limit.tv_nsec)))
+            remaining = limit;
+        int error = GPSFutexWait(h, seq, &remaining);
+        if ((0 != error) && (EAGAIN != error) && (EINTR != error) && (ETIMEDOUT != error))
+        {
+            errno = error;
+            perror("GPSWaitForUpdate(): futex() error");
+            return lastSequence;
+        }
+#else
+        // (TBD) use a blocking primitive on non-Linux systems
+        struct timespec pause = {0, 1000000};
+        nanosleep(&pause, NULL);
+#endif // if/else LINUX
+    }
+}  // end GPSWaitForUpdate()
+
 extern "C" unsigned int GPSSetMemory(GPSHandle gpsHandle, unsigned int offset, 
                             const char* buffer, unsigned int len)
 {
-    char* ptr = (char*)gpsHandle - sizeof(unsigned int);
-    unsigned int size;
-    memcpy(&size, ptr, sizeof(unsigned int));
+    GPSHeader* h = GPSGetHeader(gpsHandle);
+    unsigned int size = h->size;
     
     // Make sure request fits into available shared memory
     if ((offset+len) > size)
@@ -222,25 +916,22 @@ extern "C" unsigned int GPSSetMemory(GPSHandle gpsHandle, unsigned int offset,
         else
             len -= delta;        
     }
-    ptr = (char*)gpsHandle + offset;
+    char* ptr = (char*)gpsHandle + offset;
+    GPSWriteBegin(h);
     memcpy(ptr, buffer, len);
+    GPSWriteEnd(h);
     return len;
 }  // end GPSSetMemory()
 
 extern "C" unsigned int GPSGetMemorySize(GPSHandle gpsHandle)
 {
-    char* ptr = (char*)gpsHandle - sizeof(unsigned int);
-    unsigned int size;
-    memcpy(&size, ptr, sizeof(unsigned int));
-    return size;   
+    return GPSGetHeader(gpsHandle)->size;   
 }
 
 extern "C" const char* GPSGetMemoryPtr(GPSHandle       gpsHandle, 
                                        unsigned int    offset)
 {
-    char* ptr = (char*)gpsHandle - sizeof(unsigned int);
-    unsigned int size;
-    memcpy(&size, ptr, sizeof(unsigned int));
+    unsigned int size = GPSGetHeader(gpsHandle)->size;
     if (offset < size)
     {
         return (char*)gpsHandle + offset;
@@ -255,9 +946,8 @@ extern "C" const char* GPSGetMemoryPtr(GPSHandle       gpsHandle,
 extern "C" unsigned int GPSGetMemory(GPSHandle gpsHandle, unsigned int offset, 
                                      char* buffer, unsigned int len)
 {
-    char* ptr = (char*)gpsHandle - sizeof(unsigned int);
-    unsigned int size;
-    memcpy(&size, ptr, sizeof(unsigned int));
+    const GPSHeader* h = GPSGetHeader(gpsHandle);
+    unsigned int size = h->size;
     if (size < (offset+len))
     {
         unsigned int delta = offset + len - size;
@@ -271,7 +961,12 @@ extern "C" unsigned int GPSGetMemory(GPSHandle gpsHandle, unsigned int offset,
             len -= delta;
         }   
     }
-    ptr = (char*)gpsHandle + offset;
-    memcpy(buffer, ptr, len);
+    const char* ptr = (char*)gpsHandle + offset;
+    unsigned int seq;
+    do
+    {
+        if (!GPSReadBegin(h, seq)) return 0;
+        memcpy(buffer, ptr, len);
+    } while (GPSReadRetry(h, seq));
     return len;
 }  // end GPSGetMemory()
@@ -27,18 +27,153 @@ typedef struct GPSPosition
     int			    stale;
 } GPSPosition;
 
+// The extended ("v2") position record adds the velocity and fix quality
+// fields of GPRMC/GPGGA.  It is published alongside the GPSPosition (after
+// the fix history, so the original layout is unchanged and older
+// subscribers keep working), cache-line aligned in shared memory.
+// Subscribers check "version" and "size" before trusting the layout
+// (later versions only append fields), and "valid" (GPS_VALID_* flags)
+// tells which fields were given by the receiver.
+#define GPS_POSITION_V2 2
 
+#define GPS_VALID_XY            0x0001
+#define GPS_VALID_Z             0x0002
+#define GPS_VALID_TIME          0x0004  // time _and_ date was given in NMEA
+#define GPS_VALID_SPEED         0x0008
+#define GPS_VALID_HEADING       0x0010
+#define GPS_VALID_HDOP          0x0020
+#define GPS_VALID_SATELLITES    0x0040
+#define GPS_VALID_QUALITY       0x0080
+
+typedef struct GPSPositionV2
+{
+    unsigned int    version;    // GPS_POSITION_V2
+    unsigned int    size;       // sizeof(GPSPositionV2)
+    unsigned int    valid;      // GPS_VALID_* flags
+    int             stale;
+    double          x;          // longitude (degrees)
+    double          y;          // latitude (degrees)
+    double          z;          // altitude (meters)
+    struct timeval  gps_time;   // gps time of GPS position fix
+    struct timeval  sys_time;   // system time of GPS position fix
+    double          speed;      // speed over ground (meters/sec)
+    double          heading;    // course over ground (degrees true)
+    double          hdop;       // horizontal dilution of precision
+    unsigned int    satellites; // number of satellites used in fix
+    unsigned int    quality;    // GPGGA fix quality (1 = GPS, 2 = DGPS, 4 = RTK, ...)
+} __attribute__((aligned(64))) GPSPositionV2;
+
+// Conversions between the two records (GPSPositionToV2() leaves the
+// extended fields invalid)
+void GPSPositionToV2(const GPSPosition* position, GPSPositionV2* positionV2);
+void GPSPositionFromV2(const GPSPositionV2* positionV2, GPSPosition* position);
+
+
+// The published GPSPosition is followed in shared memory by a ring
+// of the most recent fixes so that subscribers can catch up on every
+// fix published since they last looked (see GPSGetFixHistory())
+#ifndef GPS_HISTORY_DEPTH
+#define GPS_HISTORY_DEPTH 64
+#endif // !GPS_HISTORY_DEPTH
+
+typedef struct GPSHistory
+{
+    unsigned int    count;      // total fixes published (number of next fix)
+    unsigned int    depth;      // number of "fix" entries in ring
+    GPSPosition     fix[GPS_HISTORY_DEPTH];  // (fix number "n" at "n % depth")
+} GPSHistory;
+
+// The "keyFile" (default "/tmp/gpskey") names the publication's POSIX
+// shared memory object (the path with '/' as '.', e.g. "/tmp.gpskey"),
+// or if it is on a hugetlbfs mount (e.g. "/dev/hugepages/gpskey"), it
+// is the (huge page backed) segment itself.  Subscribers map their
+// segment with its pages present, so their first read doesn't fault.
 char* GPSMemoryInit(const char* keyFile, unsigned int size);
+char* GPSMemoryInitSlots(const char* keyFile, unsigned int size, unsigned int slots);
+
+// Publication options (for GPSPublishInit() calls that follow):
+// GPS_PUBLISH_PREFAULT (the default) maps the segment with its pages
+// present, and GPS_PUBLISH_MLOCK locks them in memory (as subscribers
+// of the publication then do, where permitted).
+#define GPS_PUBLISH_PREFAULT    0x0001
+#define GPS_PUBLISH_MLOCK       0x0002
+void GPSSetPublishOptions(unsigned int options);
+
+// Size of the position publication (GPSPosition, GPSHistory, GPSPositionV2)
+unsigned int GPSGetPublishSize();
 
 inline GPSHandle GPSPublishInit(const char* keyFile)
-    {return (GPSHandle)GPSMemoryInit(keyFile, sizeof(GPSPosition));}
+    {return (GPSHandle)GPSMemoryInit(keyFile, GPSGetPublishSize());}
+// Multiple publications ("slots", e.g. one per GPS receiver) can share
+// one segment (and keyFile).  The handle returned is slot 0, and 
+// GPSGetSlot() gives the handle of any other slot.  Each slot is a 
+// complete publication (any function taking a GPSHandle can be used 
+// with it), and any slot's handle may be passed to GPSPublishShutdown()
+// or GPSUnsubscribe().
+inline GPSHandle GPSPublishInitSlots(const char* keyFile, unsigned int slots)
+    {return (GPSHandle)GPSMemoryInitSlots(keyFile, GPSGetPublishSize(), slots);}
+unsigned int GPSGetSlotCount(GPSHandle gpsHandle);
+// Returns NULL if there is no such "slot"
+GPSHandle GPSGetSlot(GPSHandle gpsHandle, unsigned int slot);
+// Updates are sequence-locked:  the publisher never blocks, and
+// GPSGetCurrentPosition() retries (without locking) until it gets
+// a consistent (untorn) copy of the published position, however long a
+// (live) publisher takes to finish an update in progress
+// (either update function publishes both the GPSPosition and the
+// GPSPositionV2, with the one not given converted from the other)
 void GPSPublishUpdate(GPSHandle gpsHandle, const GPSPosition* currentPosition);
+void GPSPublishUpdateV2(GPSHandle gpsHandle, const GPSPositionV2* currentPosition);
 void GPSPublishShutdown(GPSHandle gpsHandle, const char* keyFile);
 
+// Publisher liveness:  the publisher beats a heartbeat with each update
+// and, when idle, at least every GPS_HEARTBEAT_INTERVAL msec using
+// GPSPublishHeartbeat().  GPSSubscriptionIsValid() is true while the
+// publisher is running (i.e. hasn't shut down, and has beaten within
+// GPS_HEARTBEAT_TIMEOUT msec) and costs a few memory loads (and a vDSO 
+// clock read, no syscall), so it may be polled at high rates.  A dead
+// publisher's subscriptions become valid again if a new one takes over
+// its segment (as a restarted publisher does), with a new "startToken"
+// (see GPSGetPublisher(), which returns the publisher's PID, 0 once it
+// has shut down).
+#define GPS_HEARTBEAT_INTERVAL  1000
+#define GPS_HEARTBEAT_TIMEOUT   (3*GPS_HEARTBEAT_INTERVAL)
+void GPSPublishHeartbeat(GPSHandle gpsHandle);
+int GPSSubscriptionIsValid(GPSHandle gpsHandle);
+int GPSGetPublisher(GPSHandle gpsHandle, unsigned long long* startToken);
+
 GPSHandle GPSSubscribe(const char* keyFile);
-void GPSGetCurrentPosition(GPSHandle gpsHandle, GPSPosition* currentPosition);
+GPSHandle GPSSubscribeSlot(const char* keyFile, unsigned int slot);
+// The reads below (and GPSGetMemory()) only fail if the publisher died
+// in the middle of an update (see GPSSubscriptionIsValid()), as the data
+// is then torn:  GPSGetCurrentPosition() returns false with
+// "currentPosition" invalid and stale, GPSGetFixHistory() and
+// GPSGetMemory() return zero.
+int GPSGetCurrentPosition(GPSHandle gpsHandle, GPSPosition* currentPosition);
+// Returns false (with "currentPosition" converted from the GPSPosition)
+// if the publisher doesn't publish a GPSPositionV2 (e.g. an older one),
+// or (with it invalid and stale) upon failure as above
+int GPSGetCurrentPositionV2(GPSHandle gpsHandle, GPSPositionV2* currentPosition);
 void GPSUnsubscribe(GPSHandle gpsHandle);
 
+// Fix history:  "*nextFix" is the subscriber's cursor (the number of the
+// next fix it wants, e.g. from GPSGetFixCount()).  Copies up to "maxFixes"
+// fixes from "*nextFix" on (oldest first) and advances the cursor past them.
+// If the oldest wanted fixes were already overwritten in the ring, their
+// count is returned in "*lost" (if non-NULL) and the copy starts with the
+// oldest fix still available.  Returns the number of fixes copied.
+// (Note only non-stale updates are recorded as fixes)
+unsigned int GPSGetFixCount(GPSHandle gpsHandle);
+unsigned int GPSGetFixHistory(GPSHandle gpsHandle, unsigned int* nextFix,
+                              GPSPosition* fixes, unsigned int maxFixes, 
+                              unsigned int* lost);
+
+// Returns the current update sequence number of the publication
+unsigned int GPSGetSequence(GPSHandle gpsHandle);
+// Blocks (without polling) until an update newer than "lastSequence" is
+// published or "timeout" msec elapse (a negative "timeout" waits forever).
+// Returns the new sequence number, or "lastSequence" upon timeout.
+unsigned int GPSWaitForUpdate(GPSHandle gpsHandle, unsigned int lastSequence, int timeout);
+
 // Generic data publishing
 unsigned int GPSSetMemory(GPSHandle gpsHandle, unsigned int offset, 
                           const char* buffer, unsigned int len);
@@ -0,0 +1,403 @@
+
+#include "gpsReceiver.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#ifdef LINUX
+#include <sys/epoll.h>
+#endif // LINUX
+
+GPSReceiver::GPSReceiver()
+ : device_name(""), is_serial(false), device_baud(0), reconnectable(false), have_attr(false),
+   lost(false), reconnect_count(0), input_fd(-1), gps_handle(NULL), log_writer(NULL), log_device(0),
+   debug(false), gps_stats(NULL), sentence_count(0), fix_count(0), error_count(0)
+{
+    lost_time.tv_sec = lost_time.tv_usec = 0;
+    reconnect_time = lost_time;
+    memset(&p, 0, sizeof(GPSPositionV2));
+    p.version = GPS_POSITION_V2;
+    p.size = sizeof(GPSPositionV2);
+    p.stale = true;
+}
+
+GPSReceiver::~GPSReceiver()
+{
+    Close();
+}
+
+bool GPSReceiver::Open(const char* device, bool isSerialDevice, unsigned int baud)
+{
+    Close();
+    device_name = device;
+    is_serial = isSerialDevice;
+    device_baud = baud;
+    have_attr = false;
+    lost = false;
+    if (!OpenDevice(false)) return false;
+    struct stat info;
+    reconnectable = (0 == fstat(input_fd, &info)) && !S_ISREG(info.st_mode);
+    if (is_serial) have_attr = (0 == tcgetattr(input_fd, &device_attr));
+    return true;
+}  // end GPSReceiver::Open()
+
+bool GPSReceiver::OpenDevice(bool quiet)
+{
+    if ((input_fd = open(device_name, O_RDONLY | O_NONBLOCK)) < 0)
+    {
+        if (!quiet) perror("GPSReceiver::Open() open() error");
+        return false;
+    }
+    if (is_serial)
+    {
+        // (a reopened device gets the settings it had before it was lost)
+        if (!SerialInput::Configure(input_fd, device_baud) ||
+            (have_attr && (tcsetattr(input_fd, TCSANOW, &device_attr) < 0)))
+        {
+            Close();
+            return false;
+        }
+        tcflush(input_fd, TCIFLUSH);
+    }
+    serial_input.SetDescriptor(input_fd);
+    serial_input.SetBaud(is_serial ? device_baud : 0);
+    serial_input.Flush();
+    epoch_assembler.Reset();
+    epoch_assembler.SetTimeout(EpochAssembler::DefaultTimeout(is_serial ? device_baud : 0));
+    nmea_stream.Reset();
+    return true;
+}  // end GPSReceiver::OpenDevice()
+
+void GPSReceiver::Close()
+{
+    if (input_fd >= 0)
+    {
+        close(input_fd);
+        input_fd = -1;
+    }
+}  // end GPSReceiver::Close()
+
+void GPSReceiver::SetPublication(GPSHandle gpsHandle)
+{
+    gps_handle = gpsHandle;
+    if (gps_handle) GPSPublishUpdateV2(gps_handle, &p);
+}  // end GPSReceiver::SetPublication()
+
+bool GPSReceiver::OnInput()
+{
+    // One read() per call (the loop is level-triggered, so it calls
+    // again if more is pending), then the buffered bytes are framed
+    do
+    {
+        char character;
+        struct timeval arrivalTime;
+        int result = serial_input.GetByte(character, arrivalTime);
+        if (result > 0)
+        {
+            OnCharacter(character, arrivalTime);
+        }
+        else if (0 == result)
+        {
+            // (a device that has hung up, e.g. unplugged, reads as end of input)
+            fprintf(stderr, "GPSReceiver::OnInput() %s: end of input\n", device_name);
+            OnLost();
+            return false;
+        }
+        else
+        {
+            if ((EAGAIN == errno) || (EWOULDBLOCK == errno) || (EINTR == errno))
+                return true;
+            fprintf(stderr, "GPSReceiver::OnInput() %s: read() error: %s\n",
+                            device_name, strerror(errno));
+            OnLost();
+            return false;
+        }
+    } while (!serial_input.IsEmpty());
+    return true;
+}  // end GPSReceiver::OnInput()
+
+void GPSReceiver::OnLost()
+{
+    if (!reconnectable) return;  // (a file is done at its end)
+    GPSStatsCount(gps_stats, GPS_STATS_READ_ERRORS);
+    lost = true;
+    gettimeofday(&lost_time, NULL);
+    backoff.Reset();
+    ScheduleReconnect(lost_time);  // (first attempt right away)
+    fprintf(stderr, "gpsLogger: %s: device lost, reconnecting ...\n", device_name);
+    // The publication stays (its heartbeat goes on), but stale
+    epoch_assembler.Reset();
+    if (!p.stale)
+    {
+        p.stale = true;
+        if (gps_handle) GPSPublishUpdateV2(gps_handle, &p);
+    }
+}  // end GPSReceiver::OnLost()
+
+static inline long long TimeDiffUsec(const struct timeval& a, const struct timeval& b)
+{
+    return ((long long)(a.tv_sec - b.tv_sec) * 1000000 + (a.tv_usec - b.tv_usec));
+}  // end TimeDiffUsec()
+
+void GPSReceiver::ScheduleReconnect(const struct timeval& currentTime)
+{
+    long long usec = (long long)currentTime.tv_usec + 1000 * (long long)backoff.NextDelay();
+    reconnect_time.tv_sec = currentTime.tv_sec + (long)(usec / 1000000);
+    reconnect_time.tv_usec = (long)(usec % 1000000);
+}  // end GPSReceiver::ScheduleReconnect()
+
+bool GPSReceiver::Reconnect(const struct timeval& currentTime)
+{
+    if (!lost || IsOpen() || (TimeDiffUsec(currentTime, reconnect_time) < 0)) return false;
+    if (!OpenDevice(true))
+    {
+        ScheduleReconnect(currentTime);
+        return false;
+    }
+    lost = false;
+    reconnect_count++;
+    GPSStatsCount(gps_stats, GPS_STATS_RECONNECTS);
+    struct timeval openTime;
+    gettimeofday(&openTime, NULL);
+    fprintf(stderr, "gpsLogger: %s: reconnected after %.1f msec (%u attempts)\n", device_name,
+                    1.0e-03 * (double)TimeDiffUsec(openTime, lost_time), backoff.GetAttempts());
+    return true;
+}  // end GPSReceiver::Reconnect()
+
+void GPSReceiver::OnCharacter(char character, const struct timeval& arrivalTime)
+{
+    NMEAStream::Event event = nmea_stream.PutByte(character, arrivalTime);
+    if ((NMEAStream::NONE == event) || (NMEAStream::SKIPPED == event))
+        return;  // (SKIPPED is a sentence type we don't parse)
+    if (NMEAStream::FRAMING_ERROR == event)
+    {
+        if (debug) fprintf(stderr, "%s\n", nmea_stream.GetSentence());
+        fprintf(stderr, "gpsLogger: %s: %s\n", device_name, nmea_stream.GetError());
+        error_count++;
+        GPSStatsCount(gps_stats, (GPSStatsCounter)(GPS_STATS_PREMATURE_SENTENCES + 
+                                                   nmea_stream.GetErrorType()));
+        return;
+    }
+    // A complete sentence ("arrivalTime" is that of its last byte)
+    long long completeTime = gps_stats ? GPSStatsClock() : 0;
+    struct timeval currentTime;
+    gettimeofday(&currentTime, NULL);
+    sentence_count++;
+    GPSStatsCount(gps_stats, GPS_STATS_SENTENCES);
+    GPSStatsRecord(gps_stats, GPS_STATS_BYTE_TO_SENTENCE,
+                   1000 * TimeDiffUsec(currentTime, arrivalTime));
+    if (debug) fprintf(stderr, "%s: %s\n", device_name, nmea_stream.GetSentence());
+    if (NMEAStream::SENTENCE == event)
+    {
+        // (non-useful, e.g. VOID)
+        if (nmea_stream.GetError())
+        {
+            fprintf(stderr, "gpsLogger: %s: %s\n", device_name, nmea_stream.GetError());
+            GPSStatsCount(gps_stats, GPS_STATS_BAD_FIELDS);
+        }
+        return;
+    }
+    GPSPositionV2 fix = nmea_stream.GetFix();
+    fix.sys_time = currentTime;
+    long long parsedTime = 0;
+    if (gps_stats)
+    {
+        parsedTime = GPSStatsClock();
+        GPSStatsRecord(gps_stats, GPS_STATS_SENTENCE_TO_PARSED, parsedTime - completeTime);
+    }
+    // The sentences of an epoch are published as one fix
+    if (epoch_assembler.Add(fix, nmea_stream.GetInfo())) PublishEpochs(parsedTime);
+}  // end GPSReceiver::OnCharacter()
+
+// ("parsedTime" is when the fix that completed the epochs was extracted,
+// or 0 if they timed out)
+void GPSReceiver::PublishEpochs(long long parsedTime)
+{
+    while (epoch_assembler.GetFix(p))
+    {
+        fix_count++;
+        if (log_writer) log_writer->Log(p, log_device);
+        if (gps_handle) GPSPublishUpdateV2(gps_handle, &p);
+        GPSStatsCount(gps_stats, GPS_STATS_FIXES);
+        if (parsedTime)
+            GPSStatsRecord(gps_stats, GPS_STATS_PARSED_TO_PUBLISHED, GPSStatsClock() - parsedTime);
+    }
+}  // end GPSReceiver::PublishEpochs()
+
+int GPSReceiver::GetTimeout(const struct timeval& currentTime) const
+{
+    if (lost)
+    {
+        long long remaining = TimeDiffUsec(reconnect_time, currentTime);
+        return (remaining <= 0) ? 0 : (int)((remaining + 999) / 1000);
+    }
+    return epoch_assembler.GetTimeout(currentTime);
+}  // end GPSReceiver::GetTimeout()
+
+void GPSReceiver::CheckStale(const struct timeval& currentTime, unsigned int maxAge)
+{
+    if (epoch_assembler.CheckTimeout(currentTime)) PublishEpochs();
+    if (p.stale || (0 == p.sys_time.tv_sec)) return;
+    if ((currentTime.tv_sec - p.sys_time.tv_sec) > (long)maxAge)
+    {
+        p.stale = true;
+        if (gps_handle) GPSPublishUpdateV2(gps_handle, &p);
+    }
+}  // end GPSReceiver::CheckStale()
+
+
+ReceiverLoop::ReceiverLoop()
+ : epoll_fd(-1), watch_count(0), file_count(0)
+{
+}
+
+ReceiverLoop::~ReceiverLoop()
+{
+    Close();
+}
+
+bool ReceiverLoop::Open()
+{
+    Close();
+#ifdef LINUX
+    if ((epoll_fd = epoll_create1(EPOLL_CLOEXEC)) < 0)
+    {
+        perror("ReceiverLoop::Open() epoll_create1() error");
+        return false;
+    }
+    return true;
+#else
+    fprintf(stderr, "ReceiverLoop::Open() error: epoll() not supported\n");
+    return false;
+#endif // if/else LINUX
+}  // end ReceiverLoop::Open()
+
+void ReceiverLoop::Close()
+{
+    if (epoll_fd >= 0)
+    {
+        close(epoll_fd);
+        epoll_fd = -1;
+    }
+    watch_count = 0;
+    file_count = 0;
+}  // end ReceiverLoop::Close()
+
+bool ReceiverLoop::Add(GPSReceiver* receiver)
+{
+    if (receiver->IsFile())
+    {
+        if (file_count >= MAX_FILES)
+        {
+            fprintf(stderr, "ReceiverLoop::Add() error: too many file inputs\n");
+            return false;
+        }
+        files[file_count++] = receiver;
+        return true;
+    }
+#ifdef LINUX
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;  // (level-triggered)
+    event.data.ptr = receiver;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, receiver->GetDescriptor(), &event) < 0)
+    {
+        perror("ReceiverLoop::Add() epoll_ctl() error");
+        return false;
+    }
+    return true;
+#else
+    return false;
+#endif // if/else LINUX
+}  // end ReceiverLoop::Add()
+
+void ReceiverLoop::Remove(GPSReceiver* receiver)
+{
+    for (unsigned int i = 0; i < file_count; i++)
+    {
+        if (files[i] != receiver) continue;
+        files[i] = files[--file_count];
+        return;
+    }
+#ifdef LINUX
+    struct epoll_event event;  // (non-NULL for older kernels)
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_DEL, receiver->GetDescriptor(), &event) < 0)
+        perror("ReceiverLoop::Remove() epoll_ctl() error");
+#endif // LINUX
+}  // end ReceiverLoop::Remove()
+
+bool ReceiverLoop::Watch(int fd, bool* ready)
+{
+    if (watch_count >= MAX_WATCHES)
+    {
+        fprintf(stderr, "ReceiverLoop::Watch() error: too many watches\n");
+        return false;
+    }
+#ifdef LINUX
+    // (a watch's event data points into "watch_ready", not at a receiver)
+    watch_ready[watch_count] = ready;
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.ptr = &watch_ready[watch_count];
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0)
+    {
+        perror("ReceiverLoop::Watch() epoll_ctl() error");
+        return false;
+    }
+    watch_count++;
+    return true;
+#else
+    return false;
+#endif // if/else LINUX
+}  // end ReceiverLoop::Watch()
+
+int ReceiverLoop::Poll(int timeout)
+{
+#ifdef LINUX
+    struct epoll_event events[MAX_EVENTS];
+    if (file_count > 0) timeout = 0;  // (file input is pending)
+    int count = epoll_wait(epoll_fd, events, MAX_EVENTS, timeout);
+    if (count < 0)
+    {
+        if (EINTR == errno) return 0;
+        perror("ReceiverLoop::Poll() epoll_wait() error");
+        return -1;
+    }
+    for (int i = 0; i < count; i++)
+    {
+        bool** watch = (bool**)events[i].data.ptr;
+        if ((watch >= watch_ready) && (watch < (watch_ready + watch_count)))
+        {
+            **watch = true;
+            continue;
+        }
+        GPSReceiver* receiver = (GPSReceiver*)events[i].data.ptr;
+        if (!receiver->OnInput())
+        {
+            Remove(receiver);
+            receiver->Close();
+        }
+    }
+    // (one read() from each file input, in reverse as those at their end
+    // are removed)
+    for (unsigned int i = file_count; i-- > 0; )
+    {
+        GPSReceiver* receiver = files[i];
+        count++;
+        if (!receiver->OnInput())
+        {
+            Remove(receiver);
+            receiver->Close();
+        }
+    }
+    return count;
+#else
+    return -1;
+#endif // if/else LINUX
+}  // end ReceiverLoop::Poll()
@@ -0,0 +1,188 @@
+#ifndef _GPS_RECEIVER
+#define _GPS_RECEIVER
+
+#include "gpsPub.h"
+#include "serialInput.h"
+#include "logWriter.h"
+#include "epochAssembler.h"
+#include "nmeaStream.h"
+#include "gpsStats.h"
+
+#include <sys/time.h>
+#include <termios.h>
+
+// A GPSReceiver reads one GPS device without blocking, parses its NMEA
+// sentences as they arrive (see "nmeaStream.h"), and publishes (and
+// optionally logs) its position to its own publication slot (see
+// GPSPublishInitSlots()).
+// A ReceiverLoop serves any number of receivers from a single thread
+// using epoll(), so one gpsLogger process can handle a rack of GPS
+// receivers with one shared memory segment and keyFile.  (PPS capture
+// and system clock setting remain single-device gpsLogger features)
+
+// Device reconnection backoff:  the first attempt to reopen a lost
+// device is immediate, then attempts are retried after 10, 20, 40 ...
+// msec, up to once per second
+class ReconnectBackoff
+{
+    public:
+        ReconnectBackoff() : delay(0), attempts(0) {}
+        void Reset()
+        {
+            delay = 0;
+            attempts = 0;
+        }
+        // Msec to wait before the next attempt (which is counted)
+        unsigned int NextDelay()
+        {
+            unsigned int d = delay;
+            delay = delay ? ((2*delay < MAX_DELAY) ? 2*delay : (unsigned int)MAX_DELAY) : (unsigned int)MIN_DELAY;
+            attempts++;
+            return d;
+        }
+        unsigned int GetAttempts() const
+            {return attempts;}
+        
+        enum {MIN_DELAY = 10, MAX_DELAY = 1000};  // msec
+        
+    private:
+        unsigned int    delay;
+        unsigned int    attempts;
+};  // end class ReconnectBackoff
+
+class GPSReceiver
+{
+    public:
+        GPSReceiver();
+        ~GPSReceiver();
+
+        // Opens "device" (non-blocking) and, if "isSerialDevice",
+        // configures it for "baud"
+        bool Open(const char* device, bool isSerialDevice, unsigned int baud);
+        void Close();
+        bool IsOpen() const
+            {return (input_fd >= 0);}
+        // A device (i.e. not a regular file) lost to a read() error or hang
+        // up (OnInput() fails and the loop closes it) is reconnected:  its
+        // publication is marked stale and Reconnect(), called at least by
+        // the time GetTimeout() returns, reopens it (with backoff) and
+        // restores its serial port settings.  Returns true when reopened.
+        bool IsLost() const
+            {return lost;}
+        // (a regular file, always readable, and done at its end)
+        bool IsFile() const
+            {return (IsOpen() && !reconnectable);}
+        bool Reconnect(const struct timeval& currentTime);
+        int GetDescriptor() const
+            {return input_fd;}
+        const char* GetName() const
+            {return device_name;}
+
+        // Position updates are published to "gpsHandle" (a slot) and,
+        // if "logWriter" is non-NULL, logged tagged with "device" number
+        // (an initial, stale position is published right away)
+        void SetPublication(GPSHandle gpsHandle);
+        void SetLog(LogWriter* logWriter, unsigned int device)
+        {
+            log_writer = logWriter;
+            log_device = device;
+        }
+        // Latencies and errors are also recorded to "gpsStats" (if
+        // non-NULL, see "gpsStats.h")
+        void SetStats(GPSStats* gpsStats)
+            {gps_stats = gpsStats;}
+        void SetRequireChecksum(bool state)
+            {nmea_stream.SetRequireChecksum(state);}
+        void SetDebug(bool state)
+            {debug = state;}
+
+        // Reads and processes the input available (called when the device
+        // is readable).  Returns false upon error or end of file.
+        bool OnInput();
+        // Publishes any epoch that has timed out, and marks the published
+        // position stale if there has been no fix for more than "maxAge"
+        // seconds (call at least by the time GetTimeout() returns)
+        void CheckStale(const struct timeval& currentTime, unsigned int maxAge);
+        // Msec until an epoch being assembled times out, or the next
+        // reconnection attempt is due (-1 if neither)
+        int GetTimeout(const struct timeval& currentTime) const;
+
+        // Statistics
+        unsigned long GetSentenceCount() const
+            {return sentence_count;}
+        unsigned long GetFixCount() const  // (i.e. epochs published)
+            {return fix_count;}
+        unsigned long GetErrorCount() const
+            {return error_count;}
+        unsigned long GetReadCount() const
+            {return serial_input.GetReadCount();}
+        unsigned long GetReconnectCount() const
+            {return reconnect_count;}
+
+    private:
+        bool OpenDevice(bool quiet);
+        void OnCharacter(char character, const struct timeval& arrivalTime);
+        void PublishEpochs(long long parsedTime = 0);
+        void OnLost();
+        void ScheduleReconnect(const struct timeval& currentTime);
+
+        const char*     device_name;
+        bool            is_serial;
+        unsigned int    device_baud;
+        bool            reconnectable;      // (not a regular file)
+        bool            have_attr;
+        struct termios  device_attr;        // (serial port settings, to restore)
+        bool            lost;
+        struct timeval  lost_time;
+        struct timeval  reconnect_time;     // (of next attempt)
+        ReconnectBackoff backoff;
+        unsigned long   reconnect_count;
+        int             input_fd;
+        SerialInput     serial_input;
+        GPSHandle       gps_handle;
+        LogWriter*      log_writer;
+        unsigned int    log_device;
+        bool            debug;
+        GPSStats*       gps_stats;
+        NMEAStream      nmea_stream;
+        EpochAssembler  epoch_assembler;
+        GPSPositionV2   p;
+        unsigned long   sentence_count;
+        unsigned long   fix_count;
+        unsigned long   error_count;
+};  // end class GPSReceiver
+
+class ReceiverLoop
+{
+    public:
+        ReceiverLoop();
+        ~ReceiverLoop();
+
+        bool Open();
+        void Close();
+
+        // (a regular file input can't be waited for with epoll(), and is
+        // instead serviced by every Poll(), without waiting, until its end)
+        bool Add(GPSReceiver* receiver);
+        void Remove(GPSReceiver* receiver);
+        // Also waits for "fd" (e.g. a signalfd or timerfd, see
+        // "eventSource.h") to be readable, Poll() then setting "*ready"
+        // (it is left for the caller to read, and clear "*ready")
+        bool Watch(int fd, bool* ready);
+
+        // Waits up to "timeout" msec (-1 forever) for input and services
+        // the readable receivers.  Returns the number of events, or -1 upon
+        // error.  A receiver whose OnInput() fails is removed from the loop
+        // (and closed).
+        int Poll(int timeout);
+
+    private:
+        enum {MAX_EVENTS = 64, MAX_WATCHES = 4, MAX_FILES = 256};
+        int             epoll_fd;
+        bool*           watch_ready[MAX_WATCHES];
+        unsigned int    watch_count;
+        GPSReceiver*    files[MAX_FILES];
+        unsigned int    file_count;
+};  // end class ReceiverLoop
+
+#endif // _GPS_RECEIVER
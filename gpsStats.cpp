@@ -0,0 +1,191 @@
+
+#include "gpsStats.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+static const char* GPS_DEFAULT_KEY_FILE = "/tmp/gpskey";
+
+static const char* GPS_STATS_HISTOGRAM_NAMES[GPS_STATS_HISTOGRAM_COUNT] =
+{
+    "byte_to_sentence",
+    "sentence_to_parsed",
+    "parsed_to_published",
+    "pps_to_adjust",
+    "log_write",
+    "reader_to_parser",
+    "parser_to_publisher",
+    "publisher_to_logger"
+};
+
+static const char* GPS_STATS_COUNTER_NAMES[GPS_STATS_COUNTER_COUNT] =
+{
+    "sentences",
+    "fixes",
+    "premature_sentences",
+    "missing_checksums",
+    "long_sentences",
+    "bad_checksums",
+    "bad_checksum_fields",
+    "bad_fields",
+    "read_timeouts",
+    "read_errors",
+    "reconnects",
+    "pps_timeouts",
+    "time_changes_delayed",
+    "time_changes",
+    "clock_errors",
+    "log_drops",
+    "parser_drops",
+    "publisher_drops"
+};
+
+// Makes the POSIX shared memory object "name" for "keyFile" (its path,
+// with '/' made '.', plus ".stats", as the publication's is made)
+static bool GPSStatsGetObjectName(const char* keyFile, char* name, unsigned int len)
+{
+    if (!keyFile) keyFile = GPS_DEFAULT_KEY_FILE;
+    while ('/' == *keyFile) keyFile++;
+    if ((strlen(keyFile) + 8) > len)
+    {
+        fprintf(stderr, "GPSStats: keyFile name too long\n");
+        return false;
+    }
+    name[0] = '/';
+    unsigned int i = 0;
+    for (; '\0' != keyFile[i]; i++)
+        name[i+1] = ('/' == keyFile[i]) ? '.' : keyFile[i];
+    strcpy(name + i + 1, ".stats");
+    return true;
+}  // end GPSStatsGetObjectName()
+
+extern "C" GPSStats* GPSStatsPublish(const char* keyFile)
+{
+    char name[NAME_MAX + 1];
+    if (!GPSStatsGetObjectName(keyFile, name, NAME_MAX + 1)) return NULL;
+    // (readable by all, but only gpsLogger writes)
+    int fd = shm_open(name, O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+    {
+        perror("GPSStatsPublish() shm_open() error");
+        return NULL;
+    }
+    if (0 != ftruncate(fd, sizeof(GPSStats)))
+    {
+        perror("GPSStatsPublish() ftruncate() error");
+        close(fd);
+        return NULL;
+    }
+    void* ptr = mmap(NULL, sizeof(GPSStats), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (MAP_FAILED == ptr)
+    {
+        perror("GPSStatsPublish() mmap() error");
+        return NULL;
+    }
+    GPSStats* stats = (GPSStats*)ptr;
+    memset(stats, 0, sizeof(GPSStats));
+    stats->size = sizeof(GPSStats);
+    stats->histograms = GPS_STATS_HISTOGRAM_COUNT;
+    stats->counters = GPS_STATS_COUNTER_COUNT;
+    stats->pid = (int)getpid();
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    stats->start_time = (unsigned long long)now.tv_sec * 1000000 + now.tv_usec;
+    __atomic_store_n(&stats->version, GPS_STATS_VERSION, __ATOMIC_RELEASE);
+    return stats;
+}  // end GPSStatsPublish()
+
+extern "C" void GPSStatsShutdown(GPSStats* stats, const char* keyFile)
+{
+    __atomic_store_n(&stats->pid, 0, __ATOMIC_RELEASE);
+    munmap(stats, sizeof(GPSStats));
+    char name[NAME_MAX + 1];
+    if (GPSStatsGetObjectName(keyFile, name, NAME_MAX + 1) && shm_unlink(name))
+        perror("GPSStatsShutdown() shm_unlink() error");
+}  // end GPSStatsShutdown()
+
+extern "C" const GPSStats* GPSStatsSubscribe(const char* keyFile)
+{
+    char name[NAME_MAX + 1];
+    if (!GPSStatsGetObjectName(keyFile, name, NAME_MAX + 1)) return NULL;
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+    {
+        perror("GPSStatsSubscribe() shm_open() error");
+        return NULL;
+    }
+    struct stat st;
+    if ((0 != fstat(fd, &st)) || (st.st_size < (off_t)sizeof(GPSStats)))
+    {
+        fprintf(stderr, "GPSStatsSubscribe() error: incompatible statistics segment\n");
+        close(fd);
+        return NULL;
+    }
+    void* ptr = mmap(NULL, sizeof(GPSStats), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (MAP_FAILED == ptr)
+    {
+        perror("GPSStatsSubscribe() mmap() error");
+        return NULL;
+    }
+    const GPSStats* stats = (const GPSStats*)ptr;
+    if (GPS_STATS_VERSION != __atomic_load_n(&stats->version, __ATOMIC_ACQUIRE))
+    {
+        fprintf(stderr, "GPSStatsSubscribe() error: incompatible statistics version\n");
+        munmap(ptr, sizeof(GPSStats));
+        return NULL;
+    }
+    return stats;
+}  // end GPSStatsSubscribe()
+
+extern "C" void GPSStatsUnsubscribe(const GPSStats* stats)
+{
+    munmap((void*)stats, sizeof(GPSStats));
+}  // end GPSStatsUnsubscribe()
+
+extern "C" const char* GPSStatsGetHistogramName(unsigned int index)
+{
+    return (index < GPS_STATS_HISTOGRAM_COUNT) ? GPS_STATS_HISTOGRAM_NAMES[index] : NULL;
+}  // end GPSStatsGetHistogramName()
+
+extern "C" const char* GPSStatsGetCounterName(unsigned int index)
+{
+    return (index < GPS_STATS_COUNTER_COUNT) ? GPS_STATS_COUNTER_NAMES[index] : NULL;
+}  // end GPSStatsGetCounterName()
+
+extern "C" unsigned long long GPSStatsGetQuantile(const GPSHistogram* histogram, double fraction)
+{
+    unsigned long long total = 0;
+    for (unsigned int k = 0; k < GPS_STATS_BUCKETS; k++) total += histogram->bucket[k];
+    if (0 == total) return 0;
+    unsigned long long rank = (unsigned long long)(fraction * total);
+    if (rank >= total) rank = total - 1;
+    unsigned long long sum = 0;
+    for (unsigned int k = 0; k < GPS_STATS_BUCKETS; k++)
+    {
+        sum += histogram->bucket[k];
+        if (sum > rank)
+        {
+            unsigned long long upper = 2ULL << k;
+            // (no bucket's bound is beyond the longest seen)
+            return ((0 != histogram->max) && (histogram->max < upper)) ? histogram->max : upper;
+        }
+    }
+    return histogram->max;
+}  // end GPSStatsGetQuantile()
+
+extern "C" long long GPSStatsClock()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000000000 + now.tv_nsec;
+}  // end GPSStatsClock()
@@ -0,0 +1,137 @@
+#ifndef _GPS_STATS
+#define _GPS_STATS
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+
+// gpsLogger's hot path statistics:  latency histograms of each stage from
+// a byte's arrival until its fix is published (and of the PPS and logging
+// paths, and the wait in each queue between the stages of the loop, see
+// "gpsPipeline.h"), and counters of every error the loop reports.  They are
+// published in a shared memory segment of their own, named for the
+// position publication's keyFile plus ".stats" (e.g. "/tmp/gpskey" gives
+// "/tmp.gpskey.stats", i.e. "/dev/shm/tmp.gpskey.stats"), which readers
+// (e.g. "gpsStatsTool") map read-only.
+// Recording never blocks:  each histogram and counter has a single writing
+// thread, which updates it with relaxed atomic stores (no locked
+// instructions), so a reader may see a histogram's count and buckets a
+// sample or so apart.
+
+enum GPSStatsHistogram
+{
+    GPS_STATS_BYTE_TO_SENTENCE,     // sentence's last byte (arrival) to sentence complete
+    GPS_STATS_SENTENCE_TO_PARSED,   // sentence complete to fix extracted (and PPS paired)
+    GPS_STATS_PARSED_TO_PUBLISHED,  // epoch's last fix extracted to epoch published
+    GPS_STATS_PPS_TO_ADJUST,        // PPS edge to system clock adjusted
+    GPS_STATS_LOG_WRITE,            // log entry formatted and written (log writer thread)
+    GPS_STATS_READER_TO_PARSER,     // input queued by the reader to taken by the parser
+    GPS_STATS_PARSER_TO_PUBLISHER,  // fix queued by the parser to taken by the publisher
+    GPS_STATS_PUBLISHER_TO_LOGGER,  // log entry queued to taken by the log writer
+    GPS_STATS_HISTOGRAM_COUNT
+};
+
+enum GPSStatsCounter
+{
+    GPS_STATS_SENTENCES,            // (complete, of the types parsed)
+    GPS_STATS_FIXES,                // (epochs published)
+    GPS_STATS_PREMATURE_SENTENCES,  // (framing errors, in NMEAStream::FramingErrorType order ...)
+    GPS_STATS_MISSING_CHECKSUMS,
+    GPS_STATS_LONG_SENTENCES,
+    GPS_STATS_BAD_CHECKSUMS,
+    GPS_STATS_BAD_CHECKSUM_FIELDS,
+    GPS_STATS_BAD_FIELDS,           // (sentences with a bad field)
+    GPS_STATS_READ_TIMEOUTS,
+    GPS_STATS_READ_ERRORS,          // (device lost)
+    GPS_STATS_RECONNECTS,
+    GPS_STATS_PPS_TIMEOUTS,
+    GPS_STATS_TIME_CHANGES_DELAYED, // (first of two large time change readings)
+    GPS_STATS_TIME_CHANGES,         // (settimeofday())
+    GPS_STATS_CLOCK_ERRORS,         // (adjtime() or settimeofday() failed)
+    GPS_STATS_LOG_DROPS,
+    GPS_STATS_PARSER_DROPS,         // (input dropped, the parser's queue was full)
+    GPS_STATS_PUBLISHER_DROPS,      // (fixes dropped, the publisher's queue was full)
+    GPS_STATS_COUNTER_COUNT
+};
+
+// Histogram bucket "k" counts durations of [2^k, 2^(k+1)) nsec (bucket 0
+// also those under 1 nsec, and the last those of 2^31 nsec and longer)
+#define GPS_STATS_BUCKETS   32
+
+typedef struct GPSHistogram
+{
+    unsigned long long  count;
+    unsigned long long  sum;        // nsec
+    unsigned long long  max;        // nsec
+    unsigned long long  bucket[GPS_STATS_BUCKETS];
+} GPSHistogram;
+
+// (later versions only append histograms and counters, within the "max"
+// array sizes, so readers check "histograms" and "counters")
+#define GPS_STATS_VERSION           0x47505301  // "GPS" + stats layout 1
+#define GPS_STATS_HISTOGRAM_MAX     16
+#define GPS_STATS_COUNTER_MAX       64
+
+typedef struct GPSStats
+{
+    unsigned int        version;        // GPS_STATS_VERSION
+    unsigned int        size;           // sizeof(GPSStats)
+    int                 pid;            // (publisher's, 0 once it has shut down)
+    unsigned int        histograms;     // (GPS_STATS_HISTOGRAM_COUNT)
+    unsigned int        counters;       // (GPS_STATS_COUNTER_COUNT)
+    int                 priority;       // (publisher's real-time priority, 0 if none)
+    unsigned long long  start_time;     // (usec since 1970, of GPSStatsPublish())
+    unsigned long long  counter[GPS_STATS_COUNTER_MAX];
+    GPSHistogram        histogram[GPS_STATS_HISTOGRAM_MAX];
+} GPSStats;
+
+// Creates (or takes over) the statistics segment for "keyFile" (NULL for
+// the default), zeroed.  Returns NULL upon failure.
+GPSStats* GPSStatsPublish(const char* keyFile);
+void GPSStatsShutdown(GPSStats* stats, const char* keyFile);
+
+// Maps the statistics segment for "keyFile" read-only
+const GPSStats* GPSStatsSubscribe(const char* keyFile);
+void GPSStatsUnsubscribe(const GPSStats* stats);
+
+const char* GPSStatsGetHistogramName(unsigned int index);
+const char* GPSStatsGetCounterName(unsigned int index);
+// Upper bound (nsec) of the bucket holding the "fraction" (e.g. 0.99)
+// quantile of "histogram" (0 if it is empty)
+unsigned long long GPSStatsGetQuantile(const GPSHistogram* histogram, double fraction);
+
+// Recording (a NULL "stats" records nothing)
+static inline void GPSStatsCount(GPSStats* stats, enum GPSStatsCounter counter)
+{
+    if (!stats) return;
+    unsigned long long* c = &stats->counter[counter];
+    __atomic_store_n(c, *c + 1, __ATOMIC_RELAXED);
+}  // end GPSStatsCount()
+
+// (recording into a histogram of one's own, e.g. a test's)
+static inline void GPSStatsRecordHistogram(GPSHistogram* h, long long nsec)
+{
+    unsigned long long value = (nsec > 0) ? (unsigned long long)nsec : 0;
+    unsigned int k = (value > 1) ? (63 - __builtin_clzll(value)) : 0;
+    if (k >= GPS_STATS_BUCKETS) k = GPS_STATS_BUCKETS - 1;
+    __atomic_store_n(&h->bucket[k], h->bucket[k] + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&h->sum, h->sum + value, __ATOMIC_RELAXED);
+    if (value > h->max) __atomic_store_n(&h->max, value, __ATOMIC_RELAXED);
+    __atomic_store_n(&h->count, h->count + 1, __ATOMIC_RELAXED);
+}  // end GPSStatsRecordHistogram()
+
+static inline void GPSStatsRecord(GPSStats* stats, enum GPSStatsHistogram histogram,
+                                  long long nsec)
+{
+    if (stats) GPSStatsRecordHistogram(&stats->histogram[histogram], nsec);
+}  // end GPSStatsRecord()
+
+// (CLOCK_MONOTONIC nsec, for timing stages within gpsLogger)
+long long GPSStatsClock();
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif // _GPS_STATS
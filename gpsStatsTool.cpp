@@ -0,0 +1,109 @@
+// gpsStatsTool - dumps the latency histograms and error counters a running
+// gpsLogger publishes (see "gpsStats.h")
+
+#include "gpsStats.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+static void Usage()
+{
+    fprintf(stderr, "Usage: gpsStatsTool [pub <keyFile>][buckets][repeat <seconds>]\n");
+}  // end Usage()
+
+// (nsec, printed in usec)
+static void PrintHistogram(const char* name, const GPSHistogram& h, bool buckets)
+{
+    // (a copy, so the figures printed agree with each other)
+    GPSHistogram copy = h;
+    fprintf(stdout, "%-20s count>%llu", name, copy.count);
+    if (0 != copy.count)
+        fprintf(stdout, " mean>%.3f p50<%.3f p99<%.3f max>%.3f usec",
+                        1.0e-03 * copy.sum / copy.count,
+                        1.0e-03 * GPSStatsGetQuantile(&copy, 0.50),
+                        1.0e-03 * GPSStatsGetQuantile(&copy, 0.99),
+                        1.0e-03 * copy.max);
+    fprintf(stdout, "\n");
+    if (!buckets) return;
+    for (unsigned int k = 0; k < GPS_STATS_BUCKETS; k++)
+    {
+        if (0 == copy.bucket[k]) continue;
+        fprintf(stdout, "    [%.3f, %.3f) usec  %llu\n",
+                        (k ? 1.0e-03 * (1ULL << k) : 0.0), 1.0e-03 * (2ULL << k), copy.bucket[k]);
+    }
+}  // end PrintHistogram()
+
+static void PrintStats(const GPSStats* stats, bool buckets)
+{
+    time_t start = (time_t)(stats->start_time / 1000000);
+    struct tm startTime;
+    gmtime_r(&start, &startTime);
+    int pid = __atomic_load_n(&stats->pid, __ATOMIC_ACQUIRE);
+    fprintf(stdout, "gpsLogger pid>%d%s started>%04d-%02d-%02dT%02d:%02d:%02d",
+                    pid, pid ? "" : " (shut down)",
+                    startTime.tm_year + 1900, startTime.tm_mon + 1, startTime.tm_mday,
+                    startTime.tm_hour, startTime.tm_min, startTime.tm_sec);
+    if (stats->priority > 0)
+        fprintf(stdout, " priority>%d\n", stats->priority);
+    else
+        fprintf(stdout, " priority>none (not real-time)\n");
+    // (a newer gpsLogger may have more than we know the names of)
+    for (unsigned int i = 0; (i < stats->histograms) && (i < GPS_STATS_HISTOGRAM_MAX); i++)
+    {
+        const char* name = GPSStatsGetHistogramName(i);
+        if (name) PrintHistogram(name, stats->histogram[i], buckets);
+    }
+    for (unsigned int i = 0; (i < stats->counters) && (i < GPS_STATS_COUNTER_MAX); i++)
+    {
+        const char* name = GPSStatsGetCounterName(i);
+        if (name)
+            fprintf(stdout, "%-20s %llu\n", name,
+                            __atomic_load_n(&stats->counter[i], __ATOMIC_RELAXED));
+    }
+    fflush(stdout);
+}  // end PrintStats()
+
+int main(int argc, char* argv[])
+{
+    const char* keyFile = NULL;
+    bool buckets = false;
+    unsigned int repeat = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp("pub", argv[i]) && (i + 1 < argc))
+        {
+            keyFile = argv[++i];
+        }
+        else if (!strcmp("buckets", argv[i]))
+        {
+            buckets = true;
+        }
+        else if (!strcmp("repeat", argv[i]) && (i + 1 < argc))
+        {
+            repeat = atoi(argv[++i]);
+        }
+        else
+        {
+            Usage();
+            return -1;
+        }
+    }
+    const GPSStats* stats = GPSStatsSubscribe(keyFile);
+    if (!stats)
+    {
+        fprintf(stderr, "gpsStatsTool: Error opening gpsLogger statistics.\n");
+        return -1;
+    }
+    PrintStats(stats, buckets);
+    while (repeat > 0)
+    {
+        sleep(repeat);
+        fprintf(stdout, "\n");
+        PrintStats(stats, buckets);
+    }
+    GPSStatsUnsubscribe(stats);
+    return 0;
+}  // end main()
@@ -0,0 +1,197 @@
+
+#include "logWriter.h"
+
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sched.h>
+
+static inline unsigned long long MonotonicNsec()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((unsigned long long)now.tv_sec*1000000000ULL + now.tv_nsec);
+}  // end MonotonicNsec()
+
+LogWriter::LogWriter()
+ : file_ptr(NULL), policy(DROP), format(TEXT), device_tags(false), gps_stats(NULL),
+   cpu(-1), thread_started(false), stopping(false)
+{
+    memset(&stats, 0, sizeof(stats));
+}
+
+LogWriter::~LogWriter()
+{
+    Close();
+}
+
+bool LogWriter::Open(FILE* filePtr, unsigned int queueSize, Policy thePolicy,
+                     Format theFormat)
+{
+    Close();
+    if ((BINARY == theFormat) && !binary_log.Open(filePtr))
+    {
+        fprintf(stderr, "LogWriter::Open() error: binary log header write failed\n");
+        return false;
+    }
+    if (!queue.Init(queueSize))
+    {
+        fprintf(stderr, "LogWriter::Open() error: queue allocation failed\n");
+        return false;
+    }
+    if (sem_init(&ready, 0, 0))
+    {
+        perror("LogWriter::Open() sem_init() error");
+        return false;
+    }
+    file_ptr = filePtr;
+    policy = thePolicy;
+    format = theFormat;
+    stopping = false;
+    memset(&stats, 0, sizeof(stats));
+    // The writer thread runs with normal (non-real-time) scheduling
+    // so it never competes with the serial loop
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, SCHED_OTHER);
+    struct sched_param schp;
+    memset(&schp, 0, sizeof(schp));
+    pthread_attr_setschedparam(&attr, &schp);
+    int result = pthread_create(&thread, &attr, ThreadMain, this);
+    pthread_attr_destroy(&attr);
+    if (0 != result)
+    {
+        errno = result;
+        perror("LogWriter::Open() pthread_create() error");
+        sem_destroy(&ready);
+        return false;
+    }
+    thread_started = true;
+#ifdef LINUX
+    if (cpu >= 0)
+    {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(cpu, &cpus);
+        if (0 != (result = pthread_setaffinity_np(thread, sizeof(cpus), &cpus)))
+            fprintf(stderr, "LogWriter::Open() warning: can't pin thread to CPU %d: %s\n",
+                            cpu, strerror(result));
+    }
+#endif // LINUX
+    return true;
+}  // end LogWriter::Open()
+
+void LogWriter::Close()
+{
+    if (!thread_started) return;
+    __atomic_store_n(&stopping, true, __ATOMIC_RELEASE);
+    sem_post(&ready);
+    pthread_join(thread, NULL);
+    sem_destroy(&ready);
+    thread_started = false;
+    if (BINARY == format) binary_log.Close();  // (appends index)
+}  // end LogWriter::Close()
+
+bool LogWriter::Log(const GPSPosition& pos, unsigned int device)
+{
+    unsigned long long start = MonotonicNsec();
+    bool result = true;
+    Entry entry;
+    entry.pos = pos;
+    entry.device = device;
+    entry.queue_time = gps_stats ? GPSStatsClock() : 0;
+    while (!queue.Push(entry))
+    {
+        if ((DROP == policy) || !thread_started)
+        {
+            stats.dropped++;
+            GPSStatsCount(gps_stats, GPS_STATS_LOG_DROPS);
+            result = false;
+            break;
+        }
+        usleep(100);  // BLOCK policy: wait for the writer to make room
+    }
+    if (result)
+    {
+        stats.logged++;
+        sem_post(&ready);
+        unsigned int depth = queue.GetDepth();
+        if (depth > stats.max_depth) stats.max_depth = depth;
+    }
+    unsigned long long elapsed = MonotonicNsec() - start;
+    stats.enqueue_nsec += elapsed;
+    if (elapsed > stats.enqueue_max_nsec) stats.enqueue_max_nsec = elapsed;
+    return result;
+}  // end LogWriter::Log()
+
+void LogWriter::GetStats(Stats& theStats) const
+{
+    theStats = stats;
+    // (consumer side fields are updated by the writer thread)
+    theStats.written = __atomic_load_n(&stats.written, __ATOMIC_RELAXED);
+    theStats.write_nsec = __atomic_load_n(&stats.write_nsec, __ATOMIC_RELAXED);
+    theStats.write_max_nsec = __atomic_load_n(&stats.write_max_nsec, __ATOMIC_RELAXED);
+    theStats.depth = queue.GetDepth();
+}  // end LogWriter::GetStats()
+
+void* LogWriter::ThreadMain(void* arg)
+{
+    ((LogWriter*)arg)->Run();
+    return NULL;
+}  // end LogWriter::ThreadMain()
+
+void LogWriter::Run()
+{
+    while (true)
+    {
+        while ((0 != sem_wait(&ready)) && (EINTR == errno));
+        Entry entry;
+        bool wrote = false;
+        while (queue.Pop(entry))
+        {
+            unsigned long long start = MonotonicNsec();
+            if (entry.queue_time)
+                GPSStatsRecord(gps_stats, GPS_STATS_PUBLISHER_TO_LOGGER, (long long)start - entry.queue_time);
+            Write(entry);
+            unsigned long long elapsed = MonotonicNsec() - start;
+            __atomic_store_n(&stats.written, stats.written + 1, __ATOMIC_RELAXED);
+            __atomic_store_n(&stats.write_nsec, stats.write_nsec + elapsed, __ATOMIC_RELAXED);
+            if (elapsed > stats.write_max_nsec)
+                __atomic_store_n(&stats.write_max_nsec, elapsed, __ATOMIC_RELAXED);
+            GPSStatsRecord(gps_stats, GPS_STATS_LOG_WRITE, (long long)elapsed);
+            wrote = true;
+        }
+        if (wrote) fflush(file_ptr);  // (queue drained)
+        if (__atomic_load_n(&stopping, __ATOMIC_ACQUIRE) && (0 == queue.GetDepth())) break;
+    }
+}  // end LogWriter::Run()
+
+void LogWriter::Write(const Entry& entry)
+{
+    const GPSPosition& pos = entry.pos;
+    if (BINARY == format)
+    {
+        BinaryLogRecord record;
+        BinaryLogWriter::MakeRecord(pos, record);
+        if (device_tags) record.device = entry.device + 1;
+        binary_log.Write(record);
+    }
+    else
+    {
+        struct tm theTime;
+        time_t secs = pos.sys_time.tv_sec;
+        gmtime_r(&secs, &theTime);
+        fprintf(file_ptr, "time>%02d:%02d:%02d.%06lu position>%f,%f,%f",
+                          theTime.tm_hour,
+                          theTime.tm_min,
+                          theTime.tm_sec,
+                          (unsigned long)pos.sys_time.tv_usec,
+                          pos.y, pos.x, pos.z);
+        if (device_tags)
+            fprintf(file_ptr, " device>%u\n", entry.device);
+        else
+            fprintf(file_ptr, "\n");
+    }
+}  // end LogWriter::Write()
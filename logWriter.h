@@ -0,0 +1,104 @@
+#ifndef _LOG_WRITER
+#define _LOG_WRITER
+
+#include "spscQueue.h"
+#include "binaryLog.h"
+#include "gpsStats.h"
+
+#include <stdio.h>
+#include <sys/time.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+// The LogWriter formats and writes gpsLogger position log entries on
+// its own (non-real-time) thread so that a slow log disk never stalls
+// the serial loop.  Entries are handed over through a bounded lock-free
+// queue and, when it fills, are either dropped (and counted) or the
+// caller blocks until there is room, according to the "policy".
+// The log is either text ("time>HH:MM:SS.uuuuuu position>lat,lon,alt")
+// or the indexed binary format of "binaryLog.h".  With several GPS
+// receivers, entries are tagged with the receiver's device (slot)
+// number (" device>N" appended to text entries).
+
+class LogWriter
+{
+    public:
+        enum Policy {DROP, BLOCK};
+        enum Format {TEXT, BINARY};
+
+        LogWriter();
+        ~LogWriter();
+
+        bool Open(FILE* filePtr, unsigned int queueSize, Policy policy,
+                  Format format = TEXT);
+        // Writes any queued entries and stops the writer thread
+        // (the FILE is left open for the caller to close)
+        void Close();
+        bool IsOpen() const
+            {return thread_started;}
+
+        // Entries are tagged with their "device" number if enabled
+        // (before Open())
+        void SetDeviceTags(bool state)
+            {device_tags = state;}
+        // Drops, queue waits and write times are also recorded to
+        // "gpsStats" (if non-NULL, see "gpsStats.h") if set before Open()
+        void SetStats(GPSStats* gpsStats)
+            {gps_stats = gpsStats;}
+        // Pins the writer thread to "cpu" (if set before Open(), LINUX only)
+        void SetCpu(int theCpu)
+            {cpu = theCpu;}
+
+        // Called from the serial loop (the single producer) to log
+        // "pos" (its "sys_time" is the log entry time)
+        bool Log(const GPSPosition& pos, unsigned int device = 0);
+        // (the log format holds the GPSPosition fields only)
+        bool Log(const GPSPositionV2& pos, unsigned int device = 0)
+        {
+            GPSPosition position;
+            GPSPositionFromV2(&pos, &position);
+            return Log(position, device);
+        }
+
+        struct Stats
+        {
+            unsigned long       logged;         // entries queued
+            unsigned long       dropped;        // entries dropped (queue full)
+            unsigned long       written;        // entries written to file
+            unsigned int        depth;          // current queue depth
+            unsigned int        max_depth;      // queue depth high-water mark
+            unsigned long long  enqueue_nsec;   // total time spent in Log()
+            unsigned long long  enqueue_max_nsec;
+            unsigned long long  write_nsec;     // total time spent writing entries
+            unsigned long long  write_max_nsec;
+        };
+        void GetStats(Stats& stats) const;
+
+    private:
+        struct Entry
+        {
+            GPSPosition     pos;
+            unsigned int    device;
+            long long       queue_time;     // (GPSStatsClock(), with statistics)
+        };
+
+        static void* ThreadMain(void* arg);
+        void Run();
+        void Write(const Entry& entry);
+
+        FILE*                   file_ptr;
+        Policy                  policy;
+        Format                  format;
+        bool                    device_tags;
+        GPSStats*               gps_stats;
+        int                     cpu;
+        BinaryLogWriter         binary_log;
+        SPSCQueue<Entry>        queue;
+        sem_t                   ready;      // posted for each queued entry
+        pthread_t               thread;
+        bool                    thread_started;
+        bool                    stopping;
+        Stats                   stats;
+};  // end class LogWriter
+
+#endif // _LOG_WRITER
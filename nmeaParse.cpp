@@ -4,10 +4,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <time.h>
+
+#if __cplusplus >= 201402L
+static_assert(0 == NMEAParser::DaysFromCivil(1970, 1, 1), "DaysFromCivil() epoch");
+static_assert(10957 == NMEAParser::DaysFromCivil(2000, 1, 1), "DaysFromCivil() Y2K");
+#endif // C++14
 
 // Templates for sentence types supported by this parser
-const NMEAParser::FieldType NMEAParser::GPRMC_TEMPLATE[] = 
+const NMEAParser::FieldType NMEAParser::RMC_TEMPLATE[] = 
 {
     TIME,
     STATUS,
@@ -23,7 +27,9 @@ const NMEAParser::FieldType NMEAParser::GPRMC_TEMPLATE[] =
     END  // end of template
 };
 
-const NMEAParser::FieldType NMEAParser::GPGGA_TEMPLATE[] = 
+const double NMEAParser::METERS_PER_SEC_PER_KNOT = 1852.0 / 3600.0;
+
+const NMEAParser::FieldType NMEAParser::GGA_TEMPLATE[] = 
 {
     TIME,
     LAT_VAL,
@@ -42,7 +48,141 @@ const NMEAParser::FieldType NMEAParser::GPGGA_TEMPLATE[] =
     END  // end of template
 };   
 
-// Note: Since GPGGA sentences don't have a "DATE" field
+const NMEAParser::FieldType NMEAParser::GNS_TEMPLATE[] = 
+{
+    TIME,
+    LAT_VAL,
+    LAT_REF,
+    LON_VAL,
+    LON_REF,
+    GNS_MODE,
+    SAT_USED,
+    HDOP,
+    ALT_M,
+    GEO,
+    D_AGE,
+    D_REF,
+    END  // end of template
+};
+
+const NMEAParser::FieldType NMEAParser::GSA_TEMPLATE[] = 
+{
+    UNUSED,     // "M" (manual) or "A" (automatic) 2D/3D selection
+    FIX_TYPE,
+    UNUSED, UNUSED, UNUSED, UNUSED, UNUSED, UNUSED,  // satellite IDs
+    UNUSED, UNUSED, UNUSED, UNUSED, UNUSED, UNUSED,
+    UNUSED,     // PDOP
+    HDOP,
+    UNUSED,     // VDOP
+    END  // end of template
+};
+
+const NMEAParser::FieldType NMEAParser::GSV_TEMPLATE[] = 
+{
+    UNUSED,     // number of GSV sentences
+    UNUSED,     // sentence number
+    UNUSED,     // satellites in view (followed by up to 4 satellites)
+    END  // end of template
+};
+
+const NMEAParser::FieldType NMEAParser::VTG_TEMPLATE[] = 
+{
+    HDG,
+    UNUSED,     // "T" (true)
+    UNUSED,     // magnetic course
+    UNUSED,     // "M" (magnetic)
+    SPD,
+    UNUSED,     // "N" (knots)
+    UNUSED,     // speed km/h
+    UNUSED,     // "K"
+    OPTIONAL,   // (NMEA 2.3 and later)
+    MODE_IND,
+    END  // end of template
+};
+
+const NMEAParser::FieldType NMEAParser::ZDA_TEMPLATE[] = 
+{
+    TIME,
+    DAY,
+    MONTH,
+    YEAR,
+    UNUSED,     // local zone hours
+    UNUSED,     // local zone minutes
+    END  // end of template
+};
+
+const NMEAParser::FieldType NMEAParser::GST_TEMPLATE[] = 
+{
+    TIME,
+    UNUSED,     // RMS of pseudorange residuals
+    UNUSED,     // error ellipse semi-major axis
+    UNUSED,     // error ellipse semi-minor axis
+    UNUSED,     // error ellipse orientation
+    UNUSED,     // latitude error
+    UNUSED,     // longitude error
+    UNUSED,     // altitude error
+    END  // end of template
+};
+
+// (indexed by SentenceType)
+const NMEAParser::SentenceDescriptor NMEAParser::DESCRIPTORS[NUM_SENTENCE_TYPES] = 
+{
+    {"",    NULL},
+    {"RMC", RMC_TEMPLATE},
+    {"GGA", GGA_TEMPLATE},
+    {"GNS", GNS_TEMPLATE},
+    {"GSA", GSA_TEMPLATE},
+    {"GSV", GSV_TEMPLATE},
+    {"VTG", VTG_TEMPLATE},
+    {"ZDA", ZDA_TEMPLATE},
+    {"GST", GST_TEMPLATE}
+};
+
+// Sentence type by DispatchHash() of the last two address characters
+const NMEAParser::SentenceType NMEAParser::DISPATCH[DISPATCH_SIZE] = 
+{
+    RMC,                // 0:  'M' + 'C'
+    GNS,                // 1:  'N' + 'S'
+    INVALID_SENTENCE,
+    INVALID_SENTENCE,
+    GSA,                // 4:  'S' + 'A'
+    ZDA,                // 5:  'D' + 'A'
+    INVALID_SENTENCE,
+    GST,                // 7:  'S' + 'T'
+    GGA,                // 8:  'G' + 'A'
+    GSV,                // 9:  'S' + 'V'
+    INVALID_SENTENCE,
+    VTG,                // 11: 'T' + 'G'
+    INVALID_SENTENCE,
+    INVALID_SENTENCE,
+    INVALID_SENTENCE,
+    INVALID_SENTENCE
+};
+
+#if __cplusplus >= 201402L
+static_assert((0 == NMEAParser::DispatchHash('M', 'C')) && (1 == NMEAParser::DispatchHash('N', 'S')) &&
+              (4 == NMEAParser::DispatchHash('S', 'A')) && (5 == NMEAParser::DispatchHash('D', 'A')) &&
+              (7 == NMEAParser::DispatchHash('S', 'T')) && (8 == NMEAParser::DispatchHash('G', 'A')) &&
+              (9 == NMEAParser::DispatchHash('S', 'V')) && (11 == NMEAParser::DispatchHash('T', 'G')),
+              "NMEAParser::DISPATCH table doesn't match DispatchHash()");
+#endif // C++14
+
+unsigned int NMEAParser::sentence_mask = NMEAParser::DEFAULT_SENTENCE_MASK;
+
+NMEAParser::SentenceType NMEAParser::GetSentenceType(const char* buffer, unsigned int len)
+{
+    // Address is a two letter talker ID and three letter sentence type
+    if ((len < 5) || ((len > 5) && (',' != buffer[5]))) return INVALID_SENTENCE;
+    if ((buffer[0] < 'A') || (buffer[0] > 'Z') || (buffer[1] < 'A') || (buffer[1] > 'Z'))
+        return INVALID_SENTENCE;
+    SentenceType type = DISPATCH[DispatchHash(buffer[3], buffer[4])];
+    const char* name = DESCRIPTORS[type].name;
+    if ((name[0] != buffer[2]) || (name[1] != buffer[3]) || (name[2] != buffer[4]))
+        return INVALID_SENTENCE;
+    return type;
+}  // end NMEAParser::GetSentenceType()
+
+// Note: Since GGA (and GNS) sentences don't have a "DATE" field
 // we don't set the "tvalid" to true even though the 
 // time is there.
 
@@ -53,405 +193,586 @@ const NMEAParser::FieldType NMEAParser::GPGGA_TEMPLATE[] =
 // message (sentence) information content ... but the following
 // will do for now.
 
-bool NMEAParser::GetTimeAndPosition(const char* buffer, GPSPosition* p)
-{    
-    // 1) Copy buffer
-    unsigned int len = strlen(buffer);
-    if (len > 80) return false;  // NMEA sentences are 80 chars max
-    char* buf = new char[len+1];
-    if (!buf)
+unsigned int NMEAParser::Tokenize(const char* buffer, unsigned int len,
+                                  Field* fields, unsigned int maxFields)
+{
+    if (0 == maxFields) return 0;
+    unsigned int count = 0;
+    unsigned int start = 0;
+    for (unsigned int i = 0; i < len; i++)
     {
-        perror("NMEAParser::GetTimeAndPosition() Error allocating buffer");
-        return false;
+        if (',' == buffer[i])
+        {
+            fields[count].offset = start;
+            fields[count].length = i - start;
+            if (++count >= maxFields) return count;
+            start = i + 1;
+        }
     }
-    strncpy(buf, buffer, len);
-    buf[len] = '\0';
-    
-    // 2) Determine sentence type
-    char* ptr = strchr(buf, ',');
-    if (ptr) *ptr++ = '\0';
-    
-    SentenceType sentenceType = INVALID_SENTENCE;
-    const FieldType* sentenceTemplate = NULL;
-    
-    if (!strcmp("GPRMC", buf))
+    fields[count].offset = start;
+    fields[count].length = len - start;
+    return (count + 1);
+}  // end NMEAParser::Tokenize()
+
+// Powers of ten for the fixed-point conversions (all exact as double)
+static const long long POW10[] = 
+{
+    1LL, 10LL, 100LL, 1000LL, 10000LL, 100000LL, 1000000LL, 
+    10000000LL, 100000000LL, 1000000000LL
+};
+
+bool NMEAParser::ParseDigits(const char* text, unsigned int len, unsigned int& value)
+{
+    if ((0 == len) || (len > 9)) return false;
+    unsigned int v = 0;
+    for (unsigned int i = 0; i < len; i++)
     {
-        //fprintf(stderr, "%s\n", buffer);
-        sentenceType = GPRMC;
-        sentenceTemplate = GPRMC_TEMPLATE;
+        unsigned int digit = (unsigned char)text[i] - '0';
+        if (digit > 9) return false;
+        v = v*10 + digit;
     }
-    else if (!strcmp("GPGGA", buf))
+    value = v;
+    return true;
+}  // end NMEAParser::ParseDigits()
+
+bool NMEAParser::ParseDecimal(const char* text, unsigned int len, Decimal& value)
+{
+    bool negative = false;
+    unsigned int i = 0;
+    if ((i < len) && (('-' == text[i]) || ('+' == text[i])))
+        negative = ('-' == text[i++]);
+    long long mantissa = 0;
+    unsigned int digits = 0;
+    unsigned int decimals = 0;
+    bool point = false;
+    for (; i < len; i++)
     {
-        //fprintf(stderr, "%s\n", buffer);
-        sentenceType = GPGGA;
-        sentenceTemplate = GPGGA_TEMPLATE;
+        if ('.' == text[i])
+        {
+            if (point) return false;
+            point = true;
+            continue;
+        }
+        unsigned int digit = (unsigned char)text[i] - '0';
+        if (digit > 9) return false;
+        if (point)
+        {
+            // Digits beyond MAX_DECIMALS are below any receiver's resolution
+            if (decimals >= MAX_DECIMALS) continue;
+            decimals++;
+        }
+        if (++digits > 15) return false;  // keep mantissa exact as a double
+        mantissa = mantissa*10 + digit;
     }
-    else
+    if (0 == digits) return false;
+    value.mantissa = negative ? -mantissa : mantissa;
+    value.decimals = decimals;
+    return true;
+}  // end NMEAParser::ParseDecimal()
+
+double NMEAParser::DecimalToDouble(const Decimal& value)
+{
+    // Both operands are exact, so the quotient is correctly rounded
+    return (double)value.mantissa / (double)POW10[value.decimals];
+}  // end NMEAParser::DecimalToDouble()
+
+bool NMEAParser::ParseTimeOfDay(const char* text, unsigned int len,
+                                unsigned int& hour, unsigned int& minute,
+                                unsigned int& second, unsigned long& usec)
+{
+    if (len < 6) return false;
+    if (!ParseDigits(text, 2, hour) || (hour > 23)) return false;
+    if (!ParseDigits(text+2, 2, minute) || (minute > 59)) return false;
+    if (!ParseDigits(text+4, 2, second) || (second > 60)) return false;  // (leap second)
+    usec = 0;
+    if (len > 6)
+    {
+        if (('.' != text[6]) || (7 == len)) return false;
+        unsigned int fracLen = len - 7;
+        unsigned int fraction;
+        // (digits beyond microseconds are ignored)
+        if (!ParseDigits(text+7, (fracLen > 6) ? 6 : fracLen, fraction)) return false;
+        usec = fraction * (unsigned long)POW10[(fracLen > 6) ? 0 : (6 - fracLen)];
+    }
+    return true;
+}  // end NMEAParser::ParseTimeOfDay()
+
+bool NMEAParser::ParseAngle(const char* text, unsigned int len, 
+                            unsigned int degDigits, double& degrees)
+{
+    unsigned int deg;
+    Decimal minutes;
+    if ((len <= degDigits) || !ParseDigits(text, degDigits, deg)) return false;
+    if (('-' == text[degDigits]) || ('+' == text[degDigits])) return false;
+    if (!ParseDecimal(text + degDigits, len - degDigits, minutes)) return false;
+    if (minutes.mantissa >= 60*POW10[minutes.decimals]) return false;
+    unsigned int maxDeg = (degDigits < 3) ? 90 : 180;  // (latitude or longitude)
+    if ((deg > maxDeg) || ((deg == maxDeg) && (0 != minutes.mantissa))) return false;
+    // Exact value is (deg*60*10^n + mantissa) / (60*10^n) with both
+    // integers well within 2^53, so only the final division rounds
+    long long scale = 60*POW10[minutes.decimals];
+    degrees = (double)(deg*scale + minutes.mantissa) / (double)scale;
+    return true;
+}  // end NMEAParser::ParseAngle()
+
+bool NMEAParser::GetTimeAndPosition(const char* buffer, unsigned int len, GPSPosition* p)
+{
+    return GetTimeAndPosition(buffer, len, p, NULL);
+}  // end NMEAParser::GetTimeAndPosition()
+
+bool NMEAParser::GetTimeAndPosition(const char* buffer, unsigned int len, GPSPosition* p,
+                                    SentenceInfo* info)
+{
+    GPSPositionV2 fix;
+    if (!GetTimeAndPosition(buffer, len, &fix, info)) return false;
+    // (only the valid values are copied, as before)
+    if (0 != (fix.valid & GPS_VALID_TIME)) p->gps_time = fix.gps_time;
+    if (0 != (fix.valid & GPS_VALID_XY))
+    {
+        p->x = fix.x;
+        p->y = fix.y;
+    }
+    if (0 != (fix.valid & GPS_VALID_Z)) p->z = fix.z;
+    p->tvalid = (0 != (fix.valid & GPS_VALID_TIME));
+    p->xyvalid = (0 != (fix.valid & GPS_VALID_XY));
+    p->zvalid = (0 != (fix.valid & GPS_VALID_Z));
+    return true;
+}  // end NMEAParser::GetTimeAndPosition()
+
+bool NMEAParser::GetTimeAndPosition(const char* buffer, unsigned int len, GPSPositionV2* p,
+                                    SentenceInfo* info)
+{    
+    // 1) Determine sentence type from the address field alone, so 
+    //    unwanted sentences (e.g. GSV floods) cost next to nothing
+    if (len > MAX_SENTENCE_LENGTH) return false;
+    SentenceType sentenceType = GetSentenceType(buffer, len);
+    if ((INVALID_SENTENCE == sentenceType) || (0 == (sentence_mask & (1 << sentenceType))))
     {
         //fprintf(stderr, "NMEAParser::GetTimeAndPosition() "
-        //                "Unknown sentence \"%s\"\n", buf);
-        delete[] buf;
+        //                "Unknown sentence \"%.*s\"\n", len, buffer);
         return false;
     }
-            
     
-    // 3) Parse sentence based on "sentenceTemplate" 
+    // 2) Split sentence into field views (no copy of the sentence is made)
+    Field fields[MAX_FIELDS];
+    unsigned int numFields = Tokenize(buffer, len, fields, MAX_FIELDS);
     
-    // Values collected from sentence
-    unsigned int hour, minute, day, month, year;
-    double second, latVal, lonVal, altVal;
-    double latRef = 0.0;
-    double lonRef = 0.0;
-    Status status = INVALID_STATUS;
-    UnitType altUnit = INVALID_UNIT;
-    
-    // Checks
-    bool gotTime = false;
-    bool gotDate = false;
-    bool gotLatVal = false;
-    bool gotLonVal = false;
-    bool gotAltVal = false;
+    // 3) Parse sentence fields based on its template
+    SentenceState state;
+    BeginSentence(sentenceType, state);
+    for (unsigned int i = 1; (i < numFields) && (END != *state.field); i++)  // (field 0 is the address)
+    {
+        if (!ParseField(buffer + fields[i].offset, fields[i].length, state))
+            break;
+    }
     
-    unsigned int i = 0;  // Start at beginning of the template
-    FieldType fieldType = sentenceTemplate[i++];
-    while (END != fieldType)
+    // 4) Fill out GPSPositionV2 struct with data collected from parsing
+    if (!EndSentence(state, p, info))
     {
-        if (!ptr)
+        if (state.error)
+            fprintf(stderr, "NMEAParser::GetTimeAndPosition() %s\n", state.error);
+        return false;
+    }
+    return true;
+}  // end NMEAParser::GetTimeAndPosition()
+
+void NMEAParser::BeginSentence(SentenceType type, SentenceState& state)
+{
+    state.type = type;
+    state.field = DESCRIPTORS[type].fields;
+    state.optional = false;
+    state.error = NULL;
+    state.quality = 0;
+    state.latRef = 0.0;
+    state.lonRef = 0.0;
+    state.status = INVALID_STATUS;
+    state.altUnit = INVALID_UNIT;
+    state.gotTime = false;
+    state.dateParts = 0;
+    state.statusField = false;
+    state.gotLatVal = false;
+    state.gotLonVal = false;
+    state.gotAltVal = false;
+    state.gotSpeed = false;
+    state.gotHeading = false;
+    state.gotHdop = false;
+    state.gotSatellites = false;
+    state.gotQuality = false;
+}  // end NMEAParser::BeginSentence()
+
+static inline bool FieldError(NMEAParser::SentenceState& state, const char* message)
+{
+    state.error = message;
+    return false;
+}  // end FieldError()
+
+bool NMEAParser::ParseField(const char* field, unsigned int fieldLength, SentenceState& state)
+{
+    if (state.error) return false;
+    while (OPTIONAL == *state.field)
+    {
+        state.optional = true;
+        state.field++;
+    }
+    FieldType fieldType = *state.field;
+    if (END == fieldType) return true;  // (any further fields are ignored)
+    state.field++;
+    switch (fieldType)
+    {
+        case TIME:
         {
-            fprintf(stderr, "NMEAParser::GetTimeAndPosition() "
-                            "Reached sentence end prematurely!\n");
-            delete[] buf;
-            return false;
+            // UTC time format: hhmmss[.fff]
+            if (0 == fieldLength) break; // no TIME provided
+            if (!ParseTimeOfDay(field, fieldLength, state.hour, state.minute, state.second, state.usec))
+            {
+                return FieldError(state, "Bad TIME field in sentence!");
+            }
+            state.gotTime = true;
         }
-        char* field = ptr;
-        ptr = strchr(ptr, ',');
-        if (ptr) *ptr++ = '\0';
-        switch (fieldType)
+        break;
+        
+        case DATE:
         {
-            case TIME:
+            // Date format: ddmmyy
+            if (0 == fieldLength) break; // no DATE provided
+            if ((fieldLength < 6) ||
+                !ParseDigits(&field[0], 2, state.day) ||
+                !ParseDigits(&field[2], 2, state.month) ||
+                !ParseDigits(&field[4], 2, state.yy))
             {
-                // UTC time format: hhmmss[.fff]
-                if ('\0' == field[0]) break; // no TIME provided
-                if (strlen(field) < 6)
-                {
-                    fprintf(stderr, "NMEAParser::GetTimeAndPosition() "
-                                    "Bad TIME field in sentence!\n");
-                    delete[] buf;
-                    return false;
-                }
-                char temp[3];
-                temp[2] = '\0';
-                // hours
-                strncpy(temp, &field[0], 2);
-                hour = atoi(temp);
-                // minutes
-                strncpy(temp, &field[2], 2);
-                minute = atoi(temp);
-                // seconds
-                float sec;
-                if (1 != sscanf(&field[4], "%f", &sec))
-                {
-                    fprintf(stderr, "NMEAParser::GetTimeAndPosition() "
-                                    "Bad TIME (secs) field in sentence!\n");
-                    delete[] buf;
-                    return false;
-                }
-                else
-                {
-                    second = (double)sec;
-                    gotTime = true;
-                }
+                return FieldError(state, "Bad DATE field in sentence!");
             }
-            break;
-            
-            case DATE:
+            state.year = FullYear(state.yy);
+            state.dateParts = 0x07;
+        }
+        break;
+        
+        case DAY:
+        case MONTH:
+        case YEAR:
+        {
+            // (ZDA) date in separate "dd", "mm" and "yyyy" fields
+            if (0 == fieldLength) break; // not provided
+            unsigned int value;
+            if ((fieldLength != ((YEAR == fieldType) ? 4U : 2U)) ||
+                !ParseDigits(field, fieldLength, value))
             {
-                // Date format: ddmmyy
-                // UTC time format: hhmmss[.fff]
-                if ('\0' == field[0]) break; // no DATE provided
-                if (strlen(field) < 6)
-                {
-                    fprintf(stderr, "NMEAParser::GetTimeAndPosition() "
-                                    "Bad DATE field in sentence!\n");
-                    delete[] buf;
-                    return false;
-                }
-                char temp[3];
-                temp[2] = '\0';
-                // day
-                strncpy(temp, &field[0], 2);
-                day = atoi(temp);
-                // month
-                strncpy(temp, &field[2], 2);
-                month = atoi(temp);
-                // year
-                strncpy(temp, &field[4], 2);
-                year = atoi(temp);
-                gotDate = true;
+                return FieldError(state, "Bad DAY/MONTH/YEAR field in sentence!");
             }
-            break;
-            
-            case LAT_VAL:
+            if (DAY == fieldType)
             {
-                // Lat format: ddmm.mmmmm
-                if ('\0' == field[0]) break; // no LAT_VAL provided
-                if (strlen(field) < 4)
-                {
-                    fprintf(stderr, "NMEAParser::GetTimeAndPosition() "
-                                    "Bad LAT_VAL field in sentence!\n");
-                    delete[] buf;
-                    return false;
-                }
-                char temp[3];
-                temp[2] = '\0';
-                // degrees
-                strncpy(temp, &field[0], 2);
-                int deg = atoi(temp);
-                // minutes
-                float min;
-                if (1 != sscanf(&field[2], "%f", &min))
-                {
-                    fprintf(stderr, "NMEAParser::GetTimeAndPosition() "
-                                    "Bad LAT_VAL (minutes) field in sentence!\n");
-                    delete[] buf;
-                    return false;
-                }
-                else
-                {
-                    latVal = (double)deg + (min/60.0);
-                    gotLatVal = true;
-                }
+                state.day = value;
+                state.dateParts |= 0x01;
             }
-            break;
-            
-            case LAT_REF:
-                if ('\0' == field[0]) 
-                    break; // no LAT_REF provided
-                else if ('N' == field[0])
-                    latRef = 1.0;
-                else if ('S' == field[0])
-                    latRef = -1.0;
-                else
-                {
-                    fprintf(stderr, "NMEAParser::GetTimeAndPosition() "
-                                    "Bad LAT_REF field in sentence!\n");
-                    delete[] buf;
-                    return false;
-                }
-                break;
-            
-            case LON_VAL:
+            else if (MONTH == fieldType)
             {
-                // Lon format: dddmm.mmmmm
-                if ('\0' == field[0]) break; // no LON_VAL provided
-                if (strlen(field) < 4)
-                {
-                    fprintf(stderr, "NMEAParser::GetTimeAndPosition() "
-                                    "Bad LON_VAL field in sentence!\n");
-                    delete[] buf;
-                    return false;
-                }
-                char temp[4];
-                temp[3] = '\0';
-                // degrees
-                strncpy(temp, &field[0], 3);
-                int deg = atoi(temp);
-                // minutes
-                float min;
-                if (1 != sscanf(&field[3], "%f", &min))
-                {
-                    fprintf(stderr, "NMEAParser::GetTimeAndPosition() "
-                                    "Bad LON_VAL (minutes) field in sentence!\n");
-                    delete[] buf;
-                    return false;
-                }
-                else
-                {
-                    lonVal = (double)deg + (min/60.0);
-                    gotLonVal = true;
-                }
+                state.month = value;
+                state.dateParts |= 0x02;
+            }
+            else
+            {
+                state.year = value;
+                state.dateParts |= 0x04;
+            }
+        }
+        break;
+        
+        case LAT_VAL:
+        {
+            // Lat format: ddmm.mmmmm
+            if (0 == fieldLength) break; // no LAT_VAL provided
+            if (!ParseAngle(field, fieldLength, 2, state.latVal))
+            {
+                return FieldError(state, "Bad LAT_VAL field in sentence!");
+            }
+            state.gotLatVal = true;
+        }
+        break;
+        
+        case LAT_REF:
+            if (0 == fieldLength) 
+                break; // no LAT_REF provided
+            else if ('N' == field[0])
+                state.latRef = 1.0;
+            else if ('S' == field[0])
+                state.latRef = -1.0;
+            else
+            {
+                return FieldError(state, "Bad LAT_REF field in sentence!");
             }
             break;
+        
+        case LON_VAL:
+        {
+            // Lon format: dddmm.mmmmm
+            if (0 == fieldLength) break; // no LON_VAL provided
+            if (!ParseAngle(field, fieldLength, 3, state.lonVal))
+            {
+                return FieldError(state, "Bad LON_VAL field in sentence!");
+            }
+            state.gotLonVal = true;
+        }
+        break;
 
-            
-            case LON_REF:
-                if ('\0' == field[0]) 
-                    break; // no LON_REF provided
-                else if ('E' == field[0])
-                    lonRef = 1.0;
-                else if ('W' == field[0])
-                    lonRef = -1.0;
-                else
-                {
-                    fprintf(stderr, "NMEAParser::GetTimeAndPosition() "
-                                    "Bad LON_REF field in sentence!\n");
-                    delete[] buf;
-                    return false;
-                }
-                break;
+        
+        case LON_REF:
+            if (0 == fieldLength) 
+                break; // no LON_REF provided
+            else if ('E' == field[0])
+                state.lonRef = 1.0;
+            else if ('W' == field[0])
+                state.lonRef = -1.0;
+            else
+            {
+                return FieldError(state, "Bad LON_REF field in sentence!");
+            }
+            break;
 
-            case ALT_VAL:
-                // altitude value
-                float alt;
-                if ('\0' == field[0]) break; // no ALT_VAL provided
-                if (1 != sscanf(&field[0], "%f", &alt))
-                {
-                    fprintf(stderr, "NMEAParser::GetTimeAndPosition() "
-                                    "Bad ALT_VAL (minutes) field in sentence!\n");
-                    delete[] buf;
-                    return false;
-                }
-                else
-                {
-                    altVal = (double) alt;
-                    gotAltVal = true;
-                }                
-                break;
-                
-            case ALT_UNIT:
-                if ('\0' == field[0]) 
-                {
-                    break; // no ALT_UNIT provided
-                }
-                else if ('M' == field[0])
-                {
-                    altUnit = METERS;
-                }
-                else  // (TBD) add support for other units
-                {
-                    fprintf(stderr, "NMEAParser::GetTimeAndPosition() "
-                                    "Bad ALT_UNIT field in sentence!\n");
-                    delete[] buf;
-                    return false;
-                }
-                break;
-                
-            case STATUS:
-                if ('\0' == field[0]) 
-                    break; // no STATUS provided
-                else if ('A' == field[0])
-                    status = ACTIVE;
-                else if ('V' == field[0])
-                    status = VOID;
-                else
-                {
-                    fprintf(stderr, "NMEAParser::GetTimeAndPosition() "
-                                    "Bad STATUS field in sentence!\n");
-                    delete[] buf;
-                    return false;
-                }
-                break;
+        case ALT_M:
+        case ALT_VAL:
+        {
+            // altitude value (with ALT_M, in meters, as no unit field follows)
+            if (ALT_M == fieldType) state.altUnit = METERS;
+            if (0 == fieldLength) break; // no ALT_VAL provided
+            Decimal alt;
+            if (!ParseDecimal(field, fieldLength, alt))
+            {
+                return FieldError(state, "Bad ALT_VAL field in sentence!");
+            }
+            state.altVal = DecimalToDouble(alt);
+            state.gotAltVal = true;
+        }
+        break;
             
-            // GPGGA uses FIX_MODE instead of status
-            // (non-zero FIX_MODE == ACTIVE status)
-            case FIX_MODE:  
+        case ALT_UNIT:
+            if (0 == fieldLength) 
             {
-                if ('\0' == field[0]) break; // no FIX_MODE provided
-                int fixMode = atoi(field);
-                if (fixMode > 0)
-                {
-                    status = ACTIVE;
-                }
-                else if (0 == fixMode)
-                {
-                    status = VOID;
-                } 
-                else
-                {
-                    fprintf(stderr, "NMEAParser::GetTimeAndPosition() "
-                                    "Bad FIX_MODE field in sentence!\n");
-                    delete[] buf;
-                    return false;
-                }
+                break; // no ALT_UNIT provided
+            }
+            else if ('M' == field[0])
+            {
+                state.altUnit = METERS;
+            }
+            else  // (TBD) add support for other units
+            {
+                return FieldError(state, "Bad ALT_UNIT field in sentence!");
             }
             break;
             
-            case SPD:
-                break;               
-                
-            default:
-                //fprintf(stderr, "NMEAParser::GetTimeAndPosition() "
-                //                "Unknown field in sentence template?!\n");
-                //delete[] buf;
-                //return false;
-                // Ignore "UNUSED" or other fields for now
-                break;      
-            
-        }
-        fieldType = sentenceTemplate[i++];
-    }  // end while(END != fieldType)
-    
-    // Done with our copy of the sentence
-    delete[] buf;
-    
-    // 4) Fill out GPSPosition struct with data collected from parsing
-    if (ACTIVE == status)
-    {
-        // Determine GPS Time (if valid)
-        if (gotTime && gotDate)
-        {
-            struct tm t;
-            // Get epoch reference for ...
-            t.tm_year=70;
-            t.tm_mon=0;
-            t.tm_mday=1;
-            t.tm_sec=0;
-            t.tm_min=0;
-            t.tm_hour=0;
-            t.tm_isdst=0;
-            // and deterimine local machine timezone offset
-            time_t offsetSecs = mktime(&t);
-            // Fill in "t" for UTC time from sentence
-            if (year < 70)
-                t.tm_year = year + 100;
+        case STATUS:
+            state.statusField = true;
+            if (0 == fieldLength) 
+                break; // no STATUS provided
+            else if ('A' == field[0])
+                state.status = ACTIVE;
+            else if ('V' == field[0])
+                state.status = VOID;
             else
             {
-                fprintf(stderr, "NMEAParser::GetTimeAndPostion() error: "
-                                " Invalid \"year\".\n");
-                delete[] buf;
-                return false;
+                return FieldError(state, "Bad STATUS field in sentence!");
             }
-            t.tm_mon = month - 1;  // NMEA uses 1-12
-            t.tm_mday = day;
-            t.tm_hour = hour;
-            t.tm_min = minute;
-            t.tm_sec = (int) second;
-            // Compute seconds since GMT epoch (using offset)
-            time_t totalSecs = mktime(&t) - offsetSecs;
-            // Compute microseconds
-            unsigned long uSecs = (unsigned long)((second - (double)t.tm_sec)*1.0e06 + 0.5);            
-            p->gps_time.tv_sec = totalSecs;
-            p->gps_time.tv_usec = uSecs;
-            p->tvalid = true;
-        }
-        else
+            break;
+        
+        // GPGGA uses FIX_MODE instead of status
+        // (non-zero FIX_MODE == ACTIVE status)
+        case FIX_MODE:  
         {
-            p->tvalid = false;
+            state.statusField = true;
+            if (0 == fieldLength) break; // no FIX_MODE provided
+            unsigned int fixMode;
+            if (!ParseDigits(field, fieldLength, fixMode))
+            {
+                return FieldError(state, "Bad FIX_MODE field in sentence!");
+            }
+            state.status = (fixMode > 0) ? ACTIVE : VOID;
+            state.quality = fixMode;
+            state.gotQuality = true;
         }
-        if (gotLatVal && (0.0 != latRef) && gotLonVal && (0.0 != latRef))
+        break;
+        
+        // GNS gives a mode character per satellite system, with the
+        // GGA quality order ("N" = no fix, "A" = autonomous, ...)
+        case GNS_MODE:
         {
-            p->x = lonRef * lonVal;
-            p->y = latRef * latVal;
-            p->xyvalid = true;
+            state.statusField = true;
+            if (0 == fieldLength) break; // no GNS_MODE provided
+            static const char GNS_MODES[] = "NADPRFEMS";
+            state.status = VOID;
+            for (unsigned int k = 0; k < fieldLength; k++)
+            {
+                const char* mode = (const char*)memchr(GNS_MODES, field[k], sizeof(GNS_MODES) - 1);
+                if (!mode)
+                {
+                    return FieldError(state, "Bad GNS_MODE field in sentence!");
+                }
+                if ((GNS_MODES != mode) && (VOID == state.status))
+                {
+                    state.status = ACTIVE;
+                    state.quality = (unsigned int)(mode - GNS_MODES);
+                    state.gotQuality = true;
+                }
+            }
         }
-        else
+        break;
+        
+        case FIX_TYPE:
         {
-            p->xyvalid = false;
+            state.statusField = true;
+            if (0 == fieldLength) break; // no FIX_TYPE provided
+            unsigned int fixType;
+            if (!ParseDigits(field, fieldLength, fixType))
+            {
+                return FieldError(state, "Bad FIX_TYPE field in sentence!");
+            }
+            state.status = (fixType >= 2) ? ACTIVE : VOID;  // (2D or 3D)
         }
-        if (gotAltVal && (INVALID_UNIT != altUnit))
+        break;
+        
+        case MODE_IND:
+            state.statusField = true;
+            if (0 == fieldLength) 
+                break; // no MODE_IND provided
+            state.status = ('N' == field[0]) ? VOID : ACTIVE;
+            break;
+        
+        case SAT_USED:
         {
-            p->z = altVal;  // always METERS for now
-            p->zvalid = true;
+            if (0 == fieldLength) break; // no SAT_USED provided
+            if (!ParseDigits(field, fieldLength, state.satellites))
+            {
+                return FieldError(state, "Bad SAT_USED field in sentence!");
+            }
+            state.gotSatellites = true;
         }
-        else
+        break;
+        
+        case HDOP:
+        case SPD:
+        case HDG:
         {
-            p->zvalid = false;
+            if (0 == fieldLength) break; // (value not provided)
+            Decimal value;
+            if (!ParseDecimal(field, fieldLength, value) || (value.mantissa < 0))
+            {
+                return FieldError(state, (HDOP == fieldType) ? "Bad HDOP field in sentence!" :
+                                         ((SPD == fieldType) ? "Bad SPD field in sentence!" :
+                                                               "Bad HDG field in sentence!"));
+            }
+            if (HDOP == fieldType)
+            {
+                state.hdop = DecimalToDouble(value);
+                state.gotHdop = true;
+            }
+            else if (SPD == fieldType)
+            {
+                state.speed = DecimalToDouble(value) * METERS_PER_SEC_PER_KNOT;
+                state.gotSpeed = true;
+            }
+            else
+            {
+                state.heading = DecimalToDouble(value);
+                state.gotHeading = true;
+            }
         }
-        return true;
+        break;
+            
+        default:
+            //fprintf(stderr, "NMEAParser::GetTimeAndPosition() "
+            //                "Unknown field in sentence template?!\n");
+            //return false;
+            // Ignore "UNUSED" or other fields for now
+            break;      
+        
+    }
+    return true;
+}  // end NMEAParser::ParseField()
+
+bool NMEAParser::EndSentence(SentenceState& state, GPSPositionV2* p, SentenceInfo* info)
+{
+    if (state.error) return false;
+    while (OPTIONAL == *state.field)
+    {
+        state.optional = true;
+        state.field++;
+    }
+    if ((END != *state.field) && !state.optional)
+        return FieldError(state, "Reached sentence end prematurely!");
+    
+    // Sentences without a status field (e.g. ZDA, or VTG before NMEA 2.3)
+    // are active if they gave anything that is published
+    bool gotDate = (0x07 == state.dateParts);
+    Status status = state.status;
+    if (!state.statusField &&
+        ((state.gotTime && gotDate) || state.gotLatVal || state.gotAltVal || state.gotSpeed || 
+         state.gotHeading || state.gotHdop || state.gotSatellites))
+    {
+        status = ACTIVE;
     }
-    else
+    if (ACTIVE != status)
     {
         //fprintf(stderr, "Sentence with VOID status ...\n");
         return false;
     }
-}  // end NMEAParser::GetTimeAndPosition()
+    
+    if (info)
+    {
+        info->type = state.type;
+        info->time_of_day = state.gotTime ? ((long long)(state.hour*3600 + state.minute*60 + state.second)*1000000 + state.usec) : -1;
+    }
+    memset(p, 0, sizeof(GPSPositionV2));
+    p->version = GPS_POSITION_V2;
+    p->size = sizeof(GPSPositionV2);
+    // Determine GPS Time (if valid)
+    if (state.gotTime && gotDate)
+    {
+        if ((state.month < 1) || (state.month > 12) || (state.day < 1) || (state.day > 31))
+            return FieldError(state, "error: Invalid \"date\".");
+        unsigned int date = state.day | (state.month << 8) | (state.year << 16);
+        if (date != state.cachedDate)
+        {
+            state.cachedDays = DaysFromCivil(state.year, state.month, state.day);
+            state.cachedDate = date;
+        }
+        // Compute seconds since GMT epoch (pure UTC arithmetic)
+        p->gps_time.tv_sec = (time_t)(state.cachedDays*86400 + state.hour*3600 + state.minute*60 + state.second);
+        p->gps_time.tv_usec = state.usec;
+        p->valid |= GPS_VALID_TIME;
+    }
+    if (state.gotLatVal && (0.0 != state.latRef) && state.gotLonVal && (0.0 != state.lonRef))
+    {
+        p->x = state.lonRef * state.lonVal;
+        p->y = state.latRef * state.latVal;
+        p->valid |= GPS_VALID_XY;
+    }
+    if (state.gotAltVal && (INVALID_UNIT != state.altUnit))
+    {
+        p->z = state.altVal;  // always METERS for now
+        p->valid |= GPS_VALID_Z;
+    }
+    if (state.gotSpeed)
+    {
+        p->speed = state.speed;
+        p->valid |= GPS_VALID_SPEED;
+    }
+    if (state.gotHeading)
+    {
+        p->heading = state.heading;
+        p->valid |= GPS_VALID_HEADING;
+    }
+    if (state.gotHdop)
+    {
+        p->hdop = state.hdop;
+        p->valid |= GPS_VALID_HDOP;
+    }
+    if (state.gotSatellites)
+    {
+        p->satellites = state.satellites;
+        p->valid |= GPS_VALID_SATELLITES;
+    }
+    if (state.gotQuality)
+    {
+        p->quality = state.quality;
+        p->valid |= GPS_VALID_QUALITY;
+    }
+    return true;
+}  // end NMEAParser::EndSentence()
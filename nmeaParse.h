@@ -3,27 +3,154 @@
 
 #include "gpsPub.h"  // for GPSPosition struct definition
 
+#include <string.h>  // for strlen()
+
+#if __cplusplus >= 201402L
+#define NMEA_CONSTEXPR constexpr
+#else
+#define NMEA_CONSTEXPR inline
+#endif // if/else C++14
+
 class NMEAParser
 {
     public:
-        static bool GetTimeAndPosition(const char* buffer, GPSPosition* p);
+        // Parses "len" bytes of "buffer" (a sentence without its leading '$'
+        // and trailing "*hh" checksum) in place.  The buffer is borrowed,
+        // not modified, and no heap allocation is performed.
+        static bool GetTimeAndPosition(const char* buffer, unsigned int len, GPSPosition* p);
+        static bool GetTimeAndPosition(const char* buffer, GPSPosition* p)
+            {return GetTimeAndPosition(buffer, strlen(buffer), p);}
+        
+        // Sentence types known to the parser (with any talker ID, e.g.
+        // "GPRMC", "GNRMC" or "GLRMC" are all RMC)
+        enum SentenceType 
+        {
+            INVALID_SENTENCE, 
+            RMC,    // recommended minimum (time, date, position, speed, heading)
+            GGA,    // fix data (time, position, altitude, quality, satellites, HDOP)
+            GNS,    // multi-GNSS fix data (as GGA)
+            GSA,    // DOP and active satellites (HDOP)
+            GSV,    // satellites in view (not used)
+            VTG,    // course and speed over ground
+            ZDA,    // time and date
+            GST,    // pseudorange error statistics (not used)
+            NUM_SENTENCE_TYPES
+        };
+        // Types parsed (others are rejected from their address field alone,
+        // see IsWanted()).  By default, those with fields that are published.
+        enum 
+        {
+            DEFAULT_SENTENCE_MASK = (1 << RMC) | (1 << GGA) | (1 << GNS) | 
+                                    (1 << GSA) | (1 << VTG) | (1 << ZDA)
+        };
+        static void SetSentenceMask(unsigned int mask)
+            {sentence_mask = mask;}
+        static unsigned int GetSentenceMask()
+            {return sentence_mask;}
+        // Gets the type of a sentence from its first "len" characters (at 
+        // least the 5 character address field, "ttsss"), in constant time
+        static SentenceType GetSentenceType(const char* buffer, unsigned int len);
+        // True if the sentence (beginning with "buffer") is of a type parsed,
+        // so sentence framing can skip the rest of an unwanted one
+        static bool IsWanted(const char* buffer, unsigned int len)
+        {
+            SentenceType type = GetSentenceType(buffer, len);
+            return ((INVALID_SENTENCE != type) && (0 != (sentence_mask & (1 << type))));
+        }
+        // Sentence types are dispatched on the last two characters of the
+        // address (this sum is distinct for each type known)
+        static NMEA_CONSTEXPR unsigned int DispatchHash(char c1, char c2)
+            {return ((unsigned int)(unsigned char)c1 + (unsigned char)c2) & (DISPATCH_SIZE - 1);}
+        enum {DISPATCH_SIZE = 16};
+        
+        // What else a sentence told (e.g. to assemble the sentences of one
+        // epoch into a single fix, see "epochAssembler.h")
+        struct SentenceInfo
+        {
+            SentenceType    type;
+            long long       time_of_day;    // UTC usec since midnight (-1 if none)
+        };
+        static bool GetTimeAndPosition(const char* buffer, unsigned int len, GPSPosition* p,
+                                       SentenceInfo* info);
+        // Also gets the speed, heading, HDOP, satellite count and fix 
+        // quality (all of "p" is set, with "sys_time" left zero for the caller)
+        static bool GetTimeAndPosition(const char* buffer, unsigned int len, GPSPositionV2* p,
+                                       SentenceInfo* info);
+        
+        enum {MAX_SENTENCE_LENGTH = 80};  // NMEA sentences are 80 chars max
+        
+        // A field "view" is an (offset, length) into the sentence buffer
+        struct Field
+        {
+            unsigned char   offset;
+            unsigned char   length;
+        };
+        enum {MAX_FIELDS = MAX_SENTENCE_LENGTH + 1};
+        
+        // Splits a sentence into its comma-separated field views, returning
+        // the number of fields found (the first is the address field)
+        static unsigned int Tokenize(const char* buffer, unsigned int len,
+                                     Field* fields, unsigned int maxFields);
+        
+        // Exact fixed-point decimal value (mantissa / 10^decimals)
+        struct Decimal
+        {
+            long long       mantissa;
+            unsigned int    decimals;
+        };
+        enum {MAX_DECIMALS = 9};
+        
+        // Converts exactly "len" decimal digits (no sign, no locale)
+        static bool ParseDigits(const char* text, unsigned int len, unsigned int& value);
+        // Converts "[-]ddd[.ddd]" to a fixed-point value with full resolution
+        static bool ParseDecimal(const char* text, unsigned int len, Decimal& value);
+        static double DecimalToDouble(const Decimal& value);
+        // Converts "hhmmss[.fff]" to time of day fields (microsecond resolution)
+        static bool ParseTimeOfDay(const char* text, unsigned int len,
+                                   unsigned int& hour, unsigned int& minute,
+                                   unsigned int& second, unsigned long& usec);
+        // Converts "ddmm.mmmmm" (or "dddmm.mmmmm" with "degDigits" = 3)
+        // to degrees with a single rounding of the exact value (and fails
+        // beyond 90, or with "degDigits" = 3, 180 degrees)
+        static bool ParseAngle(const char* text, unsigned int len, 
+                               unsigned int degDigits, double& degrees);
+        
+        // Days since 1970-01-01 for a proleptic Gregorian (UTC) date
+        // (H. Hinnant's "days_from_civil", free of any timezone state)
+        static NMEA_CONSTEXPR long DaysFromCivil(long year, unsigned int month, unsigned int day)
+        {
+            year -= (month <= 2) ? 1 : 0;
+            long era = ((year >= 0) ? year : (year - 399)) / 400;
+            unsigned int yoe = (unsigned int)(year - era*400);                         // [0, 399]
+            unsigned int doy = (153*((month > 2) ? (month - 3) : (month + 9)) + 2)/5 + day - 1;  // [0, 365]
+            unsigned int doe = yoe*365 + yoe/4 - yoe/100 + doy;                         // [0, 146096]
+            return era*146097 + (long)doe - 719468;
+        }
+        // NMEA "yy" years are taken from the GPS era (1980-2079)
+        static NMEA_CONSTEXPR long FullYear(unsigned int yy)
+            {return (yy < 80) ? (2000 + yy) : (1900 + yy);}
 
     private:
-        enum SentenceType {INVALID_SENTENCE, GPRMC, GPGGA};
-        
         enum FieldType
         {
             UNUSED,     // we don't use this field in our parsing (to simplify)
             TIME,       // UTC hhmmss.[fff] e.g. "170834.123" = 17:08:34.123
             DATE,       // Date ddmmyy
+            DAY,        // (ZDA) "dd"
+            MONTH,      // (ZDA) "mm"
+            YEAR,       // (ZDA) "yyyy"
             STATUS,     // "A" (active) or "V" (void)
             LAT_VAL,    // ddmm.mmmm, e.g. "4124.8963" = 41 deg 24.8963 min
             LAT_REF,    // "N" or "S"
             LON_VAL,    // dddmm.mmm, e.g. "08151.6838" = 81 deg 51.6838 min
             LON_REF,    // "E" or "W"
             FIX_MODE,   // GPGGA, "0", "1", "2" = invalid, GPS, DPGS
+            GNS_MODE,   // GNS, one mode character per system, e.g. "AAN"
+            FIX_TYPE,   // GSA, "1", "2", "3" = no fix, 2D, 3D
+            MODE_IND,   // VTG mode indicator ("N" = not valid)
             SAT_USED,   // e.g. "05" = 5 satellites
             ALT_VAL,    // altitude "280.2" = 280.2
+            ALT_M,      // altitude in meters (no unit field follows)
             ALT_UNIT,   // "M" = meter
             HDOP,
             GEO,
@@ -34,6 +161,7 @@ class NMEAParser
             HDG,
             MAG_VAR,
             MAG_REF,
+            OPTIONAL,   // not a real field, the fields after it may be absent
             END		// not a real field, used to mark end of templates
         };   
         
@@ -41,9 +169,75 @@ class NMEAParser
         
         enum UnitType {INVALID_UNIT, METERS};  // supported altitude unit types
         
+        // Compile-time descriptor of a sentence type:  the type part of its
+        // address (after the talker ID) and its field template
+        struct SentenceDescriptor
+        {
+            char                name[4];
+            const FieldType*    fields;
+        };
+        
         // Templates for sentence types supported by this parser
-        static const FieldType GPRMC_TEMPLATE[];
-        static const FieldType GPGGA_TEMPLATE[];   
+        static const FieldType RMC_TEMPLATE[];
+        static const FieldType GGA_TEMPLATE[];
+        static const FieldType GNS_TEMPLATE[];
+        static const FieldType GSA_TEMPLATE[];
+        static const FieldType GSV_TEMPLATE[];
+        static const FieldType VTG_TEMPLATE[];
+        static const FieldType ZDA_TEMPLATE[];
+        static const FieldType GST_TEMPLATE[];
+        static const SentenceDescriptor DESCRIPTORS[NUM_SENTENCE_TYPES];
+        static const SentenceType DISPATCH[DISPATCH_SIZE];
+        
+        static const double METERS_PER_SEC_PER_KNOT;
+        static unsigned int sentence_mask;
+        
+    public:
+        // Field at a time conversion, for parsing a sentence as it arrives
+        // (see "nmeaStream.h"):  BeginSentence() with the sentence's type,
+        // ParseField() for each field after the address field, and then
+        // EndSentence() gets the result as GetTimeAndPosition() would.
+        // Upon a bad field these return false with "state.error" set.
+        // A state kept from sentence to sentence (e.g. a stream's) also
+        // caches its most recently converted date, so only time of day
+        // arithmetic is needed while the date doesn't change.
+        struct SentenceState
+        {
+            SentenceState() : cachedDate(0), cachedDays(0) {}
+            SentenceType        type;
+            const FieldType*    field;          // next template field
+            bool                optional;       // (rest of template optional)
+            const char*         error;          // (NULL unless a field was bad)
+            // Values collected from sentence
+            unsigned int        hour, minute, second, day, month, year, yy;
+            unsigned long       usec;
+            double              latVal, lonVal, altVal;
+            double              speed, heading, hdop;
+            unsigned int        satellites;
+            unsigned int        quality;
+            double              latRef;
+            double              lonRef;
+            Status              status;
+            UnitType            altUnit;
+            // Checks
+            bool                gotTime;
+            unsigned int        dateParts;      // (day, month and year bits)
+            bool                statusField;    // (sentence type has a status)
+            bool                gotLatVal;
+            bool                gotLonVal;
+            bool                gotAltVal;
+            bool                gotSpeed;
+            bool                gotHeading;
+            bool                gotHdop;
+            bool                gotSatellites;
+            bool                gotQuality;
+            // (not reset by BeginSentence())
+            unsigned int        cachedDate;     // (day | month << 8 | year << 16)
+            long                cachedDays;
+        };
+        static void BeginSentence(SentenceType type, SentenceState& state);
+        static bool ParseField(const char* field, unsigned int len, SentenceState& state);
+        static bool EndSentence(SentenceState& state, GPSPositionV2* p, SentenceInfo* info);
 };  // end class NMEAParser
 
 #endif  // _NMEA_PARSER
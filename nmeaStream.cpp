@@ -0,0 +1,157 @@
+
+#include "nmeaStream.h"
+
+#include <string.h>
+
+NMEAStream::NMEAStream()
+ : require_checksum(false), state(SEEKING_SENTENCE), sentence_length(0),
+   field_start(0), field_count(0), checksum(0), input_checksum(0), 
+   checksum_digits(0), error(NULL), error_type(PREMATURE_SENTENCE)
+{
+    sentence_start_time.tv_sec = sentence_start_time.tv_usec = 0;
+    memset(&fix, 0, sizeof(GPSPositionV2));
+    info.type = NMEAParser::INVALID_SENTENCE;
+    info.time_of_day = -1;
+}
+
+NMEAStream::Event NMEAStream::FramingError(FramingErrorType type, const char* message)
+{
+    error = message;
+    error_type = type;
+    state = SEEKING_SENTENCE;
+    return FRAMING_ERROR;
+}  // end NMEAStream::FramingError()
+
+// Converts the field just completed (the first is the address field,
+// which gives the sentence type).  Returns false if the sentence is
+// of a type that isn't parsed.
+bool NMEAStream::EndField()
+{
+    const char* field = sentence_buffer + field_start;
+    unsigned int len = sentence_length - field_start;
+    if (0 == field_count++)
+    {
+        if (!NMEAParser::IsWanted(field, len)) return false;
+        NMEAParser::BeginSentence(NMEAParser::GetSentenceType(field, len), sentence_state);
+    }
+    else
+    {
+        // (a bad field is reported once the checksum has been checked)
+        NMEAParser::ParseField(field, len, sentence_state);
+    }
+    return true;
+}  // end NMEAStream::EndField()
+
+NMEAStream::Event NMEAStream::EndSentence()
+{
+    state = SEEKING_SENTENCE;
+    if (!NMEAParser::EndSentence(sentence_state, &fix, &info))
+    {
+        error = sentence_state.error;
+        return SENTENCE;
+    }
+    error = NULL;
+    return FIX;
+}  // end NMEAStream::EndSentence()
+
+NMEAStream::Event NMEAStream::PutByte(char c, const struct timeval& arrivalTime)
+{
+    // '$' always triggers NMEA sentence start regardless of current state
+    if ('$' == c)
+    {
+        bool premature = (SEEKING_SENTENCE != state);
+        sentence_start_time = arrivalTime;
+        state = READING_SENTENCE;
+        sentence_length = field_start = field_count = 0;
+        checksum = 0;
+        if (premature)
+        {
+            error = "Warning! prematurely detected new sentence";
+            error_type = PREMATURE_SENTENCE;
+            return FRAMING_ERROR;
+        }
+        return NONE;
+    }
+    switch (state)
+    {
+        case SEEKING_SENTENCE:
+            return NONE;
+            
+        case READING_SENTENCE:
+            // (checked before the character is stored, leaving room for
+            // the '\0' that GetSentence() appends)
+            if ((sentence_length >= NMEAParser::MAX_SENTENCE_LENGTH) &&
+                ('*' != c) && ('\r' != c) && ('\n' != c))
+                return FramingError(SENTENCE_TOO_LONG, "Maximum NMEA sentence length exceeded?");
+            if (',' == c)
+            {
+                if (!EndField())
+                {
+                    state = SEEKING_SENTENCE;
+                    return SKIPPED;
+                }
+                checksum ^= (unsigned char)c;
+                sentence_buffer[sentence_length++] = c;
+                field_start = sentence_length;
+            }
+            else if ('*' == c)
+            {
+                if (!EndField())
+                {
+                    state = SEEKING_SENTENCE;
+                    return SKIPPED;
+                }
+                state = READING_CHECKSUM;
+                input_checksum = checksum_digits = 0;
+                return NONE;
+            }
+            else if (('\r' == c) || ('\n' == c))
+            {
+                if (require_checksum)
+                    return FramingError(MISSING_CHECKSUM, "Warning! missing expected NMEA checksum.");
+                if (!EndField())
+                {
+                    state = SEEKING_SENTENCE;
+                    return SKIPPED;
+                }
+                return EndSentence();  // (checksum may be optional)
+            }
+            else
+            {
+                checksum ^= (unsigned char)c;
+                sentence_buffer[sentence_length++] = c;
+            }
+            return NONE;
+            
+        case READING_CHECKSUM:
+        {
+            unsigned int digit;
+            if ((c >= '0') && (c <= '9'))
+                digit = c - '0';
+            else if ((c >= 'A') && (c <= 'F'))
+                digit = c - 'A' + 10;
+            else if ((c >= 'a') && (c <= 'f'))
+                digit = c - 'a' + 10;
+            else if ((('\r' == c) || ('\n' == c)) && (checksum_digits > 0))
+                return (input_checksum == checksum) ? EndSentence() : FramingError(BAD_CHECKSUM, "Bad NMEA checksum!");
+            else
+                return FramingError(BAD_CHECKSUM_FIELD, "Bad checksum field!");
+            if (++checksum_digits > 2)
+                return FramingError(BAD_CHECKSUM_FIELD, "Bad checksum field!");
+            input_checksum = (input_checksum << 4) | digit;
+            return NONE;
+        }
+    }
+    return NONE;
+}  // end NMEAStream::PutByte()
+
+NMEAStream::Event NMEAStream::Put(const char* data, unsigned int len,
+                                  const struct timeval& arrivalTime, unsigned int& used)
+{
+    for (used = 0; used < len; )
+    {
+        Event event = PutByte(data[used++], arrivalTime);
+        if (NONE != event) return event;
+    }
+    return NONE;
+}  // end NMEAStream::Put()
@@ -0,0 +1,107 @@
+#ifndef _NMEA_STREAM
+#define _NMEA_STREAM
+
+#include "nmeaParse.h"
+
+#include <sys/time.h>
+
+// The NMEAStream parses NMEA sentences as their bytes arrive, in one
+// pass:  each byte is framed, added to the running XOR checksum and,
+// at the end of each field, the field is converted (see
+// NMEAParser::ParseField()).  So the fix is ready as soon as the
+// sentence's terminating CR (or LF) arrives, with only the checksum
+// comparison and the fix assembly left to do.  The address field
+// is dispatched as soon as it is complete, and the rest of a sentence
+// of a type not parsed is skipped without checksumming or buffering.
+
+class NMEAStream
+{
+    public:
+        NMEAStream();
+
+        // Without the "*hh" checksum, a sentence is a framing error
+        void SetRequireChecksum(bool state)
+            {require_checksum = state;}
+        // Back to seeking the next '$' (sentence start)
+        void Reset()
+            {state = SEEKING_SENTENCE;}
+
+        enum Event
+        {
+            NONE,           // (nothing completed)
+            FIX,            // active sentence of a parsed type (see GetFix())
+            SENTENCE,       // other complete sentence (e.g. VOID, bad field)
+            SKIPPED,        // sentence of a type not parsed (after its address)
+            FRAMING_ERROR   // (see GetError())
+        };
+
+        // Feeds the next byte ("arrivalTime" is kept for the '$')
+        Event PutByte(char c, const struct timeval& arrivalTime);
+        // Feeds up to "len" bytes (all with "arrivalTime"), stopping after
+        // any byte that gives an event, with "used" the number consumed
+        Event Put(const char* data, unsigned int len,
+                  const struct timeval& arrivalTime, unsigned int& used);
+
+        // Latest FIX ("sys_time" left zero for the caller), and what else
+        // its sentence told
+        const GPSPositionV2& GetFix() const
+            {return fix;}
+        const NMEAParser::SentenceInfo& GetInfo() const
+            {return info;}
+        // Arrival time of the latest sentence's '$'
+        const struct timeval& GetSentenceStartTime() const
+            {return sentence_start_time;}
+        // Text of the latest sentence (without the '$' or checksum, for
+        // debugging), so far as it was read
+        const char* GetSentence()
+        {
+            sentence_buffer[sentence_length] = '\0';
+            return sentence_buffer;
+        }
+        // Why the latest FRAMING_ERROR, or SENTENCE with a bad field, was
+        // (NULL if a SENTENCE had no error, e.g. it was VOID)
+        const char* GetError() const
+            {return error;}
+        // The kind of the latest FRAMING_ERROR (e.g. for counting, the
+        // "gpsStats.h" framing error counters are in this order)
+        enum FramingErrorType
+        {
+            PREMATURE_SENTENCE,     // ('$' before the previous one ended)
+            MISSING_CHECKSUM,       // (with SetRequireChecksum())
+            SENTENCE_TOO_LONG,
+            BAD_CHECKSUM,
+            BAD_CHECKSUM_FIELD
+        };
+        FramingErrorType GetErrorType() const
+            {return error_type;}
+
+    private:
+        bool EndField();
+        Event EndSentence();
+        Event FramingError(FramingErrorType type, const char* message);
+
+        enum State
+        {
+            SEEKING_SENTENCE,
+            READING_SENTENCE,
+            READING_CHECKSUM
+        };
+
+        bool                        require_checksum;
+        State                       state;
+        char                        sentence_buffer[NMEAParser::MAX_SENTENCE_LENGTH + 1];
+        unsigned int                sentence_length;
+        unsigned int                field_start;        // (offset of current field)
+        unsigned int                field_count;        // (fields completed)
+        unsigned char               checksum;           // (running XOR)
+        unsigned int                input_checksum;
+        unsigned int                checksum_digits;
+        struct timeval              sentence_start_time;
+        NMEAParser::SentenceState   sentence_state;
+        GPSPositionV2               fix;
+        NMEAParser::SentenceInfo    info;
+        const char*                 error;
+        FramingErrorType            error_type;
+};  // end class NMEAStream
+
+#endif // _NMEA_STREAM
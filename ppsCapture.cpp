@@ -0,0 +1,166 @@
+
+#include "ppsCapture.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+static void InterruptHandler(int /*sigNum*/)
+{
+    // (only interrupts the capture thread's blocking ioctl())
+}
+
+PPSCapture::PPSCapture()
+ : source(NULL), thread_started(false), stopping(false),
+   edge_count(0), drop_count(0), have_held(false), have_last(false)
+{
+}
+
+PPSCapture::~PPSCapture()
+{
+    Stop();
+}
+
+bool PPSCapture::Start(PPSSource* theSource, unsigned int queueSize)
+{
+    Stop();
+    if (!queue.Init(queueSize))
+    {
+        fprintf(stderr, "PPSCapture::Start() error: queue allocation failed\n");
+        return false;
+    }
+    source = theSource;
+    stopping = false;
+    edge_count = drop_count = 0;
+    have_held = have_last = false;
+    // SIGUSR1 may be used to interrupt the capture thread on Stop()
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = InterruptHandler;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = 0;  // (no SA_RESTART)
+    if (sigaction(SIGUSR1, &action, NULL))
+    {
+        perror("PPSCapture::Start() sigaction() error");
+        return false;
+    }
+    // Other signals are left for the main thread to handle
+    sigset_t blocked, previous;
+    sigemptyset(&blocked);
+    sigaddset(&blocked, SIGINT);
+    sigaddset(&blocked, SIGTERM);
+    sigaddset(&blocked, SIGALRM);
+    pthread_sigmask(SIG_BLOCK, &blocked, &previous);
+    // (the thread inherits gpsLogger's real-time priority, if any)
+    int result = pthread_create(&thread, NULL, ThreadMain, this);
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+    if (0 != result)
+    {
+        errno = result;
+        perror("PPSCapture::Start() pthread_create() error");
+        return false;
+    }
+    thread_started = true;
+    return true;
+}  // end PPSCapture::Start()
+
+void PPSCapture::Stop()
+{
+    if (!thread_started) return;
+    __atomic_store_n(&stopping, true, __ATOMIC_RELEASE);
+    // (repeated in case the interrupt lands just before the thread blocks)
+    while (true)
+    {
+        source->Interrupt(thread);
+#ifdef LINUX
+        struct timespec timeout;
+        clock_gettime(CLOCK_REALTIME, &timeout);
+        timeout.tv_nsec += 100000000;
+        if (timeout.tv_nsec >= 1000000000)
+        {
+            timeout.tv_sec++;
+            timeout.tv_nsec -= 1000000000;
+        }
+        if (0 == pthread_timedjoin_np(thread, NULL, &timeout)) break;
+#else
+        pthread_join(thread, NULL);
+        break;
+#endif // if/else LINUX
+    }
+    thread_started = false;
+}  // end PPSCapture::Stop()
+
+void* PPSCapture::ThreadMain(void* arg)
+{
+    ((PPSCapture*)arg)->Run();
+    return NULL;
+}  // end PPSCapture::ThreadMain()
+
+void PPSCapture::Run()
+{
+    bool errorReported = false;
+    while (!__atomic_load_n(&stopping, __ATOMIC_ACQUIRE))
+    {
+        PPSEdge edge;
+        if (!source->WaitForEdge(edge.time))
+        {
+            if (__atomic_load_n(&stopping, __ATOMIC_ACQUIRE)) break;
+            if (EINTR == errno) continue;
+            if (!errorReported)
+                fprintf(stderr, "PPSCapture::Run() error waiting for PPS (%s source): %s\n",
+                                source->GetName(), strerror(errno));
+            errorReported = true;  // (report persistent errors once)
+            sleep(1);  // (don't spin on a persistent error)
+            continue;
+        }
+        errorReported = false;
+        edge.sequence = edge_count + 1;
+        __atomic_store_n(&edge_count, edge.sequence, __ATOMIC_RELAXED);
+        if (!queue.Push(edge))
+            __atomic_store_n(&drop_count, drop_count + 1, __ATOMIC_RELAXED);
+    }
+}  // end PPSCapture::Run()
+
+static inline bool TimeIsAfter(const struct timeval& a, const struct timeval& b)
+{
+    return ((a.tv_sec > b.tv_sec) ||
+            ((a.tv_sec == b.tv_sec) && (a.tv_usec > b.tv_usec)));
+}  // end TimeIsAfter()
+
+bool PPSCapture::GetEdge(const struct timeval& time, double maxAge, PPSEdge& edge)
+{
+    bool found = false;
+    while (true)
+    {
+        PPSEdge next;
+        if (have_held)
+            next = held_edge;
+        else if (!queue.Pop(next))
+            break;
+        if (TimeIsAfter(next.time, time))
+        {
+            held_edge = next;
+            have_held = true;
+            break;
+        }
+        have_held = false;
+        edge = next;
+        found = true;
+    }
+    if (!found) return false;
+    last_edge = edge;
+    have_last = true;
+    double age = (time.tv_sec - edge.time.tv_sec) +
+                 1.0e-06 * ((long)time.tv_usec - (long)edge.time.tv_usec);
+    return (age <= maxAge);
+}  // end PPSCapture::GetEdge()
+
+bool PPSCapture::GetLastEdge(PPSEdge& edge) const
+{
+    if (!have_last) return false;
+    edge = last_edge;
+    return true;
+}  // end PPSCapture::GetLastEdge()
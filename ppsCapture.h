@@ -0,0 +1,66 @@
+#ifndef _PPS_CAPTURE
+#define _PPS_CAPTURE
+
+#include "spscQueue.h"
+#include "ppsSource.h"
+
+#include <sys/time.h>
+#include <pthread.h>
+
+// The PPSCapture thread waits for pulse-per-second edges from a
+// PPSSource (see "ppsSource.h") and queues each edge's timestamp as
+// soon as it has it.  Edges are handed to the sentence reading loop
+// through a lock-free queue and paired with NMEA sentences by time
+// (GetEdge()), so the reading loop no longer has to poll the modem
+// lines (TIOCMGET) as it reads, and a pulse is timestamped the same way
+// whether or not a sentence is being read.
+
+typedef struct PPSEdge
+{
+    struct timeval  time;       // system time of edge
+    unsigned long   sequence;   // edge count (since Start())
+} PPSEdge;
+
+class PPSCapture
+{
+    public:
+        PPSCapture();
+        ~PPSCapture();
+
+        // Starts capturing edges from "source"
+        bool Start(PPSSource* source, unsigned int queueSize = 16);
+        void Stop();
+        bool IsRunning() const
+            {return thread_started;}
+
+        // Consumer side:  gets the latest edge at or before "time" (and
+        // no more than "maxAge" seconds before it), once.  Later edges
+        // are kept for subsequent calls.
+        bool GetEdge(const struct timeval& time, double maxAge, PPSEdge& edge);
+        // Gets the latest edge seen by GetEdge() (false if none yet)
+        bool GetLastEdge(PPSEdge& edge) const;
+
+        unsigned long GetEdgeCount() const
+            {return __atomic_load_n(&edge_count, __ATOMIC_RELAXED);}
+        unsigned long GetDropCount() const
+            {return __atomic_load_n(&drop_count, __ATOMIC_RELAXED);}
+
+    private:
+        static void* ThreadMain(void* arg);
+        void Run();
+
+        PPSSource*          source;
+        SPSCQueue<PPSEdge>  queue;
+        pthread_t           thread;
+        bool                thread_started;
+        bool                stopping;
+        unsigned long       edge_count;     // (written by capture thread)
+        unsigned long       drop_count;
+        // (consumer side state)
+        PPSEdge             held_edge;      // popped, but later than asked for
+        bool                have_held;
+        PPSEdge             last_edge;
+        bool                have_last;
+};  // end class PPSCapture
+
+#endif // _PPS_CAPTURE
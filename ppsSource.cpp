@@ -0,0 +1,249 @@
+
+#include "ppsSource.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+#ifdef HAVE_TIMEPPS
+#include <sys/timepps.h>  // RFC 2783 PPS API
+#elif defined(LINUX)
+#include <linux/pps.h>    // (the ioctls the RFC 2783 API is built on)
+#endif // if/else HAVE_TIMEPPS / LINUX
+
+void PPSSource::Interrupt(pthread_t thread)
+{
+    pthread_kill(thread, SIGUSR1);
+}  // end PPSSource::Interrupt()
+
+
+ModemLinePPS::ModemLinePPS()
+ : input_fd(-1), pps_signal(0), invert(false)
+{
+}
+
+void ModemLinePPS::Init(int fd, int signal, bool invertPulse)
+{
+    input_fd = fd;
+    pps_signal = signal;
+    invert = invertPulse;
+}  // end ModemLinePPS::Init()
+
+bool ModemLinePPS::WaitForEdge(struct timeval& edgeTime)
+{
+#ifdef LINUX
+    while (true)
+    {
+        // (TIOCMIWAIT returns on either transition)
+        if (ioctl(input_fd, TIOCMIWAIT, pps_signal) < 0) return false;
+        gettimeofday(&edgeTime, NULL);
+        int status;
+        if (ioctl(input_fd, TIOCMGET, &status) < 0) return false;
+        bool high = (0 != (status & pps_signal));
+        if (high != invert) return true;  // (the pulse edge)
+    }
+#else
+    errno = ENOTSUP;
+    return false;
+#endif // if/else LINUX
+}  // end ModemLinePPS::WaitForEdge()
+
+
+KernelPPS::KernelPPS()
+ : pps_fd(-1), invert(false), last_sequence(0), have_sequence(false), interrupted(false)
+#ifdef HAVE_TIMEPPS
+   , pps_handle(NULL)
+#endif // HAVE_TIMEPPS
+{
+}
+
+KernelPPS::~KernelPPS()
+{
+    Close();
+}
+
+bool KernelPPS::Open(const char* device, bool invertPulse)
+{
+    Close();
+    invert = invertPulse;
+    have_sequence = false;
+    interrupted = false;
+    // (write access is needed to set the capture mode)
+    if (((pps_fd = open(device, O_RDWR)) < 0) &&
+        ((pps_fd = open(device, O_RDONLY)) < 0))
+    {
+        perror("KernelPPS::Open() open() error");
+        return false;
+    }
+#ifdef HAVE_TIMEPPS
+    pps_handle_t* handle = new pps_handle_t;
+    if (time_pps_create(pps_fd, handle) < 0)
+    {
+        perror("KernelPPS::Open() time_pps_create() error");
+        delete handle;
+        Close();
+        return false;
+    }
+    pps_handle = handle;
+    pps_params_t params;
+    if (time_pps_getparams(*handle, &params) < 0)
+    {
+        perror("KernelPPS::Open() time_pps_getparams() error");
+        Close();
+        return false;
+    }
+    params.mode |= (invert ? PPS_CAPTURECLEAR : PPS_CAPTUREASSERT) | PPS_TSFMT_TSPEC;
+    if (time_pps_setparams(*handle, &params) < 0)
+        perror("KernelPPS::Open() warning: time_pps_setparams() error");
+    return true;
+#elif defined(LINUX)
+    struct pps_kparams params;
+    if (ioctl(pps_fd, PPS_GETPARAMS, &params) < 0)
+    {
+        perror("KernelPPS::Open() ioctl(PPS_GETPARAMS) error");
+        Close();
+        return false;
+    }
+    params.mode |= (invert ? PPS_CAPTURECLEAR : PPS_CAPTUREASSERT) | PPS_TSFMT_TSPEC;
+    if (ioctl(pps_fd, PPS_SETPARAMS, &params) < 0)
+        perror("KernelPPS::Open() warning: ioctl(PPS_SETPARAMS) error");
+    return true;
+#else
+    fprintf(stderr, "KernelPPS::Open() error: PPS API not supported\n");
+    Close();
+    return false;
+#endif // if/else HAVE_TIMEPPS / LINUX
+}  // end KernelPPS::Open()
+
+void KernelPPS::Close()
+{
+#ifdef HAVE_TIMEPPS
+    if (pps_handle)
+    {
+        time_pps_destroy(*((pps_handle_t*)pps_handle));
+        delete (pps_handle_t*)pps_handle;
+        pps_handle = NULL;
+    }
+#endif // HAVE_TIMEPPS
+    if (pps_fd >= 0)
+    {
+        close(pps_fd);
+        pps_fd = -1;
+    }
+}  // end KernelPPS::Close()
+
+void KernelPPS::Interrupt(pthread_t /*thread*/)
+{
+    // (WaitForEdge() fetches with a timeout and checks this)
+    __atomic_store_n(&interrupted, true, __ATOMIC_RELEASE);
+}  // end KernelPPS::Interrupt()
+
+bool KernelPPS::WaitForEdge(struct timeval& edgeTime)
+{
+    while (!__atomic_exchange_n(&interrupted, false, __ATOMIC_ACQ_REL))
+    {
+        // Fetch blocks until the next event (or a 1 second timeout)
+        unsigned long sequence;
+        struct timespec stamp;
+#ifdef HAVE_TIMEPPS
+        pps_info_t info;
+        struct timespec timeout = {1, 0};
+        if (time_pps_fetch(*((pps_handle_t*)pps_handle), PPS_TSFMT_TSPEC, &info, &timeout) < 0)
+        {
+            if ((ETIMEDOUT == errno) || (EINTR == errno)) continue;
+            return false;
+        }
+        sequence = invert ? info.clear_sequence : info.assert_sequence;
+        stamp = invert ? info.clear_timestamp : info.assert_timestamp;
+#elif defined(LINUX)
+        struct pps_fdata data;
+        memset(&data, 0, sizeof(data));
+        data.timeout.sec = 1;  // (flags cleared, i.e. timeout is valid)
+        if (ioctl(pps_fd, PPS_FETCH, &data) < 0)
+        {
+            if ((ETIMEDOUT == errno) || (EINTR == errno)) continue;
+            return false;
+        }
+        sequence = invert ? data.info.clear_sequence : data.info.assert_sequence;
+        const struct pps_ktime& t = invert ? data.info.clear_tu : data.info.assert_tu;
+        stamp.tv_sec = t.sec;
+        stamp.tv_nsec = t.nsec;
+#else
+        errno = ENOTSUP;
+        return false;
+#endif // if/else HAVE_TIMEPPS / LINUX
+        // (the fetch also returns on the other edge, so check sequence)
+        if (have_sequence && (sequence == last_sequence)) continue;
+        bool first = !have_sequence;
+        have_sequence = true;
+        last_sequence = sequence;
+        if (first) continue;  // (an old event, captured before we started)
+        edgeTime.tv_sec = stamp.tv_sec;
+        edgeTime.tv_usec = stamp.tv_nsec / 1000;
+        return true;
+    }
+    errno = EINTR;
+    return false;
+}  // end KernelPPS::WaitForEdge()
+
+
+FakePPS::FakePPS(unsigned int periodUsec, double jitterUsec, unsigned int seed)
+ : period_usec(periodUsec ? periodUsec : 1000000), jitter_usec(jitterUsec),
+   random_state(seed ? seed : 1), next_usec(0), interrupted(false)
+{
+}
+
+void FakePPS::Interrupt(pthread_t /*thread*/)
+{
+    __atomic_store_n(&interrupted, true, __ATOMIC_RELEASE);
+}  // end FakePPS::Interrupt()
+
+bool FakePPS::WaitForEdge(struct timeval& edgeTime)
+{
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    long long nowUsec = (long long)now.tv_sec * 1000000 + now.tv_usec;
+    if ((0 == next_usec) || (next_usec < nowUsec))
+        next_usec = (nowUsec / period_usec + 1) * period_usec;  // (next period boundary)
+    // Sleep until the pulse (in short steps so Interrupt() is noticed)
+    while (nowUsec < next_usec)
+    {
+        if (__atomic_exchange_n(&interrupted, false, __ATOMIC_ACQ_REL))
+        {
+            errno = EINTR;
+            return false;
+        }
+        long long sleepUsec = next_usec - nowUsec;
+        if (sleepUsec > 100000) sleepUsec = 100000;
+        struct timespec delay;
+        delay.tv_sec = 0;
+        delay.tv_nsec = (long)(sleepUsec * 1000);
+        nanosleep(&delay, NULL);
+        gettimeofday(&now, NULL);
+        nowUsec = (long long)now.tv_sec * 1000000 + now.tv_usec;
+    }
+    long long edgeUsec = next_usec;
+    next_usec += period_usec;
+    if (jitter_usec > 0.0)
+    {
+        // Gaussian (Box-Muller) from a deterministic xorshift generator
+        double u[2];
+        for (int i = 0; i < 2; i++)
+        {
+            random_state ^= random_state << 13;
+            random_state ^= random_state >> 17;
+            random_state ^= random_state << 5;
+            u[i] = (random_state + 1.0) / 4294967297.0;  // (0, 1)
+        }
+        edgeUsec += (long long)floor(jitter_usec * sqrt(-2.0 * log(u[0])) * cos(2.0 * M_PI * u[1]) + 0.5);
+    }
+    edgeTime.tv_sec = (time_t)(edgeUsec / 1000000);
+    edgeTime.tv_usec = (long)(edgeUsec % 1000000);
+    return true;
+}  // end FakePPS::WaitForEdge()
@@ -0,0 +1,101 @@
+#ifndef _PPS_SOURCE
+#define _PPS_SOURCE
+
+#include <sys/time.h>
+#include <pthread.h>
+
+// A PPSSource provides pulse-per-second edge timestamps to the
+// PPSCapture thread.  Backends are:
+//
+//   ModemLinePPS - serial port DCD or CTS line, via ioctl(TIOCMIWAIT)
+//                  (timestamped in user space after the ioctl() returns,
+//                  so scheduler latency is included)
+//   KernelPPS    - RFC 2783 PPS API device (e.g. Linux "/dev/ppsN"),
+//                  timestamped by the kernel in the interrupt handler
+//   FakePPS      - deterministic software pulses (for tests)
+
+class PPSSource
+{
+    public:
+        virtual ~PPSSource() {}
+
+        virtual const char* GetName() const = 0;
+        // Blocks until the next pulse and gets its timestamp
+        // (returns false on error or if interrupted)
+        virtual bool WaitForEdge(struct timeval& edgeTime) = 0;
+        // Unblocks WaitForEdge() called from "thread"
+        // (default sends "thread" a SIGUSR1 to interrupt system calls)
+        virtual void Interrupt(pthread_t thread);
+};  // end class PPSSource
+
+class ModemLinePPS : public PPSSource
+{
+    public:
+        ModemLinePPS();
+
+        // Uses modem line "signal" (TIOCM_CD or TIOCM_CTS) of (serial
+        // port) "fd".  The pulse is the low->hi transition (or hi->low
+        // if "invert").
+        void Init(int fd, int signal, bool invert);
+
+        const char* GetName() const
+            {return "line";}
+        bool WaitForEdge(struct timeval& edgeTime);
+
+    private:
+        int     input_fd;
+        int     pps_signal;
+        bool    invert;
+};  // end class ModemLinePPS
+
+class KernelPPS : public PPSSource
+{
+    public:
+        KernelPPS();
+        ~KernelPPS();
+
+        // Opens PPS "device" (e.g. "/dev/pps0", which the Linux "pps-ldisc"
+        // line discipline creates for a serial port DCD line when
+        // attached with "ldattach PPS /dev/ttyS0") and enables assert
+        // (or, if "invert", clear) event capture
+        bool Open(const char* device, bool invert);
+        void Close();
+
+        const char* GetName() const
+            {return "kernel";}
+        bool WaitForEdge(struct timeval& edgeTime);
+        void Interrupt(pthread_t thread);
+
+    private:
+        int             pps_fd;
+        bool            invert;
+        unsigned long   last_sequence;
+        bool            have_sequence;
+        bool            interrupted;
+#ifdef HAVE_TIMEPPS
+        void*           pps_handle;  // (pps_handle_t*)
+#endif // HAVE_TIMEPPS
+};  // end class KernelPPS
+
+class FakePPS : public PPSSource
+{
+    public:
+        // Pulses every "periodUsec" (aligned to the system clock) with
+        // deterministic, Gaussian timestamp "jitterUsec" (std deviation)
+        FakePPS(unsigned int periodUsec = 1000000, double jitterUsec = 0.0,
+                unsigned int seed = 1);
+
+        const char* GetName() const
+            {return "fake";}
+        bool WaitForEdge(struct timeval& edgeTime);
+        void Interrupt(pthread_t thread);
+
+    private:
+        unsigned int    period_usec;
+        double          jitter_usec;
+        unsigned int    random_state;
+        long long       next_usec;  // (0 until first pulse is scheduled)
+        bool            interrupted;
+};  // end class FakePPS
+
+#endif // _PPS_SOURCE
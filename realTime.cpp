@@ -0,0 +1,213 @@
+
+#include "realTime.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sched.h>
+#include <alloca.h>
+#include <sys/mman.h>
+#ifdef LINUX
+#include <malloc.h>
+#endif // LINUX
+
+bool RealTime::memory_locked = false;
+
+bool RealTime::SetPriority(int priority)
+{
+#ifdef LINUX
+    struct sched_param schp;
+    memset(&schp, 0, sizeof(schp));
+    if (PRIORITY_NONE == priority)
+    {
+        if (sched_setscheduler(0, SCHED_OTHER, &schp))
+        {
+            perror("RealTime::SetPriority() sched_setscheduler() error");
+            return false;
+        }
+        return true;
+    }
+    int maxPriority = sched_get_priority_max(SCHED_FIFO);
+    int minPriority = sched_get_priority_min(SCHED_FIFO);
+    if (PRIORITY_MAX == priority) priority = maxPriority;
+    if ((priority < minPriority) || (priority > maxPriority))
+    {
+        fprintf(stderr, "RealTime::SetPriority() error: SCHED_FIFO priority %d is not from %d to %d\n",
+                        priority, minPriority, maxPriority);
+        return false;
+    }
+    schp.sched_priority = priority;
+    if (sched_setscheduler(0, SCHED_FIFO, &schp))
+    {
+        fprintf(stderr, "RealTime::SetPriority() warning: can't set SCHED_FIFO priority %d (%s), "
+                        "running with normal scheduling!\n", priority, strerror(errno));
+        return false;
+    }
+    return true;
+#else
+    if (PRIORITY_NONE == priority) return true;
+    fprintf(stderr, "RealTime::SetPriority() warning: real-time priority not supported\n");
+    return false;
+#endif // if/else LINUX
+}  // end RealTime::SetPriority()
+
+bool RealTime::SetAffinity(const int* cpus, unsigned int count)
+{
+#ifdef LINUX
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    for (unsigned int i = 0; i < count; i++)
+    {
+        if (cpus[i] >= 0) CPU_SET(cpus[i], &cpuSet);
+    }
+    if (sched_setaffinity(0, sizeof(cpuSet), &cpuSet))
+    {
+        perror("RealTime::SetAffinity() sched_setaffinity() error");
+        return false;
+    }
+    return true;
+#else
+    fprintf(stderr, "RealTime::SetAffinity() error: CPU affinity not supported\n");
+    return false;
+#endif // if/else LINUX
+}  // end RealTime::SetAffinity()
+
+// (not inlined, so the stack it touches is below the caller's)
+static void __attribute__((noinline)) PrefaultStack(unsigned int bytes)
+{
+    volatile char* stack = (volatile char*)alloca(bytes);
+    for (unsigned int i = 0; i < bytes; i += 4096) stack[i] = 0;
+}  // end PrefaultStack()
+
+bool RealTime::LockMemory(unsigned int stackBytes)
+{
+#ifdef LINUX
+    // Freed heap memory is kept (locked) for reuse, rather than trimmed
+    // or unmapped and faulted in again later
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+#endif // LINUX
+    if (mlockall(MCL_CURRENT | MCL_FUTURE))
+    {
+        perror("RealTime::LockMemory() mlockall() error");
+        return false;
+    }
+    PrefaultStack(stackBytes);
+    memory_locked = true;
+    return true;
+}  // end RealTime::LockMemory()
+
+int RealTime::GetPriority()
+{
+#ifdef LINUX
+    struct sched_param schp;
+    int policy = sched_getscheduler(0);
+    if (((SCHED_FIFO == policy) || (SCHED_RR == policy)) && (0 == sched_getparam(0, &schp)))
+        return schp.sched_priority;
+#endif // LINUX
+    return PRIORITY_NONE;
+}  // end RealTime::GetPriority()
+
+void RealTime::Report(FILE* filePtr, const char* prefix)
+{
+    int priority = GetPriority();
+    if (PRIORITY_NONE == priority)
+        fprintf(filePtr, "%sscheduling>normal", prefix);
+    else
+        fprintf(filePtr, "%sscheduling>SCHED_FIFO priority>%d", prefix, priority);
+#ifdef LINUX
+    // (the CPUs as ranges, e.g. "0-3,6")
+    cpu_set_t cpuSet;
+    if (0 == sched_getaffinity(0, sizeof(cpuSet), &cpuSet))
+    {
+        fprintf(filePtr, " cpus>");
+        const char* separator = "";
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+        {
+            if (!CPU_ISSET(cpu, &cpuSet)) continue;
+            int last = cpu;
+            while (((last + 1) < CPU_SETSIZE) && CPU_ISSET(last + 1, &cpuSet)) last++;
+            if (last > cpu)
+                fprintf(filePtr, "%s%d-%d", separator, cpu, last);
+            else
+                fprintf(filePtr, "%s%d", separator, cpu);
+            separator = ",";
+            cpu = last;
+        }
+    }
+#endif // LINUX
+    fprintf(filePtr, " memory>%s\n", memory_locked ? "locked" : "unlocked");
+}  // end RealTime::Report()
+
+
+static inline long long TimespecNsec(const struct timespec& time)
+{
+    return ((long long)time.tv_sec * 1000000000 + time.tv_nsec);
+}  // end TimespecNsec()
+
+JitterTest::JitterTest()
+ : period_usec(0)
+{
+    memset(&histogram, 0, sizeof(histogram));
+}
+
+void JitterTest::Run(double seconds, unsigned int periodUsec)
+{
+    memset(&histogram, 0, sizeof(histogram));
+    period_usec = periodUsec;
+    long long period = 1000LL * periodUsec;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long long target = TimespecNsec(now);
+    long long end = target + (long long)(seconds * 1.0e09);
+    while ((target += period) <= end)
+    {
+#ifdef LINUX
+        struct timespec wakeup;
+        wakeup.tv_sec = (time_t)(target / 1000000000);
+        wakeup.tv_nsec = (long)(target % 1000000000);
+        while (EINTR == clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeup, NULL));
+#else
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        long long delay = target - TimespecNsec(now);
+        if (delay > 0)
+        {
+            struct timespec interval;
+            interval.tv_sec = (time_t)(delay / 1000000000);
+            interval.tv_nsec = (long)(delay % 1000000000);
+            nanosleep(&interval, NULL);
+        }
+#endif // if/else LINUX
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        long long late = TimespecNsec(now) - target;
+        GPSStatsRecordHistogram(&histogram, late);
+        // (a wakeup more than a period late isn't followed by a burst
+        // of wakeups catching up)
+        if (late > period) target = TimespecNsec(now);
+    }
+}  // end JitterTest::Run()
+
+void JitterTest::Report(FILE* filePtr, const char* prefix) const
+{
+    if (0 == histogram.count)
+    {
+        fprintf(filePtr, "%swakeups>0\n", prefix);
+        return;
+    }
+    fprintf(filePtr, "%swakeups>%llu period>%u usec latency (usec) mean>%.3f p50<%.3f "
+                     "p99<%.3f p99.9<%.3f max>%.3f\n",
+                     prefix, histogram.count, period_usec,
+                     1.0e-03 * histogram.sum / histogram.count,
+                     1.0e-03 * GPSStatsGetQuantile(&histogram, 0.50),
+                     1.0e-03 * GPSStatsGetQuantile(&histogram, 0.99),
+                     1.0e-03 * GPSStatsGetQuantile(&histogram, 0.999),
+                     1.0e-03 * histogram.max);
+    for (unsigned int k = 0; k < GPS_STATS_BUCKETS; k++)
+    {
+        if (0 == histogram.bucket[k]) continue;
+        fprintf(filePtr, "%s    [%.3f, %.3f) usec  %llu (%.3f%%)\n", prefix,
+                         (k ? 1.0e-03 * (1ULL << k) : 0.0), 1.0e-03 * (2ULL << k),
+                         histogram.bucket[k], 100.0 * histogram.bucket[k] / histogram.count);
+    }
+}  // end JitterTest::Report()
@@ -0,0 +1,69 @@
+#ifndef _REAL_TIME
+#define _REAL_TIME
+
+#include "gpsStats.h"
+
+#include <stdio.h>
+
+// Real-time tuning of the gpsLogger process:  its scheduling priority,
+// the CPUs it runs on and locking its memory (so no page fault stalls
+// the loop), applied before any threads are started (which inherit
+// them), and a jitter self-test measuring how late the process wakes up
+// on this host as tuned, to check a deployment before trusting its
+// timestamps.
+
+class RealTime
+{
+    public:
+        enum
+        {
+            PRIORITY_MAX = -1,  // (the highest SCHED_FIFO priority)
+            PRIORITY_NONE = 0   // (normal scheduling)
+        };
+        // Sets SCHED_FIFO "priority" (1 to 99 on Linux, or see above).
+        // Upon failure, the process keeps normal scheduling (and a
+        // warning says so).
+        static bool SetPriority(int priority);
+
+        // Restricts the process to the "count" CPUs listed (negative
+        // entries are skipped)
+        static bool SetAffinity(const int* cpus, unsigned int count);
+
+        // Locks the process' current and future memory (e.g. thread
+        // stacks) with mlockall(), keeps freed heap memory for reuse and
+        // touches "stackBytes" of the calling thread's stack, so none of
+        // it page faults later
+        static bool LockMemory(unsigned int stackBytes);
+        static bool IsMemoryLocked()
+            {return memory_locked;}
+        // The calling thread's real-time priority (or PRIORITY_NONE)
+        static int GetPriority();
+
+        // Outputs the (calling thread's) scheduling, CPUs and memory
+        // locking, e.g. "scheduling>SCHED_FIFO priority>99 cpus>2,3
+        // memory>locked"
+        static void Report(FILE* filePtr, const char* prefix);
+
+    private:
+        static bool memory_locked;
+};  // end class RealTime
+
+// Sleeps until each "period" (with an absolute CLOCK_MONOTONIC timer, on
+// Linux) and records how late each wakeup was
+class JitterTest
+{
+    public:
+        JitterTest();
+
+        void Run(double seconds, unsigned int periodUsec = 1000);
+        // Outputs the wakeup latency distribution (usec)
+        void Report(FILE* filePtr, const char* prefix) const;
+        const GPSHistogram& GetHistogram() const
+            {return histogram;}
+
+    private:
+        GPSHistogram    histogram;
+        unsigned int    period_usec;
+};  // end class JitterTest
+
+#endif // _REAL_TIME
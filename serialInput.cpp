@@ -0,0 +1,167 @@
+
+#include "serialInput.h"
+
+#include <stdio.h>
+#include <unistd.h>
+#include <termios.h>
+#include <sys/ioctl.h>
+
+#ifdef LINUX
+#include <linux/serial.h>  // for Linux low latency option
+#endif // LINUX
+
+SerialInput::SerialInput()
+ : input_fd(-1), byte_usec(0), chunk_size(BUFFER_SIZE),
+   read_index(0), byte_count(0), last_arrival(0),
+   read_count(0), total_bytes(0)
+{
+}
+
+bool SerialInput::Configure(int fd, unsigned int baud)
+{
+    struct termios attr;
+    if (tcgetattr(fd, &attr) < 0)
+    {
+        perror("gpsLogger: Error getting serial port settings!");
+        return false;   
+    }
+    attr.c_cflag &= ~PARENB;  // no parity
+    attr.c_cflag &= ~CSIZE;   // 8-bit bytes (first, clear mask, 
+    attr.c_cflag |= CS8;      //              then, set value)
+    cfmakeraw(&attr);
+    attr.c_cflag |= CLOCAL;
+
+    speed_t speed;
+    switch(baud)
+    {
+        case 4800:
+            speed = B4800;
+            break;
+        case 9600:
+            speed = B9600;
+            break;
+        case 19200:
+            speed = B19200;
+            break;
+        case 38400:
+            speed = B38400;
+            break;
+        case 57600:
+            speed = B57600;
+            break;
+        case 115200:
+            speed = B115200;
+            break;
+
+        default:
+            fprintf(stderr, "gpsLogger: Invalid <baudRate> setting!\n");
+            return false;
+    }
+
+    if (cfsetispeed(&attr, speed))
+    {
+        perror("gpsLogger: cfsetispeed() error");
+        return false;   
+    }
+    if (cfsetospeed(&attr, speed))
+    {
+        perror("gpsLogger: cfsetospeed() error");
+        return false;   
+    }
+
+    attr.c_cc[VTIME]    = READ_TIMEOUT * 10;  // (0.1 sec units)
+    attr.c_cc[VMIN]     = 0;   // 1 char satisfies read
+
+    if (tcsetattr(fd, TCSANOW, &attr) < 0)
+    {
+        perror("gpsLogger: Error setting serial port settings");
+        return false;   
+    }
+
+#ifdef ASYNC_LOW_LATENCY  // (LINUX only?)  
+    // Try to set low latency
+    struct serial_struct serinfo;
+    if (ioctl(fd, TIOCGSERIAL, &serinfo) < 0)
+    {
+        perror("gpsLogger: Cannot get serial info");
+        fprintf(stderr, "gpsLogger: Warning - low latency operation not supported on serial device\n");
+    }
+    else
+    {
+        serinfo.flags |= ASYNC_LOW_LATENCY;
+        if (ioctl(fd, TIOCSSERIAL, &serinfo) < 0) 
+            perror("gpsLogger: Warning: cannot set low latency option");
+    }
+#endif // ASYNC_LOW_LATENCY
+    return true;
+}  // end SerialInput::Configure()
+
+void SerialInput::SetBaud(unsigned int baud)
+{
+    // 8N1 framing is 10 bit times per character
+    byte_usec = (0 != baud) ? (10000000 / baud) : 0;
+}  // end SerialInput::SetBaud()
+
+void SerialInput::SetChunkSize(unsigned int size)
+{
+    if (0 == size)
+        chunk_size = 1;
+    else if (size > BUFFER_SIZE)
+        chunk_size = BUFFER_SIZE;
+    else
+        chunk_size = size;
+}  // end SerialInput::SetChunkSize()
+
+int SerialInput::GetByte(char& character, struct timeval& arrivalTime)
+{
+    if (0 == byte_count)
+    {
+        int result = Fill();
+        if (result <= 0) return result;
+    }
+    character = buffer[read_index];
+    long long usec = arrival[read_index];
+    arrivalTime.tv_sec = (time_t)(usec / 1000000);
+    arrivalTime.tv_usec = (suseconds_t)(usec % 1000000);
+    read_index = (read_index + 1) % BUFFER_SIZE;
+    byte_count--;
+    return 1;
+}  // end SerialInput::GetByte()
+
+int SerialInput::Fill()
+{
+    // Read into the contiguous free space following buffered data
+    unsigned int writeIndex = (read_index + byte_count) % BUFFER_SIZE;
+    unsigned int space = BUFFER_SIZE - writeIndex;
+    if (space > (BUFFER_SIZE - byte_count))
+        space = BUFFER_SIZE - byte_count;
+    if (space > chunk_size) space = chunk_size;
+    if (0 == space) return 1;  // buffer full
+
+    int result = read(input_fd, buffer + writeIndex, space);
+    struct timeval chunkTime;
+    gettimeofday(&chunkTime, NULL);
+    read_count++;
+    if (result <= 0) return result;
+    total_bytes += result;
+
+    // The chunk timestamp corresponds (approximately) to the arrival
+    // of the last byte of the chunk.  Earlier bytes are back-dated at
+    // the line rate, but never before the previous chunk's last byte.
+    long long chunkUsec = (long long)chunkTime.tv_sec*1000000 + chunkTime.tv_usec;
+    long long usec = chunkUsec - (long long)(result - 1)*byte_usec;
+    if (usec <= last_arrival) usec = last_arrival + 1;
+    if (usec > chunkUsec) usec = chunkUsec;
+    for (int i = 0; i < result; i++)
+    {
+        arrival[(writeIndex + i) % BUFFER_SIZE] = usec;
+        if (usec < chunkUsec)
+        {
+            usec += byte_usec;
+            if (usec > chunkUsec) usec = chunkUsec;
+        }
+    }
+    last_arrival = chunkUsec;
+    byte_count += result;
+    return result;
+}  // end SerialInput::Fill()
@@ -0,0 +1,67 @@
+#ifndef _SERIAL_INPUT
+#define _SERIAL_INPUT
+
+#include <sys/time.h>
+
+// The SerialInput class reads the GPS device in chunks (one
+// read() per chunk instead of one per byte) into a ring buffer
+// that the NMEA sentence framing then consumes byte-by-byte.
+// Since only one timestamp is taken per chunk, the arrival time
+// of each byte is estimated by back-dating from the chunk timestamp
+// at the serial line rate (10 bit times per 8N1 character).
+
+class SerialInput
+{
+    public:
+        SerialInput();
+
+        // Sets up (already open) serial port "fd" for raw 8N1 input
+        // at "baud" with a READ_TIMEOUT second read() timeout
+        static bool Configure(int fd, unsigned int baud);
+        enum {READ_TIMEOUT = 10};
+
+        void SetDescriptor(int fd)
+            {input_fd = fd;}
+        // A "baud" of zero disables arrival time back-dating
+        void SetBaud(unsigned int baud);
+        // Maximum bytes requested per read() (1 gives per-byte reads)
+        void SetChunkSize(unsigned int size);
+
+        // Returns 1 with the next byte and its estimated arrival time,
+        // 0 upon read() timeout (or eof), or -1 upon read() error
+        // (with "errno" set accordingly)
+        int GetByte(char& character, struct timeval& arrivalTime);
+
+        // Discard any buffered input (e.g. after a tcflush())
+        void Flush()
+        {
+            read_index = 0;
+            byte_count = 0;
+        }
+        bool IsEmpty() const
+            {return (0 == byte_count);}
+
+        // Statistics
+        unsigned long GetReadCount() const
+            {return read_count;}
+        unsigned long GetTotalBytes() const
+            {return total_bytes;}
+
+    private:
+        int Fill();
+
+        enum {BUFFER_SIZE = 1024};
+
+        int             input_fd;
+        unsigned int    byte_usec;      // character time at line rate (usec)
+        unsigned int    chunk_size;
+        char            buffer[BUFFER_SIZE];
+        long long       arrival[BUFFER_SIZE];  // estimated arrival (usec)
+        unsigned int    read_index;
+        unsigned int    byte_count;
+        long long       last_arrival;   // usec, arrival of last byte read
+        unsigned long   read_count;
+        unsigned long   total_bytes;
+};  // end class SerialInput
+
+#endif // _SERIAL_INPUT
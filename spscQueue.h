@@ -0,0 +1,74 @@
+#ifndef _SPSC_QUEUE
+#define _SPSC_QUEUE
+
+#include <stddef.h>  // for NULL
+
+// Bounded, lock-free, single-producer/single-consumer queue.
+// Exactly one thread may call Push() and exactly one (other) thread
+// may call Pop().  Storage is allocated once by Init() so Push() and
+// Pop() never allocate, block or make system calls.
+
+template <class T>
+class SPSCQueue
+{
+    public:
+        SPSCQueue()
+         : buffer(NULL), mask(0), head(0), tail(0) {}
+        ~SPSCQueue()
+            {delete[] buffer;}
+
+        // "capacity" is rounded up to a power of two
+        bool Init(unsigned int capacity)
+        {
+            unsigned int size = 1;
+            while (size < capacity) size <<= 1;
+            delete[] buffer;
+            if (!(buffer = new T[size])) return false;
+            mask = size - 1;
+            head = tail = 0;
+            return true;
+        }
+
+        // Producer side (returns false if queue is full)
+        bool Push(const T& item)
+        {
+            unsigned int t = __atomic_load_n(&tail, __ATOMIC_RELAXED);
+            unsigned int h = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+            if ((t - h) > mask) return false;
+            buffer[t & mask] = item;
+            __atomic_store_n(&tail, t + 1, __ATOMIC_RELEASE);
+            return true;
+        }
+
+        // Consumer side (returns false if queue is empty)
+        bool Pop(T& item)
+        {
+            unsigned int h = __atomic_load_n(&head, __ATOMIC_RELAXED);
+            unsigned int t = __atomic_load_n(&tail, __ATOMIC_ACQUIRE);
+            if (h == t) return false;
+            item = buffer[h & mask];
+            __atomic_store_n(&head, h + 1, __ATOMIC_RELEASE);
+            return true;
+        }
+
+        // (approximate when called concurrently with Push()/Pop())
+        unsigned int GetDepth() const
+        {
+            return (__atomic_load_n(&tail, __ATOMIC_ACQUIRE) -
+                    __atomic_load_n(&head, __ATOMIC_ACQUIRE));
+        }
+        unsigned int GetCapacity() const
+            {return (buffer ? (mask + 1) : 0);}
+
+    private:
+        T*              buffer;
+        unsigned int    mask;
+        // (producer and consumer indices are kept on separate cache lines)
+        char            pad0[64];
+        unsigned int    head;   // next item to Pop()
+        char            pad1[64];
+        unsigned int    tail;   // next slot to Push()
+        char            pad2[64];
+};  // end class SPSCQueue
+
+#endif // _SPSC_QUEUE